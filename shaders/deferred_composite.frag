@@ -0,0 +1,19 @@
+#version 450
+
+// copies the deferred path's lit color and depth into the swapchain pass, so light billboards
+// drawn afterwards are depth tested against the scene
+layout (location = 0) out vec4 outColor;
+
+layout(set = 1, binding = 0) uniform sampler2D litColor;
+layout(set = 1, binding = 1) uniform sampler2D sceneDepth;
+
+void main() {
+  ivec2 texel = ivec2(gl_FragCoord.xy);
+  float depth = texelFetch(sceneDepth, texel, 0).r;
+  // the sky shows through where the G-buffer has no geometry
+  if (depth >= 1.0) {
+    discard;
+  }
+  outColor = texelFetch(litColor, texel, 0);
+  gl_FragDepth = depth;
+}
@@ -0,0 +1,50 @@
+#version 450
+#extension GL_GOOGLE_include_directive : require
+
+// lighting subpass of the deferred path: shades every pixel of the G-buffer once against the
+// sun and its cluster's lights, through the same lighting.glsl as simple_shader.frag
+layout (location = 0) out vec4 outColor;
+
+#include "lighting.glsl"
+
+layout(input_attachment_index = 0, set = 1, binding = 0) uniform subpassInput gAlbedo;
+layout(input_attachment_index = 1, set = 1, binding = 1) uniform subpassInput gNormal;
+layout(input_attachment_index = 2, set = 1, binding = 2) uniform subpassInput gOrm;
+layout(input_attachment_index = 3, set = 1, binding = 3) uniform subpassInput gDepth;
+
+// view space position from depth, the inverse of BurnhopeCamera's perspective projection
+vec3 viewPosition(float depth) {
+  float z = ubo.projection[3][2] / (depth - ubo.projection[2][2]);
+  vec2 ndc = gl_FragCoord.xy / ubo.screenSize * 2.0 - 1.0;
+  return vec3(ndc.x * z / ubo.projection[0][0], ndc.y * z / ubo.projection[1][1], z);
+}
+
+void main() {
+  // background, the lit attachment keeps its clear color
+  float depth = subpassLoad(gDepth).r;
+  if (depth >= 1.0) {
+    discard;
+  }
+  vec3 posView = viewPosition(depth);
+  vec3 fragPosWorld = (ubo.invView * vec4(posView, 1.0)).xyz;
+
+  uint cluster = clusterIndex(posView.z);
+  uint clusterLightCount = clusters.lightCounts[cluster];
+  if (ubo.clusterDebug != 0) {
+    outColor = vec4(heatMap(float(clusterLightCount) / float(MAX_LIGHTS_PER_CLUSTER)), 1.0);
+    return;
+  }
+
+  vec4 albedoSample = subpassLoad(gAlbedo);
+  vec3 albedo = albedoSample.rgb;
+  vec3 N = normalize(subpassLoad(gNormal).xyz);
+  vec3 orm = subpassLoad(gOrm).rgb;
+  float ao = orm.r;
+  float roughness = orm.g;
+  float metallic = orm.b;
+
+  // the G-buffer holds no light count class, every light of the cluster is shaded
+  vec3 color = shadeSurface(
+      fragPosWorld, N, albedo, ao, roughness, metallic, cluster, clusterLightCount);
+  outColor = vec4(displayColor(color, albedoSample.a > 0.5), 1.0);
+}
@@ -0,0 +1,43 @@
+#version 450
+
+// depth pre-pass: positions only, no fragment stage. gl_Position must come out bit-identical to
+// simple_shader.vert for the main pass's EQUAL depth test, hence invariant and the same math.
+layout(location = 0) in vec3 position;
+
+invariant gl_Position;
+
+layout(set = 0, binding = 0) uniform GlobalUbo {
+  mat4 projection;
+  mat4 view;
+  mat4 invView;
+  vec4 ambientLightColor; // w is intensity
+  vec4 clusterDepth; // near, far, slice scale, slice bias
+  vec2 screenSize;
+  int numLights;
+  int clusterDebug;
+  vec4 sunDirection; // towards the sun, w is intensity
+  vec4 sunColor;
+  int sunShadowView; // -1 if the sun casts no shadows
+} ubo;
+
+struct GameObjectData {
+  mat4 modelMatrix;
+  mat4 normalMatrix;
+  vec4 boundingSphere; // world space, w is the radius
+  uint materialIndex;
+};
+
+layout(std430, set = 1, binding = 0) readonly buffer SceneBuffer {
+  GameObjectData objects[];
+} scene;
+
+layout(std430, set = 1, binding = 1) readonly buffer InstanceBuffer {
+  uint sceneIndices[];
+} instances;
+
+void main() {
+  GameObjectData gameObject = scene.objects[instances.sceneIndices[gl_InstanceIndex]];
+
+  vec4 positionWorld = gameObject.modelMatrix * vec4(position, 1.0);
+  gl_Position = ubo.projection * ubo.view * positionWorld;
+}
@@ -0,0 +1,47 @@
+#version 450
+
+// geometry subpass of the deferred path: writes the material inputs of simple_shader.frag's
+// lighting to the G-buffer, see BurnhopeGBuffer and deferred_lighting.frag
+layout (location = 0) in vec3 fragColor;
+layout (location = 1) in vec3 fragPosWorld;
+layout (location = 2) in vec3 fragNormalWorld;
+layout (location = 3) in vec2 fragUv;
+layout (location = 4) in mat3 TBN;
+
+layout (location = 0) out vec4 outAlbedo; // a is 1 if the material is tonemapped
+layout (location = 1) out vec4 outNormal; // world space
+layout (location = 2) out vec4 outOrm;    // ao, roughness, metallic
+
+// same ids as simple_shader.frag, the light count constant doesn't apply here
+layout(constant_id = 0) const bool HAS_NORMAL_MAP = true;
+layout(constant_id = 1) const bool HAS_ORM_MAPS = true;
+layout(constant_id = 3) const bool TONEMAP = true;
+
+layout(set = 2, binding = 0) uniform sampler2D diffuseMap;
+layout(set = 2, binding = 1) uniform sampler2D NormalMap;
+layout(set = 2, binding = 2) uniform sampler2D AOMap;
+layout(set = 2, binding = 3) uniform sampler2D RoughnessMap;
+layout(set = 2, binding = 4) uniform sampler2D MetallicMap;
+
+void main() {
+  vec3 N;
+  if (HAS_NORMAL_MAP) {
+    vec3 normalTangent = texture(NormalMap, fragUv).rgb * 2.0 - 1.0;
+    N = normalize(TBN * normalTangent);
+  } else {
+    N = normalize(fragNormalWorld);
+  }
+
+  float ao = 1.0;
+  float roughness = 0.5;
+  float metallic = 0.0;
+  if (HAS_ORM_MAPS) {
+    ao = texture(AOMap, fragUv).r;
+    roughness = texture(RoughnessMap, fragUv).r;
+    metallic = texture(MetallicMap, fragUv).r;
+  }
+
+  outAlbedo = vec4(texture(diffuseMap, fragUv).rgb, TONEMAP ? 1.0 : 0.0);
+  outNormal = vec4(N, 0.0);
+  outOrm = vec4(ao, clamp(roughness, 0.05, 1.0), clamp(metallic, 0.0, 1.0), 0.0);
+}
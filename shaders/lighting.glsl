@@ -0,0 +1,262 @@
+// Shading shared by simple_shader.frag and deferred_lighting.frag: the global set, the BRDF,
+// image based lighting, cluster lookup, shadows and the display transform. Both passes light a
+// surface with shadeSurface, so forward and deferred shading stay identical.
+
+struct PointLight {
+  vec4 position; // w is the range
+  vec4 color;    // w is intensity
+  ivec4 shadow;  // x is the first of its six shadow views, -1 if unshadowed
+};
+
+layout(set = 0, binding = 0) uniform GlobalUbo {
+  mat4 projection;
+  mat4 view;
+  mat4 invView;
+  vec4 ambientLightColor; // w is intensity
+  vec4 clusterDepth; // near, far, slice scale, slice bias
+  vec2 screenSize;
+  int numLights;
+  int clusterDebug;
+  vec4 sunDirection; // towards the sun, w is intensity
+  vec4 sunColor;
+  int sunShadowView; // -1 if the sun casts no shadows
+} ubo;
+
+// froxel light lists built by light_cluster.comp
+const uint CLUSTERS_X = 16;
+const uint CLUSTERS_Y = 9;
+const uint CLUSTERS_Z = 24;
+const uint MAX_LIGHTS_PER_CLUSTER = 128;
+
+layout(std430, set = 0, binding = 1) readonly buffer LightBuffer {
+  PointLight lights[];
+} lightBuffer;
+
+layout(std430, set = 0, binding = 2) readonly buffer ClusterBuffer {
+  uvec4 stats;
+  uint lightCounts[];
+} clusters;
+
+layout(std430, set = 0, binding = 3) readonly buffer LightIndexBuffer {
+  uint indices[];
+} lightIndices;
+
+// shadow maps, all tiles of one depth atlas, see ShadowSystem
+struct ShadowView {
+  mat4 viewProjection;
+  vec4 atlasRect; // uv offset and size of the view's tile
+};
+
+layout(std430, set = 0, binding = 4) readonly buffer ShadowViewBuffer {
+  ShadowView views[];
+} shadowViews;
+
+layout(set = 0, binding = 5) uniform sampler2DShadow shadowAtlas;
+
+// image based lighting, see BurnhopeIbl
+layout(set = 0, binding = 6) uniform Environment {
+  vec4 irradianceSH[9]; // irradiance / pi, rgb
+  vec4 params; // x is the specular map's last mip level
+} environment;
+
+layout(set = 0, binding = 7) uniform samplerCube specularMap;
+layout(set = 0, binding = 8) uniform sampler2D brdfLut;
+
+const float PI = 3.14159265359;
+
+float DistributionGGX(vec3 N, vec3 H, float roughness) {
+  float a = roughness * roughness;
+  float a2 = a * a;
+  float NdotH = max(dot(N, H), 0.0);
+  float NdotH2 = NdotH * NdotH;
+
+  float nom = a2;
+  float denom = (NdotH2 * (a2 - 1.0) + 1.0);
+  denom = PI * denom * denom;
+
+  return nom / denom;
+}
+
+float GeometrySchlickGGX(float NdotV, float roughness) {
+  float r = roughness + 1.0;
+  float k = (r * r) / 8.0;
+
+  float nom = NdotV;
+  float denom = NdotV * (1.0 - k) + k;
+
+  return nom / denom;
+}
+
+float GeometrySmith(vec3 N, vec3 V, vec3 L, float roughness) {
+  float NdotV = max(dot(N, V), 0.0);
+  float NdotL = max(dot(N, L), 0.0);
+  float ggx1 = GeometrySchlickGGX(NdotV, roughness);
+  float ggx2 = GeometrySchlickGGX(NdotL, roughness);
+  return ggx1 * ggx2;
+}
+
+vec3 FresnelSchlick(float cosTheta, vec3 F0, float roughness) {
+  return F0 + (max(vec3(1.0 - roughness), F0) - F0) * pow(1.0 - cosTheta, 5.0);
+}
+
+// reflected fraction of the radiance arriving from direction L, cosine term included
+vec3 CookTorrance(
+    vec3 N, vec3 V, vec3 L, vec3 F0, vec3 albedo, float roughness, float metallic) {
+  vec3 H = normalize(V + L);
+  float NDF = DistributionGGX(N, H, roughness);
+  float G   = GeometrySmith(N, V, L, roughness);
+  vec3 F    = FresnelSchlick(max(dot(H, V), 0.0), F0,roughness);
+
+  vec3 numerator    = NDF * G * F;
+  float denominator = 4.0 * max(max(dot(N, V), 0.05) * max(dot(N, L), 0.05), 0.01);
+  vec3 specular     = numerator / denominator;
+
+  float NdotL = max(dot(N, L), 0.0);
+
+  vec3 kS = F;
+  vec3 kD = vec3(1.0) - kS;
+  kD *= 1.0 - metallic;
+
+  return (kD * albedo / PI + specular) * NdotL;
+}
+
+// same basis order and constants as shBasis in lve_ibl.cpp
+vec3 shIrradiance(vec3 n) {
+  return environment.irradianceSH[0].rgb * 0.282095 +
+         environment.irradianceSH[1].rgb * 0.488603 * n.y +
+         environment.irradianceSH[2].rgb * 0.488603 * n.z +
+         environment.irradianceSH[3].rgb * 0.488603 * n.x +
+         environment.irradianceSH[4].rgb * 1.092548 * n.x * n.y +
+         environment.irradianceSH[5].rgb * 1.092548 * n.y * n.z +
+         environment.irradianceSH[6].rgb * 0.315392 * (3.0 * n.z * n.z - 1.0) +
+         environment.irradianceSH[7].rgb * 1.092548 * n.x * n.z +
+         environment.irradianceSH[8].rgb * 0.546274 * (n.x * n.x - n.y * n.y);
+}
+
+// diffuse from the SH irradiance, specular from the prefiltered map and the split-sum LUT
+vec3 environmentLighting(
+    vec3 N, vec3 V, vec3 F0, vec3 albedo, float roughness, float metallic) {
+  float NdotV = max(dot(N, V), 0.0);
+  vec3 kD = (vec3(1.0) - FresnelSchlick(NdotV, F0, roughness)) * (1.0 - metallic);
+  vec3 diffuse = kD * albedo * max(shIrradiance(N), vec3(0.0));
+
+  vec3 R = reflect(-V, N);
+  vec3 prefiltered = textureLod(specularMap, R, roughness * environment.params.x).rgb;
+  vec2 brdf = texture(brdfLut, vec2(NdotV, roughness)).rg;
+  return diffuse + prefiltered * (F0 * brdf.x + brdf.y);
+}
+
+vec3 ACESFittedTonemap(vec3 color) {
+    const float a = 2.51;
+    const float b = 0.03;
+    const float c = 2.43;
+    const float d = 0.59;
+    const float e = 0.14;
+    return clamp((color * (a * color + b)) / (color * (c * color + d) + e), 0.0, 1.0);
+}
+
+
+uint clusterIndex(float viewDepth) {
+  float slice = log(max(viewDepth, ubo.clusterDepth.x)) * ubo.clusterDepth.z + ubo.clusterDepth.w;
+  uint z = min(uint(max(slice, 0.0)), CLUSTERS_Z - 1);
+  uvec2 tile = min(
+      uvec2(gl_FragCoord.xy / ubo.screenSize * vec2(CLUSTERS_X, CLUSTERS_Y)),
+      uvec2(CLUSTERS_X - 1, CLUSTERS_Y - 1));
+  return tile.x + tile.y * CLUSTERS_X + z * CLUSTERS_X * CLUSTERS_Y;
+}
+
+// 3x3 filtered lookups of the comparison sampler, kept inside the view's tile. Returns 1 where
+// lit.
+float shadowFactor(int viewIndex, vec3 worldPos) {
+  ShadowView shadowView = shadowViews.views[viewIndex];
+  vec4 clip = shadowView.viewProjection * vec4(worldPos, 1.0);
+  vec3 ndc = clip.xyz / clip.w;
+  if (ndc.z > 1.0) return 1.0;
+
+  vec2 texel = 1.0 / vec2(textureSize(shadowAtlas, 0));
+  vec2 tileMin = shadowView.atlasRect.xy + texel;
+  vec2 tileMax = shadowView.atlasRect.xy + shadowView.atlasRect.zw - texel;
+  vec2 uv = shadowView.atlasRect.xy + (ndc.xy * 0.5 + 0.5) * shadowView.atlasRect.zw;
+  float lit = 0.0;
+  for (int y = -1; y <= 1; y++) {
+    for (int x = -1; x <= 1; x++) {
+      vec2 sampleUv = clamp(uv + vec2(x, y) * texel, tileMin, tileMax);
+      lit += texture(shadowAtlas, vec3(sampleUv, ndc.z));
+    }
+  }
+  return lit / 9.0;
+}
+
+// picks the cube face the same way ShadowSystem orders them: +x, -x, +y, -y, +z, -z
+float pointShadowFactor(int firstView, vec3 lightToFrag, vec3 worldPos) {
+  vec3 a = abs(lightToFrag);
+  int face;
+  if (a.x >= a.y && a.x >= a.z) {
+    face = lightToFrag.x > 0.0 ? 0 : 1;
+  } else if (a.y >= a.z) {
+    face = lightToFrag.y > 0.0 ? 2 : 3;
+  } else {
+    face = lightToFrag.z > 0.0 ? 4 : 5;
+  }
+  return shadowFactor(firstView + face, worldPos);
+}
+
+// blue through green to red as the cluster fills up
+vec3 heatMap(float t) {
+  return clamp(vec3(2.0 * t - 1.0, 1.0 - abs(2.0 * t - 1.0), 1.0 - 2.0 * t), 0.0, 1.0);
+}
+
+// ambient, sun and the first lightCount lights of the cluster, in linear radiance
+vec3 shadeSurface(
+    vec3 worldPos,
+    vec3 N,
+    vec3 albedo,
+    float ao,
+    float roughness,
+    float metallic,
+    uint cluster,
+    uint lightCount) {
+  vec3 F0 = mix(vec3(0.04), albedo, metallic);
+
+  vec3 V = normalize(ubo.invView[3].xyz - worldPos);
+  // the environment, tinted and scaled by the ambient light color
+  vec3 ambient = environmentLighting(N, V, F0, albedo, roughness, metallic) * ao *
+                 ubo.ambientLightColor.xyz * ubo.ambientLightColor.w;
+
+  vec3 Lo = vec3(0.0);
+
+  if (ubo.sunDirection.w > 0.0) {
+    vec3 radiance = ubo.sunColor.xyz * ubo.sunDirection.w;
+    if (ubo.sunShadowView >= 0) {
+      radiance *= shadowFactor(ubo.sunShadowView, worldPos);
+    }
+    Lo += CookTorrance(N, V, ubo.sunDirection.xyz, F0, albedo, roughness, metallic) * radiance;
+  }
+
+  uint firstIndex = cluster * MAX_LIGHTS_PER_CLUSTER;
+  for (uint i = 0; i < lightCount; ++i) {
+    PointLight light = lightBuffer.lights[lightIndices.indices[firstIndex + i]];
+    vec3 L = normalize(light.position.xyz - worldPos);
+    float distance = length(light.position.xyz - worldPos);
+    // fades to zero at the range the light was culled with
+    float falloff = clamp(1.0 - pow(distance / light.position.w, 4.0), 0.0, 1.0);
+    float attenuation = falloff * falloff / (distance * distance);
+    vec3 radiance = light.color.xyz * light.color.w * attenuation;
+    if (light.shadow.x >= 0) {
+      radiance *= pointShadowFactor(light.shadow.x, worldPos - light.position.xyz, worldPos);
+    }
+
+    Lo += CookTorrance(N, V, L, F0, albedo, roughness, metallic) * radiance;
+  }
+
+  return ambient + Lo;
+}
+
+// ACES filmic when tonemapped, then the gamma both passes write with
+vec3 displayColor(vec3 color, bool tonemap) {
+  if (tonemap) {
+    color = ACESFittedTonemap(color);
+  }
+  // Гамма-коррекция (sRGB)
+  return pow(color, vec3(1.0 / 1.2));
+}
@@ -10,36 +10,43 @@ const vec2 OFFSETS[6] = vec2[](
 );
 
 layout (location = 0) out vec2 fragOffset;
-
-struct PointLight {
-  vec4 position; // ignore w
-  vec4 color; // w is intensity
-};
+layout (location = 1) out vec3 fragColor;
 
 layout(set = 0, binding = 0) uniform GlobalUbo {
   mat4 projection;
   mat4 view;
   mat4 invView;
   vec4 ambientLightColor; // w is intensity
-  PointLight pointLights[10];
+  vec4 clusterDepth; // near, far, slice scale, slice bias
+  vec2 screenSize;
   int numLights;
+  int clusterDebug;
+  vec4 sunDirection; // towards the sun, w is intensity
+  vec4 sunColor;
+  int sunShadowView; // -1 if the sun casts no shadows
 } ubo;
 
-layout(push_constant) uniform Push {
-  vec4 position;
-  vec4 color;
-  float radius;
-} push;
+struct LightBillboard {
+  vec4 position; // w is the billboard radius
+  vec4 color;    // w is intensity
+};
+
+// visible lights sorted back-to-front, one per instance
+layout(std430, set = 1, binding = 0) readonly buffer BillboardBuffer {
+  LightBillboard billboards[];
+} billboardBuffer;
 
 
 void main() {
+  LightBillboard billboard = billboardBuffer.billboards[gl_InstanceIndex];
   fragOffset = OFFSETS[gl_VertexIndex];
+  fragColor = billboard.color.xyz;
   vec3 cameraRightWorld = {ubo.view[0][0], ubo.view[1][0], ubo.view[2][0]};
   vec3 cameraUpWorld = {ubo.view[0][1], ubo.view[1][1], ubo.view[2][1]};
 
-  vec3 positionWorld = push.position.xyz
-    + push.radius * fragOffset.x * cameraRightWorld
-    + push.radius * fragOffset.y * cameraUpWorld;
+  vec3 positionWorld = billboard.position.xyz
+    + billboard.position.w * fragOffset.x * cameraRightWorld
+    + billboard.position.w * fragOffset.y * cameraUpWorld;
 
   gl_Position = ubo.projection * ubo.view * vec4(positionWorld, 1.0);
 }
\ No newline at end of file
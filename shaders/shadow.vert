@@ -0,0 +1,28 @@
+#version 450
+
+// shadow atlas tiles: positions only, no fragment stage. The viewport is the tile.
+layout(location = 0) in vec3 position;
+
+layout(push_constant) uniform Push {
+  mat4 lightViewProjection;
+} push;
+
+struct GameObjectData {
+  mat4 modelMatrix;
+  mat4 normalMatrix;
+  vec4 boundingSphere; // world space, w is the radius
+  uint materialIndex;
+};
+
+layout(std430, set = 0, binding = 0) readonly buffer SceneBuffer {
+  GameObjectData objects[];
+} scene;
+
+layout(std430, set = 0, binding = 1) readonly buffer InstanceBuffer {
+  uint sceneIndices[];
+} instances;
+
+void main() {
+  GameObjectData gameObject = scene.objects[instances.sceneIndices[gl_InstanceIndex]];
+  gl_Position = push.lightViewProjection * gameObject.modelMatrix * vec4(position, 1.0);
+}
@@ -15,31 +15,43 @@ layout(location = 2) out vec3 fragNormalWorld;
 layout(location = 3) out vec2 fragUv;
 layout(location = 4) out mat3 TBN; 
 
-struct PointLight {
-  vec4 position; // ignore w
-  vec4 color; // w is intensity
-};
+// must match depth_prepass.vert exactly for the EQUAL depth test after a pre-pass
+invariant gl_Position;
 
 layout(set = 0, binding = 0) uniform GlobalUbo {
   mat4 projection;
   mat4 view;
   mat4 invView;
   vec4 ambientLightColor; // w is intensity
-  PointLight pointLights[10];
+  vec4 clusterDepth; // near, far, slice scale, slice bias
+  vec2 screenSize;
   int numLights;
+  int clusterDebug;
+  vec4 sunDirection; // towards the sun, w is intensity
+  vec4 sunColor;
+  int sunShadowView; // -1 if the sun casts no shadows
 } ubo;
 
-layout(set = 1, binding = 0) uniform GameObjectBufferData {
+// GPU scene, one record per game object
+struct GameObjectData {
   mat4 modelMatrix;
   mat4 normalMatrix;
-} gameObject;
+  vec4 boundingSphere; // world space, w is the radius
+  uint materialIndex;
+};
 
-layout(push_constant) uniform Push {
-  mat4 modelMatrix;
-  mat4 normalMatrix;
-} push;
+layout(std430, set = 1, binding = 0) readonly buffer SceneBuffer {
+  GameObjectData objects[];
+} scene;
+
+// scene index of every instance, batches are contiguous runs starting at firstInstance
+layout(std430, set = 1, binding = 1) readonly buffer InstanceBuffer {
+  uint sceneIndices[];
+} instances;
 
 void main() {
+  GameObjectData gameObject = scene.objects[instances.sceneIndices[gl_InstanceIndex]];
+
   vec4 positionWorld = gameObject.modelMatrix * vec4(position, 1.0);
   gl_Position = ubo.projection * ubo.view * positionWorld;
 
@@ -0,0 +1,41 @@
+#version 450
+
+// the environment behind the scene, with the scene's intensity, tonemapping and gamma
+layout (location = 0) out vec4 outColor;
+
+layout(set = 0, binding = 0) uniform GlobalUbo {
+  mat4 projection;
+  mat4 view;
+  mat4 invView;
+  vec4 ambientLightColor; // w is intensity
+  vec4 clusterDepth; // near, far, slice scale, slice bias
+  vec2 screenSize;
+  int numLights;
+  int clusterDebug;
+  vec4 sunDirection; // towards the sun, w is intensity
+  vec4 sunColor;
+  int sunShadowView; // -1 if the sun casts no shadows
+} ubo;
+
+layout(set = 0, binding = 7) uniform samplerCube specularMap;
+
+vec3 ACESFittedTonemap(vec3 color) {
+    const float a = 2.51;
+    const float b = 0.03;
+    const float c = 2.43;
+    const float d = 0.59;
+    const float e = 0.14;
+    return clamp((color * (a * color + b)) / (color * (c * color + d) + e), 0.0, 1.0);
+}
+
+void main() {
+  vec2 ndc = gl_FragCoord.xy / ubo.screenSize * 2.0 - 1.0;
+  vec3 viewDirection = vec3(ndc.x / ubo.projection[0][0], ndc.y / ubo.projection[1][1], 1.0);
+  vec3 direction = normalize(mat3(ubo.invView) * viewDirection);
+
+  vec3 color = textureLod(specularMap, direction, 0.0).rgb * ubo.ambientLightColor.xyz *
+               ubo.ambientLightColor.w;
+  color = ACESFittedTonemap(color);
+  color = pow(color, vec3(1.0 / 1.2));
+  outColor = vec4(color, 1.0);
+}
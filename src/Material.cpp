@@ -0,0 +1,47 @@
+#include "Material.hpp"
+
+// std
+#include <utility>
+
+namespace burnhope {
+
+void Material::setDiffuseMap(std::shared_ptr<BurnhopeTexture> texture) {
+  diffuseMap = std::move(texture);
+  version++;
+}
+
+void Material::setNormalMap(std::shared_ptr<BurnhopeTexture> texture) {
+  normalMap = std::move(texture);
+  version++;
+}
+
+void Material::setAOMap(std::shared_ptr<BurnhopeTexture> texture) {
+  AOMap = std::move(texture);
+  version++;
+}
+
+void Material::setRoughnessMap(std::shared_ptr<BurnhopeTexture> texture) {
+  RoughnessMap = std::move(texture);
+  version++;
+}
+
+void Material::setMetallicMap(std::shared_ptr<BurnhopeTexture> texture) {
+  MetallicMap = std::move(texture);
+  version++;
+}
+
+uint32_t Material::getFeatures() const {
+  uint32_t features = 0;
+  if (normalMap != nullptr) {
+    features |= FEATURE_NORMAL_MAP;
+  }
+  if (AOMap != nullptr && RoughnessMap != nullptr && MetallicMap != nullptr) {
+    features |= FEATURE_ORM_MAPS;
+  }
+  if (tonemapping) {
+    features |= FEATURE_TONEMAP;
+  }
+  return features;
+}
+
+}  // namespace burnhope
@@ -5,15 +5,58 @@
 #include <glm/gtc/matrix_transform.hpp>
 
 // std
+#include <cstdint>
 #include <memory>
 #include <unordered_map>
 namespace burnhope {
+	// Texture slots go through setters so every change bumps the version, which lets render
+	// systems cache descriptor sets built from a material until it actually changes.
 	class Material {
 	 public:
+	  // shader features a material needs, which selects the pipeline variant it is drawn with
+	  enum Features : uint32_t {
+	    FEATURE_NORMAL_MAP = 1 << 0,
+	    // Set only when the ambient occlusion, roughness and metallic maps are all present; the
+	    // variant samples all three. A material missing any of them gets the shader's defaults
+	    // for all three (no occlusion, roughness 0.5, not metallic).
+	    FEATURE_ORM_MAPS = 1 << 1,
+	    FEATURE_TONEMAP = 1 << 2,
+	    FEATURE_BITS = 3,
+	  };
+
+	  const std::shared_ptr<BurnhopeTexture> &getDiffuseMap() const { return diffuseMap; }
+	  const std::shared_ptr<BurnhopeTexture> &getNormalMap() const { return normalMap; }
+	  const std::shared_ptr<BurnhopeTexture> &getAOMap() const { return AOMap; }
+	  const std::shared_ptr<BurnhopeTexture> &getRoughnessMap() const { return RoughnessMap; }
+	  const std::shared_ptr<BurnhopeTexture> &getMetallicMap() const { return MetallicMap; }
+
+	  void setDiffuseMap(std::shared_ptr<BurnhopeTexture> texture);
+	  void setNormalMap(std::shared_ptr<BurnhopeTexture> texture);
+	  void setAOMap(std::shared_ptr<BurnhopeTexture> texture);
+	  void setRoughnessMap(std::shared_ptr<BurnhopeTexture> texture);
+	  void setMetallicMap(std::shared_ptr<BurnhopeTexture> texture);
+
+	  // objects using this material lay down depth in a pre-pass first and are then shaded only
+	  // where their depth matches, so hidden fragments skip the PBR shader
+	  bool usesDepthPrePass() const { return depthPrePass; }
+	  void setDepthPrePass(bool enabled) { depthPrePass = enabled; }
+
+	  // normal and ORM maps count once set. Without them the shader uses the vertex normal and
+	  // constant ORM values instead of sampling defaults.
+	  uint32_t getFeatures() const;
+	  // off for materials whose output is already in display range, e.g. unlit ones
+	  void setTonemapping(bool enabled) { tonemapping = enabled; }
+
+	  uint64_t getVersion() const { return version; }
+
+	 private:
 	  std::shared_ptr<BurnhopeTexture> diffuseMap = nullptr;
 	  std::shared_ptr<BurnhopeTexture> normalMap = nullptr;
 	  std::shared_ptr<BurnhopeTexture> AOMap = nullptr;
 	  std::shared_ptr<BurnhopeTexture> RoughnessMap = nullptr;
 	  std::shared_ptr<BurnhopeTexture> MetallicMap = nullptr;
+	  bool depthPrePass = false;
+	  bool tonemapping = true;
+	  uint64_t version = 0;
 	};
-}  // namespace burnhope
\ No newline at end of file
+}  // namespace burnhope
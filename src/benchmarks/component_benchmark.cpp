@@ -0,0 +1,100 @@
+#include "component_benchmark.hpp"
+
+#include "lve_game_object.hpp"
+
+// std
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <unordered_map>
+
+namespace burnhope {
+
+namespace {
+
+constexpr uint32_t OBJECT_COUNT = 1000000;
+constexpr int PASSES = 10;
+
+// a game object as it was stored before the component store, one map node per object
+struct MapObject {
+  glm::vec3 color{};
+  TransformComponent transform{};
+  std::shared_ptr<BurnhopeModel> model{};
+  std::shared_ptr<Material> material;
+  std::shared_ptr<OccluderMesh> occluder{};
+  std::unique_ptr<PointLightComponent> pointLight = nullptr;
+};
+
+TransformComponent makeTransform(uint32_t i) {
+  TransformComponent transform{};
+  transform.translation = {static_cast<float>(i % 1000), 0.f, static_cast<float>(i / 1000)};
+  transform.rotation = {0.f, i * .001f, 0.f};
+  return transform;
+}
+
+// runs passFn PASSES times and returns nanoseconds per object and pass
+template <typename Fn>
+double measure(Fn &&passFn) {
+  auto start = std::chrono::high_resolution_clock::now();
+  for (int pass = 0; pass < PASSES; pass++) {
+    passFn();
+  }
+  auto end = std::chrono::high_resolution_clock::now();
+  double ns = std::chrono::duration<double, std::nano>(end - start).count();
+  return ns / (static_cast<double>(OBJECT_COUNT) * PASSES);
+}
+
+}  // namespace
+
+void runComponentBenchmark() {
+  // both get a material allocation per object, like createGameObject
+  std::unordered_map<uint32_t, MapObject> objects;
+  BurnhopeComponentStore store{};
+  store.transforms.reserve(OBJECT_COUNT);
+  store.materials.reserve(OBJECT_COUNT);
+  for (uint32_t i = 0; i < OBJECT_COUNT; i++) {
+    MapObject object{};
+    object.transform = makeTransform(i);
+    object.material = std::make_shared<Material>();
+    objects.emplace(i, std::move(object));
+
+    store.transforms.add(i, makeTransform(i));
+    store.materials.add(i, std::make_shared<Material>());
+  }
+
+  // the checksums keep the passes from being optimized away and show both did the same work
+  float mapSum = 0.f;
+  float storeSum = 0.f;
+  double mapUpdate = measure([&]() {
+    for (auto &kv : objects) {
+      kv.second.transform.translation.y += .001f;
+    }
+  });
+  double storeUpdate = measure([&]() {
+    for (auto &transform : store.transforms.components()) {
+      transform.translation.y += .001f;
+    }
+  });
+  double mapMatrices = measure([&]() {
+    for (auto &kv : objects) {
+      mapSum += kv.second.transform.mat4()[3].y;
+    }
+  });
+  double storeMatrices = measure([&]() {
+    for (const auto &transform : store.transforms.components()) {
+      storeSum += transform.mat4()[3].y;
+    }
+  });
+
+  std::cout << "component benchmark, " << OBJECT_COUNT << " transforms:" << std::endl;
+  std::cout << "\tupdate: " << mapUpdate << " ns/object map, " << storeUpdate
+            << " ns/object store (" << mapUpdate / storeUpdate << "x)" << std::endl;
+  std::cout << "\tmatrices: " << mapMatrices << " ns/object map, " << storeMatrices
+            << " ns/object store (" << mapMatrices / storeMatrices << "x)" << std::endl;
+  if (mapSum != storeSum) {
+    std::cout << "\twarning: checksums differ (" << mapSum << " vs " << storeSum << ")"
+              << std::endl;
+  }
+}
+
+}  // namespace burnhope
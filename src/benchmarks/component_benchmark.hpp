@@ -0,0 +1,10 @@
+#pragma once
+
+namespace burnhope {
+
+// Nanoseconds per object to update and to build the matrices of 1M transforms, walking the
+// packed transform array of BurnhopeComponentStore versus an unordered_map of whole objects,
+// the layout game objects had before the store. CPU only, no device is created.
+void runComponentBenchmark();
+
+}  // namespace burnhope
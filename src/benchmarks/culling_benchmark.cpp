@@ -0,0 +1,70 @@
+#include "culling_benchmark.hpp"
+
+#include "lve_camera.hpp"
+#include "lve_frustum_culler.hpp"
+
+// std
+#include <chrono>
+#include <iostream>
+#include <random>
+
+namespace burnhope {
+
+namespace {
+
+// runs cullFn until about 20M spheres have been tested and returns spheres per microsecond
+template <typename Fn>
+double measure(size_t count, Fn &&cullFn) {
+  const size_t repetitions = count >= 20000000 ? 1 : 20000000 / count;
+  auto start = std::chrono::high_resolution_clock::now();
+  for (size_t r = 0; r < repetitions; r++) {
+    cullFn();
+  }
+  auto end = std::chrono::high_resolution_clock::now();
+  double us = std::chrono::duration<double, std::micro>(end - start).count();
+  return static_cast<double>(count * repetitions) / us;
+}
+
+}  // namespace
+
+void runCullingBenchmark() {
+  BurnhopeCamera camera{};
+  camera.setPerspectiveProjection(glm::radians(50.f), 4.f / 3.f, 0.1f, 100.f);
+  camera.setViewDirection(glm::vec3{0.f}, glm::vec3{0.f, 0.f, 1.f});
+  const auto planes = camera.getFrustumPlanes();
+
+  std::mt19937 rng{1234};
+  std::uniform_real_distribution<float> position{-100.f, 100.f};
+  std::uniform_real_distribution<float> radius{0.1f, 2.f};
+
+  std::cout << "frustum culling benchmark (" << BurnhopeFrustumCuller::instructionSet()
+            << "):" << std::endl;
+  for (size_t count : {10000u, 100000u, 1000000u}) {
+    BoundingSphereArray spheres{};
+    spheres.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+      spheres.push_back({position(rng), position(rng), position(rng), radius(rng)});
+    }
+
+    std::vector<uint32_t> visible;
+    visible.reserve(count);
+    double simd = measure(count, [&]() {
+      visible.clear();
+      BurnhopeFrustumCuller::cull(spheres, planes, visible);
+    });
+    size_t simdVisible = visible.size();
+    double scalar = measure(count, [&]() {
+      visible.clear();
+      BurnhopeFrustumCuller::cullScalar(spheres, planes, visible);
+    });
+    if (visible.size() != simdVisible) {
+      std::cout << "\twarning: simd and scalar results differ (" << simdVisible << " vs "
+                << visible.size() << ")" << std::endl;
+    }
+
+    std::cout << "\t" << count << " objects, " << simdVisible << " visible: " << simd
+              << " objects/us simd, " << scalar << " objects/us scalar" << std::endl;
+  }
+}
+
+}  // namespace burnhope
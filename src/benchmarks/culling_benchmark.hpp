@@ -0,0 +1,9 @@
+#pragma once
+
+namespace burnhope {
+
+// Objects frustum culled per microsecond for 10k to 1M random bounding spheres, comparing the
+// SIMD path of BurnhopeFrustumCuller with its scalar loop. CPU only, no device is created.
+void runCullingBenchmark();
+
+}  // namespace burnhope
@@ -0,0 +1,131 @@
+#include "descriptor_benchmark.hpp"
+
+#include "lve_descriptors.hpp"
+#include "lve_texture.hpp"
+
+// std
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+
+namespace burnhope {
+
+namespace {
+
+constexpr uint32_t BINDING_COUNT = 6;
+
+struct BenchmarkDescriptorData {
+  VkDescriptorImageInfo images[BINDING_COUNT];
+};
+
+std::unique_ptr<BurnhopeDescriptorSetLayout> createLayout(
+    BurnhopeDevice &device, bool pushDescriptor) {
+  BurnhopeDescriptorSetLayout::Builder builder{device};
+  for (uint32_t binding = 0; binding < BINDING_COUNT; binding++) {
+    builder.addBinding(
+        binding,
+        VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+        VK_SHADER_STAGE_FRAGMENT_BIT);
+  }
+  builder.setPushDescriptor(pushDescriptor);
+  return builder.build();
+}
+
+template <typename Fn>
+void timeMode(const char *name, int draws, Fn &&drawFn) {
+  auto start = std::chrono::high_resolution_clock::now();
+  for (int i = 0; i < draws; i++) {
+    drawFn();
+  }
+  auto end = std::chrono::high_resolution_clock::now();
+  double ns = std::chrono::duration<double, std::nano>(end - start).count();
+  std::cout << "\t" << name << ": " << ns / draws << " ns/draw" << std::endl;
+}
+
+}  // namespace
+
+void runDescriptorBenchmark(BurnhopeDevice &device, int draws) {
+  BurnhopeTexture texture{
+      device,
+      VK_FORMAT_R8G8B8A8_UNORM,
+      {4, 4, 1},
+      VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+      VK_SAMPLE_COUNT_1_BIT};
+  BenchmarkDescriptorData data{};
+  for (auto &image : data.images) {
+    image = texture.getImageInfo();
+  }
+
+  auto setLayout = createLayout(device, false);
+  auto pool = BurnhopeDescriptorPool::Builder(device)
+                  .setMaxSets(1)
+                  .addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, BINDING_COUNT)
+                  .build();
+  VkDescriptorSet set;
+  if (!pool->allocateDescriptor(*setLayout, set)) {
+    throw std::runtime_error("failed to allocate benchmark descriptor set!");
+  }
+
+  std::cout << "descriptor benchmark, " << BINDING_COUNT << " image descriptors, " << draws
+            << " draws:" << std::endl;
+
+  timeMode("vkUpdateDescriptorSets", draws, [&]() {
+    BurnhopeDescriptorWriter writer{*setLayout, *pool};
+    for (uint32_t binding = 0; binding < BINDING_COUNT; binding++) {
+      writer.writeImage(binding, &data.images[binding]);
+    }
+    writer.overwrite(set);
+  });
+
+  if (setLayout->hasUpdateTemplate()) {
+    timeMode("update template", draws, [&]() { setLayout->updateWithTemplate(set, &data); });
+  } else {
+    std::cout << "\tupdate template: not supported" << std::endl;
+  }
+
+  if (!device.supportsPushDescriptors()) {
+    std::cout << "\tpush descriptors: not supported" << std::endl;
+    return;
+  }
+
+  auto pushLayout = createLayout(device, true);
+  VkDescriptorSetLayout pushSetLayout = pushLayout->getDescriptorSetLayout();
+  VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+  pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+  pipelineLayoutInfo.setLayoutCount = 1;
+  pipelineLayoutInfo.pSetLayouts = &pushSetLayout;
+  VkPipelineLayout pipelineLayout;
+  if (vkCreatePipelineLayout(device.device(), &pipelineLayoutInfo, nullptr, &pipelineLayout) !=
+      VK_SUCCESS) {
+    throw std::runtime_error("failed to create pipeline layout!");
+  }
+
+  // recorded only, the command buffer is freed without being submitted
+  VkCommandBufferAllocateInfo allocInfo{};
+  allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+  allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+  allocInfo.commandPool = device.getCommandPool();
+  allocInfo.commandBufferCount = 1;
+  VkCommandBuffer commandBuffer;
+  vkAllocateCommandBuffers(device.device(), &allocInfo, &commandBuffer);
+
+  VkCommandBufferBeginInfo beginInfo{};
+  beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+  vkBeginCommandBuffer(commandBuffer, &beginInfo);
+
+  timeMode("push descriptors", draws, [&]() {
+    BurnhopeDescriptorWriter writer{*pushLayout};
+    for (uint32_t binding = 0; binding < BINDING_COUNT; binding++) {
+      writer.writeImage(binding, &data.images[binding]);
+    }
+    writer.push(commandBuffer, pipelineLayout, 0);
+  });
+
+  vkEndCommandBuffer(commandBuffer);
+  vkFreeCommandBuffers(device.device(), device.getCommandPool(), 1, &commandBuffer);
+  vkDestroyPipelineLayout(device.device(), pipelineLayout, nullptr);
+}
+
+}  // namespace burnhope
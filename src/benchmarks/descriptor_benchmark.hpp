@@ -0,0 +1,12 @@
+#pragma once
+
+#include "lve_device.hpp"
+
+namespace burnhope {
+
+// CPU cost of writing one 6-texture material set per draw, comparing vkUpdateDescriptorSets
+// through BurnhopeDescriptorWriter, descriptor update templates and push descriptors. Modes the
+// device does not support are skipped. Nothing is submitted to the GPU.
+void runDescriptorBenchmark(BurnhopeDevice &device, int draws = 100000);
+
+}  // namespace burnhope
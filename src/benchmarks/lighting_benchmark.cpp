@@ -0,0 +1,40 @@
+#include "lighting_benchmark.hpp"
+
+#include "first_app.hpp"
+
+// std
+#include <iostream>
+
+namespace burnhope {
+
+void runLightingBenchmark(int frames) {
+  std::cout << "lighting benchmark (" << frames << " frames, " << FirstApp::WIDTH << "x"
+            << FirstApp::HEIGHT << "):" << std::endl;
+  for (int lightCount : {1, 10, 100, 1000}) {
+    for (bool deferred : {false, true}) {
+      AppConfig config{};
+      config.headless = true;
+      config.headlessFrames = frames;
+      config.vaseCount = 400;
+      // the scene always has one light of its own
+      config.extraLights = lightCount - 1;
+      config.deferred = deferred;
+
+      RunStats stats{};
+      {
+        FirstApp app{config};
+        app.run();
+        stats = app.getRunStats();
+      }
+      std::cout << "\t" << lightCount << " lights, " << (deferred ? "deferred" : "forward")
+                << ": " << stats.cpuMillisecondsPerFrame << " ms/frame cpu, ";
+      if (stats.gpuMillisecondsPerFrame > 0.0) {
+        std::cout << stats.gpuMillisecondsPerFrame << " ms/frame gpu" << std::endl;
+      } else {
+        std::cout << "no gpu timings" << std::endl;
+      }
+    }
+  }
+}
+
+}  // namespace burnhope
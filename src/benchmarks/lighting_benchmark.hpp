@@ -0,0 +1,10 @@
+#pragma once
+
+namespace burnhope {
+
+// Frame time of forward and deferred shading with 1, 10, 100 and 1000 point lights, each run
+// as a headless FirstApp over a vase grid so there is overdraw to shade. Reports CPU and, where
+// timestamps are supported, GPU milliseconds per frame.
+void runLightingBenchmark(int frames = 300);
+
+}  // namespace burnhope
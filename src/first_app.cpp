@@ -3,8 +3,17 @@
 #include "keyboard_movement_controller.hpp"
 #include "lve_buffer.hpp"
 #include "lve_camera.hpp"
+#include "lve_gpu_timer.hpp"
+#include "lve_ibl.hpp"
+#include "lve_occlusion_culler.hpp"
+#include "lve_render_queue.hpp"
+#include "systems/deferred_render_system.hpp"
+#include "systems/gpu_cull_system.hpp"
+#include "systems/light_cluster_system.hpp"
 #include "systems/point_light_system.hpp"
+#include "systems/shadow_system.hpp"
 #include "systems/simple_render_system.hpp"
+#include "systems/skybox_system.hpp"
 
 // libs
 #define GLM_FORCE_RADIANS
@@ -13,19 +22,43 @@
 #include <glm/gtc/constants.hpp>
 
 // std
+#include <algorithm>
 #include <array>
 #include <cassert>
 #include <chrono>
+#include <cmath>
 #include <iostream>
 #include <stdexcept>
 
 namespace burnhope {
 
-FirstApp::FirstApp() {
+FirstApp::FirstApp(const AppConfig &config)
+    : config{config},
+      lveWindow{
+          config.headless ? nullptr
+                          : std::make_unique<BurnhopeWindow>(WIDTH, HEIGHT, "Vulkan Tutorial")},
+      lveDevice{lveWindow.get()} {
+  if (config.headless) {
+    lveRenderer = std::make_unique<BurnhopeRenderer>(
+        lveDevice,
+        VkExtent2D{static_cast<uint32_t>(WIDTH), static_cast<uint32_t>(HEIGHT)});
+  } else {
+    lveRenderer = std::make_unique<BurnhopeRenderer>(*lveWindow, lveDevice);
+  }
+  lveRenderer->setRecordingThreads(config.recordingThreads);
+
   globalPool =
       BurnhopeDescriptorPool::Builder(lveDevice)
           .setMaxSets(BurnhopeSwapChain::MAX_FRAMES_IN_FLIGHT)
-          .addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, BurnhopeSwapChain::MAX_FRAMES_IN_FLIGHT)
+          .addPoolSize(
+              VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+              2 * BurnhopeSwapChain::MAX_FRAMES_IN_FLIGHT)
+          .addPoolSize(
+              VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+              4 * BurnhopeSwapChain::MAX_FRAMES_IN_FLIGHT)
+          .addPoolSize(
+              VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+              3 * BurnhopeSwapChain::MAX_FRAMES_IN_FLIGHT)
           .build();
 
   // build frame descriptor pools
@@ -44,6 +77,13 @@ FirstApp::FirstApp() {
 
 FirstApp::~FirstApp() {}
 
+bool FirstApp::shouldClose(int framesRendered) const {
+  if (config.headless) {
+    return framesRendered >= config.headlessFrames;
+  }
+  return lveWindow->shouldClose();
+}
+
 void FirstApp::run() {
   std::vector<std::unique_ptr<BurnhopeBuffer>> uboBuffers(BurnhopeSwapChain::MAX_FRAMES_IN_FLIGHT);
   for (int i = 0; i < uboBuffers.size(); i++) {
@@ -52,47 +92,166 @@ void FirstApp::run() {
         sizeof(GlobalUbo),
         1,
         VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+        MemoryUsage::CpuToGpu);
     uboBuffers[i]->map();
   }
 
+  // precomputed once, or loaded from its cache
+  BurnhopeIbl ibl{lveDevice, config.environmentPath};
+
+  // ubo, then the point lights, cluster light counts and cluster light lists, then the shadow
+  // views and the shadow atlas, then the environment's SH, specular map and BRDF LUT
+  const VkShaderStageFlags clusterStages =
+      VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT;
   auto globalSetLayout =
       BurnhopeDescriptorSetLayout::Builder(lveDevice)
-          .addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_ALL_GRAPHICS)
+          .addBinding(
+              0,
+              VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+              VK_SHADER_STAGE_ALL_GRAPHICS | VK_SHADER_STAGE_COMPUTE_BIT)
+          .addBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, clusterStages)
+          .addBinding(2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, clusterStages)
+          .addBinding(3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, clusterStages)
+          .addBinding(4, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT)
+          .addBinding(
+              5,
+              VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+              VK_SHADER_STAGE_FRAGMENT_BIT)
+          .addBinding(6, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT)
+          .addBinding(
+              7,
+              VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+              VK_SHADER_STAGE_FRAGMENT_BIT)
+          .addBinding(
+              8,
+              VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+              VK_SHADER_STAGE_FRAGMENT_BIT)
           .build();
+  LightClusterSystem lightClusterSystem{lveDevice, globalSetLayout->getDescriptorSetLayout()};
+  ShadowSystem shadowSystem{lveDevice};
+  shadowSystem.setSun({.4f, -1.f, .3f}, {1.f, .95f, .85f}, .5f);
+  auto shadowAtlasInfo = shadowSystem.getAtlasInfo();
+  auto environmentInfo = ibl.getEnvironmentBufferInfo();
+  auto specularInfo = ibl.getSpecularInfo();
+  auto brdfLutInfo = ibl.getBrdfLutInfo();
 
   std::vector<VkDescriptorSet> globalDescriptorSets(BurnhopeSwapChain::MAX_FRAMES_IN_FLIGHT);
   for (int i = 0; i < globalDescriptorSets.size(); i++) {
     auto bufferInfo = uboBuffers[i]->descriptorInfo();
+    auto lightInfo = lightClusterSystem.getLightBufferInfo(i);
+    auto clusterInfo = lightClusterSystem.getClusterBufferInfo(i);
+    auto lightIndexInfo = lightClusterSystem.getLightIndexBufferInfo(i);
+    auto shadowViewInfo = shadowSystem.getViewBufferInfo(i);
     BurnhopeDescriptorWriter(*globalSetLayout, *globalPool)
         .writeBuffer(0, &bufferInfo)
+        .writeBuffer(1, &lightInfo)
+        .writeBuffer(2, &clusterInfo)
+        .writeBuffer(3, &lightIndexInfo)
+        .writeBuffer(4, &shadowViewInfo)
+        .writeImage(5, &shadowAtlasInfo)
+        .writeBuffer(6, &environmentInfo)
+        .writeImage(7, &specularInfo)
+        .writeImage(8, &brdfLutInfo)
         .build(globalDescriptorSets[i]);
   }
 
   std::cout << "Alignment: " << lveDevice.properties.limits.minUniformBufferOffsetAlignment << "\n";
   std::cout << "atom size: " << lveDevice.properties.limits.nonCoherentAtomSize << "\n";
+  lveDevice.memoryTracker().logReport();
 
+  std::unique_ptr<DeferredRenderSystem> deferredRenderSystem;
+  if (config.deferred) {
+    deferredRenderSystem = std::make_unique<DeferredRenderSystem>(
+        lveDevice,
+        lveRenderer->getSwapChainRenderPass(),
+        globalSetLayout->getDescriptorSetLayout(),
+        lveRenderer->getRenderExtent());
+    if (config.depthPrePass) {
+      std::cout << "the deferred path fills depth in its geometry pass, ignoring depth pre-pass\n";
+    }
+  }
+  // the swapchain render pass is recreated on resize, so it is looked up when it is needed
+  SimpleRenderSystem::RenderPassFn shadingRenderPass = [this]() {
+    return lveRenderer->getSwapChainRenderPass();
+  };
+  if (deferredRenderSystem) {
+    shadingRenderPass = [&deferredRenderSystem]() {
+      return deferredRenderSystem->getGeometryRenderPass();
+    };
+  }
   SimpleRenderSystem simpleRenderSystem{
       lveDevice,
-      lveRenderer.getSwapChainRenderPass(),
-      globalSetLayout->getDescriptorSetLayout()};
+      shadingRenderPass,
+      globalSetLayout->getDescriptorSetLayout(),
+      config.deferred};
+  simpleRenderSystem.prewarmPipelines(gameObjectManager.components);
   PointLightSystem pointLightSystem{
       lveDevice,
-      lveRenderer.getSwapChainRenderPass(),
+      lveRenderer->getSwapChainRenderPass(),
+      globalSetLayout->getDescriptorSetLayout()};
+  SkyboxSystem skyboxSystem{
+      lveDevice,
+      lveRenderer->getSwapChainRenderPass(),
       globalSetLayout->getDescriptorSetLayout()};
   BurnhopeCamera camera{};
+  BurnhopeRenderQueue renderQueue{lveDevice};
+  std::unique_ptr<GpuCullSystem> gpuCullSystem;
+  if (config.gpuDriven) {
+    if (GpuCullSystem::isSupported(lveDevice)) {
+      gpuCullSystem = std::make_unique<GpuCullSystem>(lveDevice);
+    } else {
+      std::cout << "gpu driven rendering needs drawIndirectFirstInstance, using cpu draws\n";
+    }
+  }
+  std::unique_ptr<BurnhopeOcclusionCuller> occlusionCuller;
+  if (config.occlusionCulling) {
+    if (gpuCullSystem) {
+      std::cout << "occlusion culling only applies to cpu draws, ignoring it\n";
+    } else {
+      occlusionCuller = std::make_unique<BurnhopeOcclusionCuller>();
+    }
+  }
 
-  auto& viewerObject = gameObjectManager.createGameObject();
-  viewerObject.transform.translation.z = -2.5f;
+  // scope 0 is the swapchain render pass, scope 1 the whole frame
+  BurnhopeGpuTimer gpuTimer{lveDevice, 2};
+  if (!gpuTimer.isSupported()) {
+    std::cout << "timestamp queries not supported, no gpu timings\n";
+  }
+
+  auto viewerObject = gameObjectManager.createGameObject();
+  viewerObject.transform().translation.z = -2.5f;
   KeyboardMovementController cameraController{};
 
   auto currentTime = std::chrono::high_resolution_clock::now();
   // Переменные для FPS
   int frameCount = 0;
+  int framesRendered = 0;
+  BufferWriteStats bufferStats{};
+  DescriptorStats descriptorStats{};
+  DrawStats drawStats{};
+  BurnhopeRenderQueue::Stats queueStats{};
+  BurnhopeOcclusionCuller::Stats occlusionStats{};
+  LightClusterSystem::Stats clusterStats{};
+  PointLightSystem::BillboardStats billboardStats{};
+  ShadowSystem::Stats shadowStats{};
+  std::vector<PointLight> lights;
+  std::vector<BurnhopeCommandThreadPool::ThreadStats> recordingStats;
   auto fpsTimer = currentTime;
+  // run stats, gpu times are weighted by the frames of each logging interval
+  auto runStart = currentTime;
+  double gpuFrameMilliseconds = 0.0;
+  int gpuTimedFrames = 0;
+  auto collectGpuTimes = [&]() {
+    std::vector<double> averages = gpuTimer.takeAverages();
+    gpuFrameMilliseconds += averages[1] * frameCount;
+    gpuTimedFrames += frameCount;
+    return averages;
+  };
 
-  while (!lveWindow.shouldClose()) {
-    glfwPollEvents();
+  while (!shouldClose(framesRendered)) {
+    if (!config.headless) {
+      glfwPollEvents();
+    }
 
     auto newTime = std::chrono::high_resolution_clock::now();
     float frameTime =
@@ -102,19 +261,101 @@ void FirstApp::run() {
     frameCount++;
     float timeSinceLastFpsUpdate = std::chrono::duration<float>(newTime - fpsTimer).count();
     if (timeSinceLastFpsUpdate >= 1.0f) {
-      std::cout << "FPS: " << frameCount << std::endl;
+      std::cout << "FPS: " << frameCount << ", buffer bytes written/flushed per frame: "
+                << bufferStats.bytesWritten / frameCount << "/"
+                << bufferStats.bytesFlushed / frameCount << " in "
+                << bufferStats.flushCalls / frameCount << " flushes" << std::endl;
+      std::cout << "descriptor sets allocated/writes per frame: "
+                << descriptorStats.setsAllocated / frameCount << "/"
+                << descriptorStats.descriptorWrites / frameCount << ", frame pool high water: "
+                << framePools[0]->getStats().highWaterSets << " sets in "
+                << framePools[0]->getStats().highWaterPools << " pools" << std::endl;
+      std::cout << "draws per frame: " << drawStats.draws / frameCount << " for "
+                << drawStats.objects / frameCount << " objects, "
+                << drawStats.culled / frameCount << " culled, "
+                << simpleRenderSystem.getPipelineVariantCount() << " shading variants" << std::endl;
+      std::cout << "binds saved per frame: " << queueStats.bindsSaved() / frameCount
+                << " (pipeline " << queueStats.pipelineBindsSaved / frameCount << ", sets "
+                << queueStats.descriptorSetBindsSaved / frameCount << ", vertex buffers "
+                << queueStats.vertexBufferBindsSaved / frameCount << ")" << std::endl;
+      if (gpuTimer.isSupported()) {
+        std::vector<double> gpuTimes = collectGpuTimes();
+        std::cout << "gpu render pass: " << gpuTimes[0] << " ms, frame " << gpuTimes[1]
+                  << " ms, " << (config.deferred ? "deferred" : "forward")
+                  << " shading, depth pre-pass " << (config.depthPrePass ? "on" : "off") << " ("
+                  << drawStats.prePassDraws / frameCount << " draws)" << std::endl;
+      }
+      clusterStats += lightClusterSystem.takeStats();
+      if (clusterStats.frames > 0) {
+        std::cout << "lights per cluster: "
+                  << clusterStats.occupiedClusters / clusterStats.frames << " of "
+                  << LightClusterSystem::CLUSTER_COUNT << " clusters lit, avg "
+                  << clusterStats.averagePerOccupiedCluster() << ", max "
+                  << clusterStats.maxLightsPerCluster << " for " << lights.size()
+                  << " lights, " << clusterStats.overflowedClusters / clusterStats.frames
+                  << " clusters over " << LightClusterSystem::MAX_LIGHTS_PER_CLUSTER
+                  << std::endl;
+      }
+      std::cout << "light billboards per frame: " << billboardStats.lights / frameCount << ", "
+                << billboardStats.culled / frameCount << " outside the frustum, "
+                << billboardStats.draws / frameCount << " instanced draws" << std::endl;
+      shadowStats += shadowSystem.takeStats();
+      if (shadowStats.frames > 0) {
+        std::cout << "shadow views per frame: " << shadowStats.viewsRendered / shadowStats.frames
+                  << " rendered, " << shadowStats.viewsCached / shadowStats.frames
+                  << " cached, " << shadowStats.casters / shadowStats.frames << " casters in "
+                  << shadowStats.draws / shadowStats.frames << " draws" << std::endl;
+      }
+      if (occlusionCuller) {
+        uint32_t jobs = std::max(occlusionStats.jobs, 1u);
+        std::cout << "occlusion: " << static_cast<int>(occlusionStats.hitRate() * 100.f)
+                  << "% of " << occlusionStats.tested / jobs << " objects occluded by "
+                  << occlusionStats.occluderTriangles / jobs << " triangles, worker "
+                  << occlusionStats.rasterMicros / jobs << "us raster + "
+                  << occlusionStats.testMicros / jobs << "us test, render thread waited "
+                  << occlusionStats.waitMicros / jobs << "us" << std::endl;
+      }
+      if (config.churnPerFrame > 0) {
+        std::cout << "objects: " << gameObjectManager.getObjectCount() << " live, "
+                  << gameObjectManager.getIdCapacity() << " ids, scene buffer holds "
+                  << gameObjectManager.getSceneCapacity(0) << std::endl;
+      }
+      if (!recordingStats.empty()) {
+        std::cout << "recording us per frame by thread:";
+        for (const auto& threadStats : recordingStats) {
+          std::cout << " " << threadStats.recordMicros / frameCount;
+        }
+        std::cout << std::endl;
+      }
       frameCount = 0;
+      bufferStats = {};
+      descriptorStats = {};
+      drawStats = {};
+      queueStats = {};
+      occlusionStats = {};
+      clusterStats = {};
+      billboardStats = {};
+      shadowStats = {};
+      recordingStats.clear();
       fpsTimer = newTime;
     }
+    lveDevice.memoryTracker().tick(frameTime);
 
-    cameraController.moveInPlaneXZ(lveWindow.getGLFWwindow(), frameTime, viewerObject);
-    camera.setViewYXZ(viewerObject.transform.translation, viewerObject.transform.rotation);
+    if (!config.headless) {
+      cameraController.moveInPlaneXZ(lveWindow->getGLFWwindow(), frameTime, viewerObject);
+    }
+    camera.setViewYXZ(viewerObject.transform().translation, viewerObject.transform().rotation);
 
-    float aspect = lveRenderer.getAspectRatio();
+    float aspect = lveRenderer->getAspectRatio();
     camera.setPerspectiveProjection(glm::radians(50.f), aspect, 0.1f, 100.f);
 
-    if (auto commandBuffer = lveRenderer.beginFrame()) {
-      int frameIndex = lveRenderer.getFrameIndex();
+    // outside of the frame, scene indices must not move between updateBuffer and recording
+    churnGameObjects(framesRendered);
+
+    if (auto commandBuffer = lveRenderer->beginFrame()) {
+      int frameIndex = lveRenderer->getFrameIndex();
+      gpuTimer.beginFrame(commandBuffer, frameIndex);
+      gpuTimer.beginScope(commandBuffer, 1);
       framePools[frameIndex]->resetPool();
       FrameInfo frameInfo{
           frameIndex,
@@ -123,39 +364,161 @@ void FirstApp::run() {
           camera,
           globalDescriptorSets[frameIndex],
           *framePools[frameIndex],
-          gameObjectManager.gameObjects};
+          gameObjectManager.components};
 
       // update
       GlobalUbo ubo{};
       ubo.projection = camera.getProjection();
       ubo.view = camera.getView();
       ubo.inverseView = camera.getInverseView();
-      pointLightSystem.update(frameInfo, ubo);
-      uboBuffers[frameIndex]->writeToBuffer(&ubo);
-      uboBuffers[frameIndex]->flush();
+      ubo.clusterDebug = config.clusterDebug ? 1 : 0;
+      LightClusterSystem::updateUbo(camera, lveRenderer->getRenderExtent(), ubo);
+      pointLightSystem.update(frameInfo, ubo, lights);
+      frameInfo.lightCount = static_cast<uint32_t>(lights.size());
 
       // final step of update is updating the game objects buffer data
       // The render functions MUST not change a game objects transform data
       gameObjectManager.updateBuffer(frameIndex);
+      frameInfo.sceneBufferInfo = gameObjectManager.getSceneBufferInfo(frameIndex);
+      frameInfo.sceneBufferVersion = gameObjectManager.getSceneBufferVersion(frameIndex);
+      frameInfo.objectBounds = &gameObjectManager.getObjectBounds();
+      frameInfo.boundsOwners = &gameObjectManager.getBoundsOwners();
+
+      // shadow views depend on the final bounds, and mark the lights they belong to
+      shadowSystem.update(frameInfo, ubo, lights);
+      lightClusterSystem.update(frameInfo, lights);
+      uboBuffers[frameIndex]->writeToBuffer(&ubo);
+      uboBuffers[frameIndex]->flushDirtyRanges();
+      bufferStats += uboBuffers[frameIndex]->takeWriteStats();
+      lightClusterSystem.assignLights(frameInfo);
+      bufferStats += gameObjectManager.sceneBuffers[frameIndex]->takeWriteStats();
+      if (gpuCullSystem) {
+        gpuCullSystem->cull(frameInfo, gameObjectManager.getStructureVersion());
+      }
+      if (occlusionCuller) {
+        occlusionCuller->begin(
+            camera.getProjection() * camera.getView(),
+            camera.getFrustumPlanes(),
+            gameObjectManager.getObjectBounds(),
+            gameObjectManager.components,
+            gameObjectManager.getBoundsOwners());
+        frameInfo.occlusionCuller = occlusionCuller.get();
+      }
 
       // render
-      lveRenderer.beginSwapChainRenderPass(commandBuffer);
+      shadowSystem.render(frameInfo);
+      auto renderSceneObjects = [&]() {
+        if (gpuCullSystem) {
+          simpleRenderSystem.renderGameObjectsIndirect(frameInfo, renderQueue, *gpuCullSystem);
+        } else {
+          simpleRenderSystem.renderGameObjects(frameInfo, renderQueue);
+        }
+      };
+      // the G-buffer pass is recorded inline, before the swapchain pass composites it
+      if (deferredRenderSystem) {
+        deferredRenderSystem->resize(lveRenderer->getRenderExtent());
+        deferredRenderSystem->beginGeometryPass(frameInfo);
+        renderQueue.reset();
+        renderSceneObjects();
+        renderQueue.sort();
+        renderQueue.execute(commandBuffer);
+        queueStats += renderQueue.takeStats();
+        deferredRenderSystem->renderLighting(frameInfo);
+      }
+      gpuTimer.beginScope(commandBuffer, 0);
+      lveRenderer->beginSwapChainRenderPass(commandBuffer);
+
+      // systems only submit packets, the queue's sort keys decide the draw order. Lights go
+      // first so they overlap with occlusion culling.
+      renderQueue.reset();
+      pointLightSystem.render(frameInfo, renderQueue);
+      skyboxSystem.render(frameInfo, renderQueue);
+      if (deferredRenderSystem) {
+        deferredRenderSystem->submitComposite(frameInfo, renderQueue);
+      } else {
+        renderSceneObjects();
+      }
+      renderQueue.sort();
+      if (lveRenderer->recordsInSecondaryBuffers()) {
+        lveRenderer->recordSecondaryCommandBuffers(
+            commandBuffer,
+            [&](uint32_t rangeIndex, uint32_t rangeCount, VkCommandBuffer secondaryBuffer) {
+              renderQueue.executeRange(secondaryBuffer, rangeIndex, rangeCount);
+            });
+      } else {
+        renderQueue.execute(commandBuffer);
+      }
+      descriptorStats += simpleRenderSystem.takeDescriptorStats();
+      drawStats += simpleRenderSystem.takeDrawStats();
+      queueStats += renderQueue.takeStats();
+      billboardStats += pointLightSystem.takeBillboardStats();
+      if (occlusionCuller) {
+        occlusionStats += occlusionCuller->takeStats();
+      }
+      auto frameRecordingStats = lveRenderer->takeRecordingStats();
+      recordingStats.resize(frameRecordingStats.size());
+      for (size_t i = 0; i < frameRecordingStats.size(); i++) {
+        recordingStats[i].buffersRecorded += frameRecordingStats[i].buffersRecorded;
+        recordingStats[i].recordMicros += frameRecordingStats[i].recordMicros;
+      }
+
+      lveRenderer->endSwapChainRenderPass(commandBuffer);
+      gpuTimer.endScope(commandBuffer, 0);
+      gpuTimer.endScope(commandBuffer, 1);
+      lveRenderer->endFrame();
+      framesRendered++;
+      if (framesRendered == 1) {
+        runStart = std::chrono::high_resolution_clock::now();
+      }
+    }
+  }
 
-      // order here matters
-      simpleRenderSystem.renderGameObjects(frameInfo);
-      pointLightSystem.render(frameInfo);
+  vkDeviceWaitIdle(lveDevice.device());
 
-      lveRenderer.endSwapChainRenderPass(commandBuffer);
-      lveRenderer.endFrame();
+  runStats = {};
+  runStats.frames = framesRendered;
+  if (framesRendered > 1) {
+    auto runEnd = std::chrono::high_resolution_clock::now();
+    runStats.cpuMillisecondsPerFrame =
+        std::chrono::duration<double, std::milli>(runEnd - runStart).count() /
+        (framesRendered - 1);
+  }
+  if (gpuTimer.isSupported()) {
+    collectGpuTimes();
+    if (gpuTimedFrames > 0) {
+      runStats.gpuMillisecondsPerFrame = gpuFrameMilliseconds / gpuTimedFrames;
     }
   }
 
-  vkDeviceWaitIdle(lveDevice.device());
+  if (config.headless && !config.capturePath.empty()) {
+    lveRenderer->captureFrame(config.capturePath);
+    std::cout << "Captured frame to " << config.capturePath << "\n";
+  }
 }
 int test = 0;
 
 
 
+void FirstApp::churnGameObjects(int frame) {
+  if (config.churnPerFrame <= 0) return;
+  size_t lifetimeObjects = static_cast<size_t>(config.churnPerFrame) * CHURN_LIFETIME;
+  while (churnObjects.size() + config.churnPerFrame > lifetimeObjects) {
+    gameObjectManager.destroyGameObject(churnObjects.front());
+    churnObjects.pop_front();
+  }
+
+  // a slowly turning ring behind the vases
+  for (int i = 0; i < config.churnPerFrame; i++) {
+    float angle = (frame * config.churnPerFrame + i) * .0137f;
+    auto vase = gameObjectManager.createGameObject();
+    vase.setModel(churnModel);
+    vase.setMaterial(churnMaterial);
+    vase.transform().translation = {3.f * std::cos(angle), .5f, 3.f + 3.f * std::sin(angle)};
+    vase.transform().scale = {.25f, .25f, .25f};
+    churnObjects.push_back(vase);
+  }
+}
+
 void FirstApp::loadGameObjects() {
   std::shared_ptr<BurnhopeTexture> diffuseTexture =
       BurnhopeTexture::createTextureFromFile(lveDevice, "../textures/diffuse2.png");
@@ -172,25 +535,51 @@ void FirstApp::loadGameObjects() {
       BurnhopeModel::createModelFromFile(lveDevice, "models/cube.obj");
 
   std::shared_ptr<Material> material = std::make_shared<Material>();
-  material->diffuseMap = diffuseTexture;
-  material->normalMap = normalTexture;
-  material->AOMap = aoTexture;
-  material->MetallicMap = metallicTexture;
-  material->RoughnessMap = rougnessTexture;
+  material->setDiffuseMap(diffuseTexture);
+  material->setNormalMap(normalTexture);
+  material->setAOMap(aoTexture);
+  material->setMetallicMap(metallicTexture);
+  material->setRoughnessMap(rougnessTexture);
+  material->setDepthPrePass(config.depthPrePass);
 
-  auto& flatVase = gameObjectManager.createGameObject();
+  auto flatVase = gameObjectManager.createGameObject();
 
-  flatVase.model = lveModel;
-  flatVase.material = material;
-  flatVase.transform.translation = {-.5f, .5f, 0.f};
-  flatVase.transform.scale = {0.5f, 0.5f, 0.5f};
+  flatVase.setModel(lveModel);
+  flatVase.setMaterial(material);
+  flatVase.transform().translation = {-.5f, .5f, 0.f};
+  flatVase.transform().scale = {0.5f, 0.5f, 0.5f};
 
   lveModel = BurnhopeModel::createModelFromFile(lveDevice, "models/smooth_vase.obj");
-  auto& smoothVase = gameObjectManager.createGameObject();
-  smoothVase.model = lveModel;
-  smoothVase.material = material;
-  smoothVase.transform.translation = {.5f, .5f, 0.f};
-  smoothVase.transform.scale = {3.f, 1.5f, 3.f};
+  churnModel = lveModel;
+  churnMaterial = material;
+  auto smoothVase = gameObjectManager.createGameObject();
+  smoothVase.setModel(lveModel);
+  smoothVase.setMaterial(material);
+  smoothVase.transform().translation = {.5f, .5f, 0.f};
+  smoothVase.transform().scale = {3.f, 1.5f, 3.f};
+
+  // stress scene for instanced batching, every vase lands in the same (model, material) batch
+  int gridSize = static_cast<int>(std::ceil(std::sqrt(static_cast<float>(config.vaseCount))));
+  for (int i = 0; i < config.vaseCount; i++) {
+    auto vase = gameObjectManager.createGameObject();
+    vase.setModel(lveModel);
+    vase.setMaterial(material);
+    vase.transform().translation = {
+        (i % gridSize - gridSize / 2) * .25f,
+        .5f,
+        (i / gridSize) * .25f + 1.f};
+    vase.transform().scale = {.5f, .5f, .5f};
+  }
+
+  // a wall between the camera and the vases, its occluder box matches the cube model
+  if (config.occlusionCulling) {
+    auto wall = gameObjectManager.createGameObject();
+    wall.setModel(BurnhopeModel::createModelFromFile(lveDevice, "models/cube.obj"));
+    wall.setMaterial(material);
+    wall.setOccluder(OccluderMesh::createBox(glm::vec3{-1.f}, glm::vec3{1.f}));
+    wall.transform().translation = {0.f, 0.f, .75f};
+    wall.transform().scale = {std::max(gridSize * .15f, 1.5f), 1.f, .05f};
+  }
 
 
   std::vector<glm::vec3> lightColors{
@@ -199,13 +588,28 @@ void FirstApp::loadGameObjects() {
   };
 
   for (int i = 0; i < lightColors.size(); i++) {
-    auto& pointLight = gameObjectManager.makePointLight(10.0f);
-    pointLight.color = lightColors[i];
+    auto pointLight = gameObjectManager.makePointLight(10.0f, .1f, lightColors[i]);
     auto rotateLight = glm::rotate(
         glm::mat4(1.f),
         (i * glm::two_pi<float>()) / lightColors.size(),
         {0.f, -1.f, 0.f});
-    pointLight.transform.translation = glm::vec3(rotateLight * glm::vec4(-1.f, -1.f, -1.f, 1.f));
+    pointLight.transform().translation =
+        glm::vec3(rotateLight * glm::vec4(-1.f, -1.f, -1.f, 1.f));
+  }
+
+  // dim lights on a golden angle spiral over the vases, each one reaches a couple of units
+  for (int i = 0; i < config.extraLights; i++) {
+    float angle = i * 2.39996323f;
+    float distance = 4.f * std::sqrt((i + .5f) / config.extraLights);
+    glm::vec3 color{
+        .5f + .5f * std::cos(angle),
+        .5f + .5f * std::cos(angle + 2.094f),
+        .5f + .5f * std::cos(angle + 4.189f)};
+    auto pointLight = gameObjectManager.makePointLight(.05f, .02f, color);
+    pointLight.transform().translation = {
+        distance * std::cos(angle),
+        -.25f - .5f * (i % 3),
+        1.f + distance * std::sin(angle)};
   }
 }
 }  // namespace burnhope
@@ -7,33 +7,88 @@
 #include "lve_window.hpp"
 
 // std
+#include <deque>
 #include <memory>
+#include <string>
 #include <vector>
 
 namespace burnhope {
+
+struct AppConfig {
+  // render without a window into an offscreen target, e.g. for CI or benchmarks
+  bool headless = false;
+  // number of frames to render before exiting when headless
+  int headlessFrames = 1;
+  // if set, the last headless frame is written to this png file
+  std::string capturePath;
+  // if > 0, adds a grid of this many smooth vases sharing one model and material
+  int vaseCount = 0;
+  // cull and build draws on the GPU with compute + indirect draws, when the device supports it
+  bool gpuDriven = false;
+  // cpu occlusion culling on a worker thread, and a wall in front of the vases that hides them
+  bool occlusionCulling = false;
+  // if > 0, draws are recorded into secondary command buffers by this many threads
+  uint32_t recordingThreads = 0;
+  // lay down depth for the scene materials first and shade with an EQUAL depth test
+  bool depthPrePass = false;
+  // adds this many small point lights over the scene, to stress clustered shading and the light
+  // billboards. Lights past MAX_LIGHTS only get a billboard.
+  int extraLights = 0;
+  // shade the number of lights in each fragment's cluster instead of the scene
+  bool clusterDebug = false;
+  // shade from a G-buffer in a lighting pass instead of in the geometry draws
+  bool deferred = false;
+  // equirectangular HDR image lighting the scene and drawn as the sky. A procedural sky is used
+  // when it can't be read.
+  std::string environmentPath = "../textures/environment.hdr";
+  // spawns this many vases every frame and destroys each one CHURN_LIFETIME frames later, to
+  // check that id reuse and slot compaction keep the object table at a steady size
+  int churnPerFrame = 0;
+};
+
+// timings of a whole run, without the first frame, which creates most of the pipelines
+struct RunStats {
+  int frames = 0;
+  double cpuMillisecondsPerFrame = 0.0;
+  // 0 without timestamp queries
+  double gpuMillisecondsPerFrame = 0.0;
+};
+
 class FirstApp {
  public:
   static constexpr int WIDTH = 800;
   static constexpr int HEIGHT = 600;
+  static constexpr int CHURN_LIFETIME = 120;
 
-  FirstApp();
+  explicit FirstApp(const AppConfig &config = AppConfig{});
   ~FirstApp();
 
   FirstApp(const FirstApp &) = delete;
   FirstApp &operator=(const FirstApp &) = delete;
 
   void run();
+  // stats of the last run()
+  const RunStats &getRunStats() const { return runStats; }
 
  private:
   void loadGameObjects();
+  // spawns this frame's churn objects and destroys the expired ones
+  void churnGameObjects(int frame);
+  bool shouldClose(int framesRendered) const;
 
-  BurnhopeWindow lveWindow{WIDTH, HEIGHT, "Vulkan Tutorial"};
-  BurnhopeDevice lveDevice{lveWindow};
-  BurnhopeRenderer lveRenderer{lveWindow, lveDevice};
+  AppConfig config;
+  RunStats runStats{};
+  std::unique_ptr<BurnhopeWindow> lveWindow;
+  BurnhopeDevice lveDevice;
+  std::unique_ptr<BurnhopeRenderer> lveRenderer;
 
   // note: order of declarations matters
   std::unique_ptr<BurnhopeDescriptorPool> globalPool{};
   std::vector<std::unique_ptr<BurnhopeDescriptorPool>> framePools;
   BurnhopeGameObjectManager gameObjectManager{lveDevice};
+  // oldest first
+  std::deque<BurnhopeGameObject> churnObjects;
+  std::shared_ptr<BurnhopeModel> churnModel;
+  std::shared_ptr<Material> churnMaterial;
 };
 }  // namespace burnhope
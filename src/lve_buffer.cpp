@@ -8,6 +8,7 @@
 #include "lve_buffer.hpp"
 
 // std
+#include <algorithm>
 #include <cassert>
 #include <cstring>
 
@@ -44,12 +45,33 @@ BurnhopeBuffer::BurnhopeBuffer(
   alignmentSize = getAlignment(instanceSize, minOffsetAlignment);
   bufferSize = alignmentSize * instanceCount;
   device.createBuffer(bufferSize, usageFlags, memoryPropertyFlags, buffer, memory);
+  hostCoherent = device.memoryTracker().getPropertyFlags(memory) &
+                 VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+}
+
+BurnhopeBuffer::BurnhopeBuffer(
+    BurnhopeDevice &device,
+    VkDeviceSize instanceSize,
+    uint32_t instanceCount,
+    VkBufferUsageFlags usageFlags,
+    MemoryUsage memoryUsage,
+    VkDeviceSize minOffsetAlignment)
+    : lveDevice{device},
+      instanceSize{instanceSize},
+      instanceCount{instanceCount},
+      usageFlags{usageFlags} {
+  alignmentSize = getAlignment(instanceSize, minOffsetAlignment);
+  bufferSize = alignmentSize * instanceCount;
+  device.createBuffer(bufferSize, usageFlags, memoryUsage, buffer, memory);
+  // report the flags of the memory type that was picked, not the intent
+  memoryPropertyFlags = device.memoryTracker().getPropertyFlags(memory);
+  hostCoherent = memoryPropertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
 }
 
 BurnhopeBuffer::~BurnhopeBuffer() {
   unmap();
   vkDestroyBuffer(lveDevice.device(), buffer, nullptr);
-  vkFreeMemory(lveDevice.device(), memory, nullptr);
+  lveDevice.freeMemory(memory);
 }
 
 /**
@@ -97,6 +119,30 @@ void BurnhopeBuffer::writeToBuffer(void *data, VkDeviceSize size, VkDeviceSize o
     memOffset += offset;
     memcpy(memOffset, data, size);
   }
+  markDirty(size, offset);
+}
+
+/**
+ * Records a written range so flushDirtyRanges only flushes what changed
+ *
+ * @param size Size of the written range, VK_WHOLE_SIZE for the complete buffer
+ * @param offset Byte offset from beginning
+ */
+void BurnhopeBuffer::markDirty(VkDeviceSize size, VkDeviceSize offset) {
+  if (size == VK_WHOLE_SIZE) {
+    offset = 0;
+    size = bufferSize;
+  }
+  writeStats.bytesWritten += size;
+  if (hostCoherent) return;
+
+  // writes usually arrive in increasing order, so extend the last range when possible
+  if (!dirtyRanges.empty() && dirtyRanges.back().second >= offset &&
+      dirtyRanges.back().first <= offset) {
+    dirtyRanges.back().second = std::max(dirtyRanges.back().second, offset + size);
+  } else {
+    dirtyRanges.emplace_back(offset, offset + size);
+  }
 }
 
 /**
@@ -111,6 +157,10 @@ void BurnhopeBuffer::writeToBuffer(void *data, VkDeviceSize size, VkDeviceSize o
  * @return VkResult of the flush call
  */
 VkResult BurnhopeBuffer::flush(VkDeviceSize size, VkDeviceSize offset) {
+  if (hostCoherent) return VK_SUCCESS;
+
+  writeStats.bytesFlushed += size == VK_WHOLE_SIZE ? bufferSize - offset : size;
+  writeStats.flushCalls++;
   VkMappedMemoryRange mappedRange = {};
   mappedRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
   mappedRange.memory = memory;
@@ -119,6 +169,63 @@ VkResult BurnhopeBuffer::flush(VkDeviceSize size, VkDeviceSize offset) {
   return vkFlushMappedMemoryRanges(lveDevice.device(), 1, &mappedRange);
 }
 
+/**
+ * Flush every range written since the last call with a single vkFlushMappedMemoryRanges. Ranges
+ * are widened to nonCoherentAtomSize and overlapping or touching ranges are merged.
+ *
+ * @note Does nothing for host coherent memory
+ *
+ * @return VkResult of the flush call
+ */
+VkResult BurnhopeBuffer::flushDirtyRanges() {
+  if (dirtyRanges.empty()) return VK_SUCCESS;
+
+  const VkDeviceSize atomSize = lveDevice.properties.limits.nonCoherentAtomSize;
+  for (auto &range : dirtyRanges) {
+    range.first = range.first / atomSize * atomSize;
+    range.second = (range.second + atomSize - 1) / atomSize * atomSize;
+  }
+  std::sort(dirtyRanges.begin(), dirtyRanges.end());
+
+  std::vector<VkMappedMemoryRange> mappedRanges;
+  for (auto &range : dirtyRanges) {
+    if (!mappedRanges.empty() &&
+        mappedRanges.back().offset + mappedRanges.back().size >= range.first) {
+      auto &last = mappedRanges.back();
+      last.size = std::max(last.offset + last.size, range.second) - last.offset;
+      continue;
+    }
+    VkMappedMemoryRange mappedRange = {};
+    mappedRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+    mappedRange.memory = memory;
+    mappedRange.offset = range.first;
+    mappedRange.size = range.second - range.first;
+    mappedRanges.push_back(mappedRange);
+  }
+  dirtyRanges.clear();
+
+  for (auto &mappedRange : mappedRanges) {
+    // rounding up may run past the buffer, which is only valid as VK_WHOLE_SIZE
+    if (mappedRange.offset + mappedRange.size > bufferSize) {
+      writeStats.bytesFlushed += bufferSize - mappedRange.offset;
+      mappedRange.size = VK_WHOLE_SIZE;
+    } else {
+      writeStats.bytesFlushed += mappedRange.size;
+    }
+  }
+  writeStats.flushCalls++;
+  return vkFlushMappedMemoryRanges(
+      lveDevice.device(),
+      static_cast<uint32_t>(mappedRanges.size()),
+      mappedRanges.data());
+}
+
+BufferWriteStats BurnhopeBuffer::takeWriteStats() {
+  BufferWriteStats stats = writeStats;
+  writeStats = {};
+  return stats;
+}
+
 /**
  * Invalidate a memory range of the buffer to make it visible to the host
  *
@@ -2,8 +2,24 @@
 
 #include "lve_device.hpp"
 
+// std
+#include <vector>
+
 namespace burnhope {
 
+struct BufferWriteStats {
+  VkDeviceSize bytesWritten = 0;
+  VkDeviceSize bytesFlushed = 0;
+  uint32_t flushCalls = 0;
+
+  BufferWriteStats &operator+=(const BufferWriteStats &other) {
+    bytesWritten += other.bytesWritten;
+    bytesFlushed += other.bytesFlushed;
+    flushCalls += other.flushCalls;
+    return *this;
+  }
+};
+
 class BurnhopeBuffer {
  public:
   BurnhopeBuffer(
@@ -13,6 +29,13 @@ class BurnhopeBuffer {
       VkBufferUsageFlags usageFlags,
       VkMemoryPropertyFlags memoryPropertyFlags,
       VkDeviceSize minOffsetAlignment = 1);
+  BurnhopeBuffer(
+      BurnhopeDevice& device,
+      VkDeviceSize instanceSize,
+      uint32_t instanceCount,
+      VkBufferUsageFlags usageFlags,
+      MemoryUsage memoryUsage,
+      VkDeviceSize minOffsetAlignment = 1);
   ~BurnhopeBuffer();
 
   BurnhopeBuffer(const BurnhopeBuffer&) = delete;
@@ -23,6 +46,7 @@ class BurnhopeBuffer {
 
   void writeToBuffer(void* data, VkDeviceSize size = VK_WHOLE_SIZE, VkDeviceSize offset = 0);
   VkResult flush(VkDeviceSize size = VK_WHOLE_SIZE, VkDeviceSize offset = 0);
+  VkResult flushDirtyRanges();
   VkDescriptorBufferInfo descriptorInfo(VkDeviceSize size = VK_WHOLE_SIZE, VkDeviceSize offset = 0);
   VkResult invalidate(VkDeviceSize size = VK_WHOLE_SIZE, VkDeviceSize offset = 0);
 
@@ -35,13 +59,18 @@ class BurnhopeBuffer {
   void* getMappedMemory() const { return mapped; }
   uint32_t getInstanceCount() const { return instanceCount; }
   VkDeviceSize getInstanceSize() const { return instanceSize; }
-  VkDeviceSize getAlignmentSize() const { return instanceSize; }
+  VkDeviceSize getAlignmentSize() const { return alignmentSize; }
   VkBufferUsageFlags getUsageFlags() const { return usageFlags; }
   VkMemoryPropertyFlags getMemoryPropertyFlags() const { return memoryPropertyFlags; }
   VkDeviceSize getBufferSize() const { return bufferSize; }
+  bool isHostCoherent() const { return hostCoherent; }
+
+  // returns the write/flush counters accumulated since the last call and resets them
+  BufferWriteStats takeWriteStats();
 
  private:
   static VkDeviceSize getAlignment(VkDeviceSize instanceSize, VkDeviceSize minOffsetAlignment);
+  void markDirty(VkDeviceSize size, VkDeviceSize offset);
 
   BurnhopeDevice& lveDevice;
   void* mapped = nullptr;
@@ -54,6 +83,11 @@ class BurnhopeBuffer {
   VkDeviceSize alignmentSize;
   VkBufferUsageFlags usageFlags;
   VkMemoryPropertyFlags memoryPropertyFlags;
+  bool hostCoherent = false;
+
+  // [begin, end) byte ranges written since the last flushDirtyRanges
+  std::vector<std::pair<VkDeviceSize, VkDeviceSize>> dirtyRanges;
+  BufferWriteStats writeStats{};
 };
 
 }  // namespace burnhope
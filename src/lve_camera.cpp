@@ -15,6 +15,8 @@ void BurnhopeCamera::setOrthographicProjection(
   projectionMatrix[3][0] = -(right + left) / (right - left);
   projectionMatrix[3][1] = -(bottom + top) / (bottom - top);
   projectionMatrix[3][2] = -near / (far - near);
+  nearClip = near;
+  farClip = far;
 }
 
 void BurnhopeCamera::setPerspectiveProjection(float fovy, float aspect, float near, float far) {
@@ -26,6 +28,8 @@ void BurnhopeCamera::setPerspectiveProjection(float fovy, float aspect, float ne
   projectionMatrix[2][2] = far / (far - near);
   projectionMatrix[2][3] = 1.f;
   projectionMatrix[3][2] = -(far * near) / (far - near);
+  nearClip = near;
+  farClip = far;
 }
 
 void BurnhopeCamera::setViewDirection(glm::vec3 position, glm::vec3 direction, glm::vec3 up) {
@@ -105,4 +109,21 @@ void BurnhopeCamera::setViewYXZ(glm::vec3 position, glm::vec3 rotation) {
   inverseViewMatrix[3][2] = position.z;
 }
 
+std::array<glm::vec4, 6> BurnhopeCamera::getFrustumPlanes() const {
+  // Gribb/Hartmann plane extraction, with a [0, 1] clip depth the near plane is row 2 alone
+  const glm::mat4 m = projectionMatrix * viewMatrix;
+  auto row = [&m](int i) { return glm::vec4{m[0][i], m[1][i], m[2][i], m[3][i]}; };
+  std::array<glm::vec4, 6> planes{
+      row(3) + row(0),
+      row(3) - row(0),
+      row(3) + row(1),
+      row(3) - row(1),
+      row(2),
+      row(3) - row(2)};
+  for (auto &plane : planes) {
+    plane /= glm::length(glm::vec3(plane));
+  }
+  return planes;
+}
+
 }  // namespace burnhope
@@ -5,6 +5,9 @@
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #include <glm/glm.hpp>
 
+// std
+#include <array>
+
 namespace burnhope {
 
 class BurnhopeCamera {
@@ -23,10 +26,19 @@ class BurnhopeCamera {
   const glm::mat4& getView() const { return viewMatrix; }
   const glm::mat4& getInverseView() const { return inverseViewMatrix; }
   const glm::vec3 getPosition() const { return glm::vec3(inverseViewMatrix[3]); }
+  // view space depth of the near and far planes of the last projection
+  float getNearClip() const { return nearClip; }
+  float getFarClip() const { return farClip; }
+
+  // world space planes (left, right, bottom, top, near, far) with normals pointing inward and
+  // normalized so dot(plane.xyz, p) + plane.w is the signed distance of p
+  std::array<glm::vec4, 6> getFrustumPlanes() const;
 
  private:
   glm::mat4 projectionMatrix{1.f};
   glm::mat4 viewMatrix{1.f};
   glm::mat4 inverseViewMatrix{1.f};
+  float nearClip = 0.f;
+  float farClip = 1.f;
 };
 }  // namespace burnhope
\ No newline at end of file
@@ -0,0 +1,154 @@
+#include "lve_command_thread_pool.hpp"
+
+// std
+#include <cassert>
+#include <chrono>
+#include <stdexcept>
+
+namespace burnhope {
+
+BurnhopeCommandThreadPool::BurnhopeCommandThreadPool(BurnhopeDevice &device, uint32_t threadCount)
+    : lveDevice{device}, workers(threadCount), recorded(threadCount) {
+  assert(threadCount > 0 && "Command thread pool needs at least one thread");
+  for (auto &worker : workers) {
+    createWorker(worker);
+  }
+  for (uint32_t i = 0; i < threadCount; i++) {
+    threads.emplace_back(&BurnhopeCommandThreadPool::workerLoop, this, i);
+  }
+}
+
+BurnhopeCommandThreadPool::~BurnhopeCommandThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock{mutex};
+    stopping = true;
+  }
+  jobReady.notify_all();
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  // destroying a pool frees its command buffers
+  for (auto &worker : workers) {
+    for (VkCommandPool commandPool : worker.commandPools) {
+      vkDestroyCommandPool(lveDevice.device(), commandPool, nullptr);
+    }
+  }
+}
+
+void BurnhopeCommandThreadPool::createWorker(Worker &worker) {
+  VkCommandPoolCreateInfo poolInfo{};
+  poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+  poolInfo.queueFamilyIndex = lveDevice.findPhysicalQueueFamilies().graphicsFamily;
+  poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+  for (int frame = 0; frame < BurnhopeSwapChain::MAX_FRAMES_IN_FLIGHT; frame++) {
+    if (vkCreateCommandPool(lveDevice.device(), &poolInfo, nullptr, &worker.commandPools[frame]) !=
+        VK_SUCCESS) {
+      throw std::runtime_error("failed to create thread command pool!");
+    }
+
+    VkCommandBufferAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+    allocInfo.commandPool = worker.commandPools[frame];
+    allocInfo.commandBufferCount = 1;
+    if (vkAllocateCommandBuffers(lveDevice.device(), &allocInfo, &worker.commandBuffers[frame]) !=
+        VK_SUCCESS) {
+      throw std::runtime_error("failed to allocate secondary command buffer!");
+    }
+  }
+}
+
+const std::vector<VkCommandBuffer> &BurnhopeCommandThreadPool::record(
+    int frameIndex,
+    const VkCommandBufferInheritanceInfo &inheritance,
+    const RecordFunction &recordFunction) {
+  std::unique_lock<std::mutex> lock{mutex};
+  jobFrameIndex = frameIndex;
+  jobInheritance = &inheritance;
+  jobRecordFunction = &recordFunction;
+  pendingWorkers = getThreadCount();
+  jobGeneration++;
+  jobReady.notify_all();
+  jobFinished.wait(lock, [this] { return pendingWorkers == 0; });
+
+  if (workerError) {
+    std::exception_ptr error = workerError;
+    workerError = nullptr;
+    std::rethrow_exception(error);
+  }
+  for (uint32_t i = 0; i < getThreadCount(); i++) {
+    recorded[i] = workers[i].commandBuffers[frameIndex];
+  }
+  return recorded;
+}
+
+std::vector<BurnhopeCommandThreadPool::ThreadStats> BurnhopeCommandThreadPool::takeStats() {
+  std::lock_guard<std::mutex> lock{mutex};
+  std::vector<ThreadStats> stats;
+  for (auto &worker : workers) {
+    stats.push_back(worker.stats);
+    worker.stats = {};
+  }
+  return stats;
+}
+
+void BurnhopeCommandThreadPool::workerLoop(uint32_t threadIndex) {
+  uint64_t seenGeneration = 0;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock{mutex};
+      jobReady.wait(lock, [&] { return stopping || jobGeneration != seenGeneration; });
+      if (stopping) {
+        return;
+      }
+      seenGeneration = jobGeneration;
+    }
+
+    try {
+      recordOnWorker(threadIndex);
+    } catch (...) {
+      std::lock_guard<std::mutex> lock{mutex};
+      if (!workerError) {
+        workerError = std::current_exception();
+      }
+    }
+
+    {
+      std::lock_guard<std::mutex> lock{mutex};
+      pendingWorkers--;
+    }
+    jobFinished.notify_one();
+  }
+}
+
+void BurnhopeCommandThreadPool::recordOnWorker(uint32_t threadIndex) {
+  auto start = std::chrono::high_resolution_clock::now();
+  Worker &worker = workers[threadIndex];
+
+  // the frame's fence was waited on before record, so its buffer is no longer in use
+  vkResetCommandPool(lveDevice.device(), worker.commandPools[jobFrameIndex], 0);
+  VkCommandBuffer commandBuffer = worker.commandBuffers[jobFrameIndex];
+
+  VkCommandBufferBeginInfo beginInfo{};
+  beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT |
+                    VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+  beginInfo.pInheritanceInfo = jobInheritance;
+  if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+    throw std::runtime_error("failed to begin recording secondary command buffer!");
+  }
+  (*jobRecordFunction)(threadIndex, commandBuffer);
+  if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+    throw std::runtime_error("failed to record secondary command buffer!");
+  }
+
+  // stats are only read by takeStats while no job is running
+  worker.stats.buffersRecorded++;
+  worker.stats.recordMicros += static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::microseconds>(
+          std::chrono::high_resolution_clock::now() - start)
+          .count());
+}
+
+}  // namespace burnhope
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "lve_device.hpp"
+#include "lve_swap_chain.hpp"
+
+// std
+#include <array>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace burnhope {
+
+// Worker threads that record secondary command buffers in parallel. Each thread owns one
+// command pool per frame in flight, since command pools may only be used by one thread at a
+// time, and resets it when that frame is recorded again.
+class BurnhopeCommandThreadPool {
+ public:
+  struct ThreadStats {
+    uint32_t buffersRecorded = 0;
+    uint64_t recordMicros = 0;
+  };
+
+  // called on worker threadIndex with its secondary command buffer already begun
+  using RecordFunction = std::function<void(uint32_t threadIndex, VkCommandBuffer commandBuffer)>;
+
+  BurnhopeCommandThreadPool(BurnhopeDevice &device, uint32_t threadCount);
+  ~BurnhopeCommandThreadPool();
+
+  BurnhopeCommandThreadPool(const BurnhopeCommandThreadPool &) = delete;
+  BurnhopeCommandThreadPool &operator=(const BurnhopeCommandThreadPool &) = delete;
+
+  uint32_t getThreadCount() const { return static_cast<uint32_t>(threads.size()); }
+
+  // Records one secondary command buffer per thread for frameIndex and blocks until all are
+  // ended. Returns them in thread order. Must only be called once the frame's previous
+  // submission has finished.
+  const std::vector<VkCommandBuffer> &record(
+      int frameIndex,
+      const VkCommandBufferInheritanceInfo &inheritance,
+      const RecordFunction &recordFunction);
+
+  // returns the per thread counters accumulated since the last call and resets them
+  std::vector<ThreadStats> takeStats();
+
+ private:
+  struct Worker {
+    std::array<VkCommandPool, BurnhopeSwapChain::MAX_FRAMES_IN_FLIGHT> commandPools{};
+    std::array<VkCommandBuffer, BurnhopeSwapChain::MAX_FRAMES_IN_FLIGHT> commandBuffers{};
+    ThreadStats stats{};
+  };
+
+  void createWorker(Worker &worker);
+  void workerLoop(uint32_t threadIndex);
+  void recordOnWorker(uint32_t threadIndex);
+
+  BurnhopeDevice &lveDevice;
+  std::vector<Worker> workers;
+  std::vector<std::thread> threads;
+  std::vector<VkCommandBuffer> recorded;
+
+  // current job, only changed while no worker is recording
+  int jobFrameIndex = 0;
+  const VkCommandBufferInheritanceInfo *jobInheritance = nullptr;
+  const RecordFunction *jobRecordFunction = nullptr;
+
+  std::mutex mutex;
+  std::condition_variable jobReady;
+  std::condition_variable jobFinished;
+  uint64_t jobGeneration = 0;
+  uint32_t pendingWorkers = 0;
+  bool stopping = false;
+  std::exception_ptr workerError;
+};
+
+}  // namespace burnhope
@@ -0,0 +1,104 @@
+#pragma once
+
+// std
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+namespace burnhope {
+
+// contiguous run of components, valid until its array gains or loses a component
+template <typename T>
+class ComponentSpan {
+ public:
+  ComponentSpan(T *data, size_t size) : first{data}, count{size} {}
+
+  T *begin() const { return first; }
+  T *end() const { return first + count; }
+  T *data() const { return first; }
+  size_t size() const { return count; }
+  bool empty() const { return count == 0; }
+  T &operator[](size_t index) const { return first[index]; }
+
+ private:
+  T *first;
+  size_t count;
+};
+
+// Sparse set of one component type. Components are tightly packed in a dense array, in no
+// particular order, next to the entity owning each one. The sparse array maps an entity id to its
+// slot, so lookups are two loads and removal moves the last component into the hole.
+template <typename T>
+class ComponentArray {
+ public:
+  static constexpr uint32_t NO_SLOT = std::numeric_limits<uint32_t>::max();
+
+  // replaces the entity's component if it already has one
+  T &add(uint32_t entity, T component = T{}) {
+    if (entity >= sparse.size()) {
+      sparse.resize(entity + 1, NO_SLOT);
+    }
+    if (sparse[entity] != NO_SLOT) {
+      return dense[sparse[entity]] = std::move(component);
+    }
+    sparse[entity] = static_cast<uint32_t>(dense.size());
+    dense.push_back(std::move(component));
+    owners.push_back(entity);
+    return dense.back();
+  }
+
+  void remove(uint32_t entity) {
+    if (!has(entity)) return;
+    uint32_t slot = sparse[entity];
+    uint32_t last = static_cast<uint32_t>(dense.size() - 1);
+    if (slot != last) {
+      dense[slot] = std::move(dense[last]);
+      owners[slot] = owners[last];
+      sparse[owners[slot]] = slot;
+    }
+    dense.pop_back();
+    owners.pop_back();
+    sparse[entity] = NO_SLOT;
+  }
+
+  bool has(uint32_t entity) const {
+    return entity < sparse.size() && sparse[entity] != NO_SLOT;
+  }
+
+  // the entity's position in components(), NO_SLOT if it has none
+  uint32_t slotOf(uint32_t entity) const { return has(entity) ? sparse[entity] : NO_SLOT; }
+
+  T &get(uint32_t entity) {
+    assert(has(entity) && "Entity does not have this component");
+    return dense[sparse[entity]];
+  }
+  const T &get(uint32_t entity) const {
+    assert(has(entity) && "Entity does not have this component");
+    return dense[sparse[entity]];
+  }
+  T *tryGet(uint32_t entity) { return has(entity) ? &dense[sparse[entity]] : nullptr; }
+  const T *tryGet(uint32_t entity) const {
+    return has(entity) ? &dense[sparse[entity]] : nullptr;
+  }
+
+  size_t size() const { return dense.size(); }
+  void reserve(size_t capacity) {
+    dense.reserve(capacity);
+    owners.reserve(capacity);
+  }
+
+  // every component, and the entity owning each one at the same index
+  ComponentSpan<T> components() { return {dense.data(), dense.size()}; }
+  ComponentSpan<const T> components() const { return {dense.data(), dense.size()}; }
+  ComponentSpan<const uint32_t> entities() const { return {owners.data(), owners.size()}; }
+
+ private:
+  std::vector<T> dense;
+  std::vector<uint32_t> owners;
+  std::vector<uint32_t> sparse;
+};
+
+}  // namespace burnhope
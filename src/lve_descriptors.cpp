@@ -1,7 +1,9 @@
 #include "lve_descriptors.hpp"
 
 // std
+#include <algorithm>
 #include <cassert>
+#include <iostream>
 #include <stdexcept>
 
 namespace burnhope {
@@ -23,24 +25,49 @@ BurnhopeDescriptorSetLayout::Builder &BurnhopeDescriptorSetLayout::Builder::addB
   return *this;
 }
 
+BurnhopeDescriptorSetLayout::Builder &BurnhopeDescriptorSetLayout::Builder::setPushDescriptor(
+    bool pushDescriptor) {
+  assert(
+      (!pushDescriptor || lveDevice.supportsPushDescriptors()) &&
+      "Push descriptors require VK_KHR_push_descriptor");
+  if (pushDescriptor) {
+    flags |= VK_DESCRIPTOR_SET_LAYOUT_CREATE_PUSH_DESCRIPTOR_BIT_KHR;
+  } else {
+    flags &= ~VK_DESCRIPTOR_SET_LAYOUT_CREATE_PUSH_DESCRIPTOR_BIT_KHR;
+  }
+  return *this;
+}
+
 std::unique_ptr<BurnhopeDescriptorSetLayout> BurnhopeDescriptorSetLayout::Builder::build() const {
-  return std::make_unique<BurnhopeDescriptorSetLayout>(lveDevice, bindings);
+  return std::make_unique<BurnhopeDescriptorSetLayout>(lveDevice, bindings, flags);
 }
 
 // *************** Descriptor Set Layout *********************
 
 BurnhopeDescriptorSetLayout::BurnhopeDescriptorSetLayout(
-    BurnhopeDevice &lveDevice, std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings)
-    : lveDevice{lveDevice}, bindings{bindings} {
+    BurnhopeDevice &lveDevice,
+    std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings,
+    VkDescriptorSetLayoutCreateFlags flags)
+    : lveDevice{lveDevice}, bindings{bindings}, flags{flags} {
   std::vector<VkDescriptorSetLayoutBinding> setLayoutBindings{};
   for (auto kv : bindings) {
     setLayoutBindings.push_back(kv.second);
+    auto count = std::find_if(
+        descriptorCounts.begin(),
+        descriptorCounts.end(),
+        [&kv](const VkDescriptorPoolSize &size) { return size.type == kv.second.descriptorType; });
+    if (count != descriptorCounts.end()) {
+      count->descriptorCount += kv.second.descriptorCount;
+    } else {
+      descriptorCounts.push_back({kv.second.descriptorType, kv.second.descriptorCount});
+    }
   }
 
   VkDescriptorSetLayoutCreateInfo descriptorSetLayoutInfo{};
   descriptorSetLayoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
   descriptorSetLayoutInfo.bindingCount = static_cast<uint32_t>(setLayoutBindings.size());
   descriptorSetLayoutInfo.pBindings = setLayoutBindings.data();
+  descriptorSetLayoutInfo.flags = flags;
 
   if (vkCreateDescriptorSetLayout(
           lveDevice.device(),
@@ -49,12 +76,81 @@ BurnhopeDescriptorSetLayout::BurnhopeDescriptorSetLayout(
           &descriptorSetLayout) != VK_SUCCESS) {
     throw std::runtime_error("failed to create descriptor set layout!");
   }
+
+  if (!isPushDescriptor() && lveDevice.supportsUpdateTemplates()) {
+    createUpdateTemplate();
+  }
 }
 
 BurnhopeDescriptorSetLayout::~BurnhopeDescriptorSetLayout() {
+  if (updateTemplate != VK_NULL_HANDLE) {
+    lveDevice.descriptorFunctions().destroyUpdateTemplate(
+        lveDevice.device(),
+        updateTemplate,
+        nullptr);
+  }
   vkDestroyDescriptorSetLayout(lveDevice.device(), descriptorSetLayout, nullptr);
 }
 
+void BurnhopeDescriptorSetLayout::createUpdateTemplate() {
+  std::vector<uint32_t> bindingNumbers;
+  for (auto &kv : bindings) {
+    bindingNumbers.push_back(kv.first);
+  }
+  std::sort(bindingNumbers.begin(), bindingNumbers.end());
+
+  std::vector<VkDescriptorUpdateTemplateEntry> entries;
+  for (uint32_t binding : bindingNumbers) {
+    auto &layoutBinding = bindings[binding];
+    size_t stride;
+    switch (layoutBinding.descriptorType) {
+      case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER:
+      case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC:
+      case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER:
+      case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC:
+        stride = sizeof(VkDescriptorBufferInfo);
+        break;
+      case VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER:
+      case VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER:
+        stride = sizeof(VkBufferView);
+        break;
+      default:
+        stride = sizeof(VkDescriptorImageInfo);
+        break;
+    }
+
+    VkDescriptorUpdateTemplateEntry entry{};
+    entry.dstBinding = binding;
+    entry.dstArrayElement = 0;
+    entry.descriptorCount = layoutBinding.descriptorCount;
+    entry.descriptorType = layoutBinding.descriptorType;
+    entry.offset = templateDataSize;
+    entry.stride = stride;
+    entries.push_back(entry);
+    templateDataSize += stride * layoutBinding.descriptorCount;
+  }
+
+  VkDescriptorUpdateTemplateCreateInfo templateInfo{};
+  templateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO;
+  templateInfo.descriptorUpdateEntryCount = static_cast<uint32_t>(entries.size());
+  templateInfo.pDescriptorUpdateEntries = entries.data();
+  templateInfo.templateType = VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_DESCRIPTOR_SET;
+  templateInfo.descriptorSetLayout = descriptorSetLayout;
+
+  if (lveDevice.descriptorFunctions().createUpdateTemplate(
+          lveDevice.device(),
+          &templateInfo,
+          nullptr,
+          &updateTemplate) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create descriptor update template!");
+  }
+}
+
+void BurnhopeDescriptorSetLayout::updateWithTemplate(VkDescriptorSet set, const void *data) const {
+  assert(hasUpdateTemplate() && "Layout has no descriptor update template");
+  lveDevice.descriptorFunctions().updateWithTemplate(lveDevice.device(), set, updateTemplate, data);
+}
+
 // *************** Descriptor Pool Builder *********************
 
 BurnhopeDescriptorPool::Builder &BurnhopeDescriptorPool::Builder::addPoolSize(
@@ -84,7 +180,25 @@ BurnhopeDescriptorPool::BurnhopeDescriptorPool(
     uint32_t maxSets,
     VkDescriptorPoolCreateFlags poolFlags,
     const std::vector<VkDescriptorPoolSize> &poolSizes)
-    : lveDevice{lveDevice} {
+    : lveDevice{lveDevice}, poolFlags{poolFlags}, basePoolSizes{poolSizes}, baseMaxSets{maxSets} {
+  descriptorPools.push_back(createPool(maxSets));
+}
+
+BurnhopeDescriptorPool::~BurnhopeDescriptorPool() { destroyPools(); }
+
+std::vector<VkDescriptorPoolSize> BurnhopeDescriptorPool::scalePoolSizes(uint32_t maxSets) const {
+  std::vector<VkDescriptorPoolSize> poolSizes = basePoolSizes;
+  for (auto &poolSize : poolSizes) {
+    poolSize.descriptorCount = static_cast<uint32_t>(
+        (static_cast<uint64_t>(poolSize.descriptorCount) * maxSets + baseMaxSets - 1) /
+        baseMaxSets);
+  }
+  return poolSizes;
+}
+
+VkDescriptorPool BurnhopeDescriptorPool::createPool(uint32_t maxSets) {
+  std::vector<VkDescriptorPoolSize> poolSizes = scalePoolSizes(maxSets);
+
   VkDescriptorPoolCreateInfo descriptorPoolInfo{};
   descriptorPoolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
   descriptorPoolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
@@ -92,48 +206,164 @@ BurnhopeDescriptorPool::BurnhopeDescriptorPool(
   descriptorPoolInfo.maxSets = maxSets;
   descriptorPoolInfo.flags = poolFlags;
 
+  VkDescriptorPool descriptorPool;
   if (vkCreateDescriptorPool(lveDevice.device(), &descriptorPoolInfo, nullptr, &descriptorPool) !=
       VK_SUCCESS) {
     throw std::runtime_error("failed to create descriptor pool!");
   }
+
+  poolMaxSets.push_back(maxSets);
+  poolCapacities.push_back({maxSets, poolSizes});
+  stats.capacity += maxSets;
+  stats.poolCount = static_cast<uint32_t>(poolMaxSets.size());
+  stats.highWaterPools = std::max(stats.highWaterPools, stats.poolCount);
+  return descriptorPool;
 }
 
-BurnhopeDescriptorPool::~BurnhopeDescriptorPool() {
-  vkDestroyDescriptorPool(lveDevice.device(), descriptorPool, nullptr);
+void BurnhopeDescriptorPool::destroyPools() {
+  for (auto descriptorPool : descriptorPools) {
+    vkDestroyDescriptorPool(lveDevice.device(), descriptorPool, nullptr);
+  }
+  descriptorPools.clear();
+  poolMaxSets.clear();
+  poolCapacities.clear();
+  setOwners.clear();
+  currentPool = 0;
+  stats.capacity = 0;
+  stats.poolCount = 0;
 }
 
 bool BurnhopeDescriptorPool::allocateDescriptor(
-    const VkDescriptorSetLayout descriptorSetLayout, VkDescriptorSet &descriptor) const {
+    const BurnhopeDescriptorSetLayout &setLayout, VkDescriptorSet &descriptor) {
+  // try the current pool first, then the rest of the chain since sets may have been freed there
+  for (size_t i = 0; i < descriptorPools.size(); i++) {
+    size_t poolIndex = (currentPool + i) % descriptorPools.size();
+    if (!fits(poolCapacities[poolIndex], setLayout)) continue;
+    VkResult result = allocateFromPool(poolIndex, setLayout, descriptor);
+    if (result == VK_SUCCESS) {
+      return true;
+    }
+    // room on paper, but freed sets left it fragmented
+    if (result != VK_ERROR_FRAGMENTED_POOL && result != VK_ERROR_OUT_OF_POOL_MEMORY) {
+      return false;
+    }
+  }
+
+  // no pool in the chain has room, append one twice the size of the last, unless even that
+  // couldn't hold the set because the builder gave no size for one of its types
+  uint32_t maxSets = poolMaxSets.back() * 2;
+  if (!fits({maxSets, scalePoolSizes(maxSets)}, setLayout)) {
+    return false;
+  }
+  descriptorPools.push_back(createPool(maxSets));
+  std::cout << "descriptor pool grew to " << stats.poolCount << " pools, " << stats.capacity
+            << " sets" << std::endl;
+  return allocateFromPool(descriptorPools.size() - 1, setLayout, descriptor) == VK_SUCCESS;
+}
+
+bool BurnhopeDescriptorPool::fits(
+    const PoolCapacity &capacity, const BurnhopeDescriptorSetLayout &setLayout) {
+  if (capacity.sets == 0) {
+    return false;
+  }
+  for (const auto &count : setLayout.getDescriptorCounts()) {
+    auto available = std::find_if(
+        capacity.descriptors.begin(),
+        capacity.descriptors.end(),
+        [&count](const VkDescriptorPoolSize &size) { return size.type == count.type; });
+    if (available == capacity.descriptors.end() ||
+        available->descriptorCount < count.descriptorCount) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void BurnhopeDescriptorPool::adjustCapacity(
+    size_t poolIndex, const BurnhopeDescriptorSetLayout &setLayout, int sets) {
+  PoolCapacity &capacity = poolCapacities[poolIndex];
+  capacity.sets = static_cast<uint32_t>(static_cast<int64_t>(capacity.sets) + sets);
+  for (const auto &layoutCount : setLayout.getDescriptorCounts()) {
+    for (auto &size : capacity.descriptors) {
+      if (size.type == layoutCount.type) {
+        size.descriptorCount = static_cast<uint32_t>(
+            static_cast<int64_t>(size.descriptorCount) +
+            static_cast<int64_t>(sets) * layoutCount.descriptorCount);
+      }
+    }
+  }
+}
+
+VkResult BurnhopeDescriptorPool::allocateFromPool(
+    size_t poolIndex,
+    const BurnhopeDescriptorSetLayout &setLayout,
+    VkDescriptorSet &descriptor) {
+  VkDescriptorSetLayout descriptorSetLayout = setLayout.getDescriptorSetLayout();
   VkDescriptorSetAllocateInfo allocInfo{};
   allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-  allocInfo.descriptorPool = descriptorPool;
+  allocInfo.descriptorPool = descriptorPools[poolIndex];
   allocInfo.pSetLayouts = &descriptorSetLayout;
   allocInfo.descriptorSetCount = 1;
 
-  // Might want to create a "DescriptorPoolManager" class that handles this case, and builds
-  // a new pool whenever an old pool fills up. But this is beyond our current scope
-  if (vkAllocateDescriptorSets(lveDevice.device(), &allocInfo, &descriptor) != VK_SUCCESS) {
-    return false;
+  VkResult result = vkAllocateDescriptorSets(lveDevice.device(), &allocInfo, &descriptor);
+  if (result != VK_SUCCESS) {
+    return result;
   }
-  return true;
+
+  currentPool = poolIndex;
+  adjustCapacity(poolIndex, setLayout, -1);
+  if (poolFlags & VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT) {
+    setOwners[descriptor] = {poolIndex, &setLayout};
+  }
+  stats.allocatedSets++;
+  stats.highWaterSets = std::max(stats.highWaterSets, stats.allocatedSets);
+  return VK_SUCCESS;
 }
 
-void BurnhopeDescriptorPool::freeDescriptors(std::vector<VkDescriptorSet> &descriptors) const {
-  vkFreeDescriptorSets(
-      lveDevice.device(),
-      descriptorPool,
-      static_cast<uint32_t>(descriptors.size()),
-      descriptors.data());
+void BurnhopeDescriptorPool::freeDescriptors(std::vector<VkDescriptorSet> &descriptors) {
+  assert(
+      (poolFlags & VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT) &&
+      "Descriptor pool was not created with VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT");
+  for (auto descriptor : descriptors) {
+    auto it = setOwners.find(descriptor);
+    assert(it != setOwners.end() && "Descriptor set was not allocated from this pool");
+    const SetOwner &owner = it->second;
+    vkFreeDescriptorSets(lveDevice.device(), descriptorPools[owner.poolIndex], 1, &descriptor);
+    adjustCapacity(owner.poolIndex, *owner.setLayout, 1);
+    setOwners.erase(it);
+    stats.allocatedSets--;
+  }
 }
 
 void BurnhopeDescriptorPool::resetPool() {
-  vkResetDescriptorPool(lveDevice.device(), descriptorPool, 0);
+  if (descriptorPools.size() > 1) {
+    // the chain had to grow: replace it with a single pool that fits the peak usage plus 25%
+    uint32_t learnedMaxSets =
+        std::max(baseMaxSets, stats.highWaterSets + stats.highWaterSets / 4);
+    destroyPools();
+    descriptorPools.push_back(createPool(learnedMaxSets));
+    // learned again from here, so one spike doesn't size every later collapse
+    stats.highWaterSets = 0;
+  } else {
+    vkResetDescriptorPool(lveDevice.device(), descriptorPools[0], 0);
+    setOwners.clear();
+    poolCapacities[0] = {poolMaxSets[0], scalePoolSizes(poolMaxSets[0])};
+  }
+  currentPool = 0;
+  stats.allocatedSets = 0;
 }
 
 // *************** Descriptor Writer *********************
 
 BurnhopeDescriptorWriter::BurnhopeDescriptorWriter(BurnhopeDescriptorSetLayout &setLayout, BurnhopeDescriptorPool &pool)
-    : setLayout{setLayout}, pool{pool} {}
+    : setLayout{setLayout}, pool{&pool} {}
+
+BurnhopeDescriptorWriter::BurnhopeDescriptorWriter(BurnhopeDescriptorSetLayout &setLayout)
+    : setLayout{setLayout}, pool{nullptr} {
+  assert(
+      setLayout.isPushDescriptor() &&
+      "Only push descriptor layouts can be written without a pool");
+}
 
 BurnhopeDescriptorWriter &BurnhopeDescriptorWriter::writeBuffer(
     uint32_t binding, VkDescriptorBufferInfo *bufferInfo) {
@@ -178,7 +408,8 @@ BurnhopeDescriptorWriter &BurnhopeDescriptorWriter::writeImage(
 }
 
 bool BurnhopeDescriptorWriter::build(VkDescriptorSet &set) {
-  bool success = pool.allocateDescriptor(setLayout.getDescriptorSetLayout(), set);
+  assert(pool != nullptr && "Cannot build a descriptor set without a pool");
+  bool success = pool->allocateDescriptor(setLayout, set);
   if (!success) {
     return false;
   }
@@ -190,7 +421,19 @@ void BurnhopeDescriptorWriter::overwrite(VkDescriptorSet &set) {
   for (auto &write : writes) {
     write.dstSet = set;
   }
-  vkUpdateDescriptorSets(pool.lveDevice.device(), writes.size(), writes.data(), 0, nullptr);
+  vkUpdateDescriptorSets(setLayout.lveDevice.device(), writes.size(), writes.data(), 0, nullptr);
+}
+
+void BurnhopeDescriptorWriter::push(
+    VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, uint32_t set) {
+  assert(setLayout.isPushDescriptor() && "Layout was not created as a push descriptor layout");
+  setLayout.lveDevice.descriptorFunctions().cmdPushDescriptorSet(
+      commandBuffer,
+      VK_PIPELINE_BIND_POINT_GRAPHICS,
+      pipelineLayout,
+      set,
+      static_cast<uint32_t>(writes.size()),
+      writes.data());
 }
 
 }  // namespace burnhope
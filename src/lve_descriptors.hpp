@@ -20,31 +20,70 @@ class BurnhopeDescriptorSetLayout {
         VkDescriptorType descriptorType,
         VkShaderStageFlags stageFlags,
         uint32_t count = 1);
+    // sets of a push descriptor layout are never allocated, they are written straight into the
+    // command buffer with BurnhopeDescriptorWriter::push. Requires VK_KHR_push_descriptor.
+    Builder &setPushDescriptor(bool pushDescriptor = true);
     std::unique_ptr<BurnhopeDescriptorSetLayout> build() const;
 
    private:
     BurnhopeDevice &lveDevice;
     std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings{};
+    VkDescriptorSetLayoutCreateFlags flags = 0;
   };
 
   BurnhopeDescriptorSetLayout(
-      BurnhopeDevice &lveDevice, std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings);
+      BurnhopeDevice &lveDevice,
+      std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings,
+      VkDescriptorSetLayoutCreateFlags flags = 0);
   ~BurnhopeDescriptorSetLayout();
   BurnhopeDescriptorSetLayout(const BurnhopeDescriptorSetLayout &) = delete;
   BurnhopeDescriptorSetLayout &operator=(const BurnhopeDescriptorSetLayout &) = delete;
 
   VkDescriptorSetLayout getDescriptorSetLayout() const { return descriptorSetLayout; }
+  bool isPushDescriptor() const {
+    return flags & VK_DESCRIPTOR_SET_LAYOUT_CREATE_PUSH_DESCRIPTOR_BIT_KHR;
+  }
+
+  // The update template reads one VkDescriptorBufferInfo / VkDescriptorImageInfo per descriptor,
+  // packed tightly in ascending binding order, e.g. struct { VkDescriptorImageInfo maps[6]; }.
+  // Only created for regular layouts when VK_KHR_descriptor_update_template is available.
+  bool hasUpdateTemplate() const { return updateTemplate != VK_NULL_HANDLE; }
+  // descriptors one set of this layout takes from a pool, summed per type
+  const std::vector<VkDescriptorPoolSize> &getDescriptorCounts() const {
+    return descriptorCounts;
+  }
+  size_t getTemplateDataSize() const { return templateDataSize; }
+  void updateWithTemplate(VkDescriptorSet set, const void *data) const;
 
  private:
+  void createUpdateTemplate();
+
   BurnhopeDevice &lveDevice;
   VkDescriptorSetLayout descriptorSetLayout;
   std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings;
+  VkDescriptorSetLayoutCreateFlags flags;
+  std::vector<VkDescriptorPoolSize> descriptorCounts;
+  VkDescriptorUpdateTemplateKHR updateTemplate = VK_NULL_HANDLE;
+  size_t templateDataSize = 0;
 
   friend class BurnhopeDescriptorWriter;
 };
 
+// Chain of VkDescriptorPools. The sets and descriptors left in each pool are counted, and a new,
+// larger pool is appended before an allocation that no pool has room for. Allocating past a
+// pool's capacity is invalid usage without VK_KHR_maintenance1, so it is never attempted. A pool
+// can still report VK_ERROR_FRAGMENTED_POOL after frees, the next pool is tried then. On
+// resetPool a chain that had to grow is collapsed into one pool sized from the high-water mark.
 class BurnhopeDescriptorPool {
  public:
+  struct Stats {
+    uint32_t allocatedSets = 0;   // since the last reset
+    uint32_t highWaterSets = 0;   // most sets live at once since the chain was last collapsed
+    uint32_t poolCount = 0;
+    uint32_t highWaterPools = 0;  // longest the chain has been
+    uint32_t capacity = 0;        // maxSets summed over the chain
+  };
+
   class Builder {
    public:
     Builder(BurnhopeDevice &lveDevice) : lveDevice{lveDevice} {}
@@ -71,15 +110,50 @@ class BurnhopeDescriptorPool {
   BurnhopeDescriptorPool &operator=(const BurnhopeDescriptorPool &) = delete;
 
   bool allocateDescriptor(
-      const VkDescriptorSetLayout descriptorSetLayout, VkDescriptorSet &descriptor) const;
+      const BurnhopeDescriptorSetLayout &setLayout, VkDescriptorSet &descriptor);
 
-  void freeDescriptors(std::vector<VkDescriptorSet> &descriptors) const;
+  void freeDescriptors(std::vector<VkDescriptorSet> &descriptors);
 
   void resetPool();
 
+  const Stats &getStats() const { return stats; }
+
  private:
+  // what is left in one pool of the chain
+  struct PoolCapacity {
+    uint32_t sets;
+    std::vector<VkDescriptorPoolSize> descriptors;
+  };
+  struct SetOwner {
+    size_t poolIndex;
+    const BurnhopeDescriptorSetLayout *setLayout;
+  };
+
+  // the builder's pool sizes scaled to a pool of maxSets sets
+  std::vector<VkDescriptorPoolSize> scalePoolSizes(uint32_t maxSets) const;
+  VkDescriptorPool createPool(uint32_t maxSets);
+  static bool fits(const PoolCapacity &capacity, const BurnhopeDescriptorSetLayout &setLayout);
+  // gives sets of the layout back to the pool's capacity, or takes them when sets is negative
+  void adjustCapacity(size_t poolIndex, const BurnhopeDescriptorSetLayout &setLayout, int sets);
+  VkResult allocateFromPool(
+      size_t poolIndex,
+      const BurnhopeDescriptorSetLayout &setLayout,
+      VkDescriptorSet &descriptor);
+  void destroyPools();
+
   BurnhopeDevice &lveDevice;
-  VkDescriptorPool descriptorPool;
+  VkDescriptorPoolCreateFlags poolFlags;
+  // pool sizes as given to the builder, scaled by poolMaxSets / baseMaxSets for larger pools
+  std::vector<VkDescriptorPoolSize> basePoolSizes;
+  uint32_t baseMaxSets;
+
+  std::vector<VkDescriptorPool> descriptorPools;
+  std::vector<uint32_t> poolMaxSets;
+  std::vector<PoolCapacity> poolCapacities;
+  size_t currentPool = 0;
+  // only tracked for pools created with FREE_DESCRIPTOR_SET_BIT
+  std::unordered_map<VkDescriptorSet, SetOwner> setOwners;
+  Stats stats{};
 
   friend class BurnhopeDescriptorWriter;
 };
@@ -87,16 +161,19 @@ class BurnhopeDescriptorPool {
 class BurnhopeDescriptorWriter {
  public:
   BurnhopeDescriptorWriter(BurnhopeDescriptorSetLayout &setLayout, BurnhopeDescriptorPool &pool);
+  // for push descriptor layouts, which need no pool
+  explicit BurnhopeDescriptorWriter(BurnhopeDescriptorSetLayout &setLayout);
 
   BurnhopeDescriptorWriter &writeBuffer(uint32_t binding, VkDescriptorBufferInfo *bufferInfo);
   BurnhopeDescriptorWriter &writeImage(uint32_t binding, VkDescriptorImageInfo *imageInfo);
 
   bool build(VkDescriptorSet &set);
   void overwrite(VkDescriptorSet &set);
+  void push(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, uint32_t set);
 
  private:
   BurnhopeDescriptorSetLayout &setLayout;
-  BurnhopeDescriptorPool &pool;
+  BurnhopeDescriptorPool *pool;
   std::vector<VkWriteDescriptorSet> writes;
 };
 
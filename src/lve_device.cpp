@@ -1,7 +1,10 @@
 #include "lve_device.hpp"
 
 // std headers
+#include <bitset>
 #include <cstring>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
 #include <set>
 #include <unordered_set>
@@ -46,17 +49,37 @@ void DestroyDebugUtilsMessengerEXT(
   }
 }
 
+const char *memoryUsageName(MemoryUsage usage) {
+  switch (usage) {
+    case MemoryUsage::GpuOnly:
+      return "gpu-only";
+    case MemoryUsage::CpuToGpu:
+      return "cpu-to-gpu";
+    case MemoryUsage::GpuToCpu:
+      return "readback";
+    case MemoryUsage::Staging:
+      return "staging";
+  }
+  return "unknown";
+}
+
 // class member functions
-BurnhopeDevice::BurnhopeDevice(BurnhopeWindow &window) : window{window} {
+BurnhopeDevice::BurnhopeDevice(BurnhopeWindow &window) : BurnhopeDevice{&window} {}
+
+BurnhopeDevice::BurnhopeDevice(BurnhopeWindow *window) : window{window} {
   createInstance();
   setupDebugMessenger();
   createSurface();
   pickPhysicalDevice();
   createLogicalDevice();
+  createMemoryTracker();
   createCommandPool();
+  createPipelineCache();
 }
 
 BurnhopeDevice::~BurnhopeDevice() {
+  savePipelineCache();
+  vkDestroyPipelineCache(device_, pipelineCache_, nullptr);
   vkDestroyCommandPool(device_, commandPool, nullptr);
   vkDestroyDevice(device_, nullptr);
 
@@ -64,7 +87,9 @@ BurnhopeDevice::~BurnhopeDevice() {
     DestroyDebugUtilsMessengerEXT(instance, debugMessenger, nullptr);
   }
 
-  vkDestroySurfaceKHR(instance, surface_, nullptr);
+  if (!isHeadless()) {
+    vkDestroySurfaceKHR(instance, surface_, nullptr);
+  }
   vkDestroyInstance(instance, nullptr);
 }
 
@@ -86,6 +111,11 @@ void BurnhopeDevice::createInstance() {
   createInfo.pApplicationInfo = &appInfo;
 
   auto extensions = getRequiredExtensions();
+  // optional, needed to query VK_EXT_memory_budget on a 1.0 instance
+  if (isInstanceExtensionAvailable(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME)) {
+    extensions.push_back(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
+    physicalDeviceProperties2Enabled = true;
+  }
   createInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
   createInfo.ppEnabledExtensionNames = extensions.data();
 
@@ -130,7 +160,37 @@ void BurnhopeDevice::pickPhysicalDevice() {
   }
 
   vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+  vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
   std::cout << "physical device: " << properties.deviceName << std::endl;
+  detectResizableBar();
+}
+
+void BurnhopeDevice::detectResizableBar() {
+  // without resizable BAR the host visible part of VRAM is a 256 MiB window
+  constexpr VkDeviceSize barWindowSize = 256ull * 1024 * 1024;
+  constexpr VkMemoryPropertyFlags barFlags =
+      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+  for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++) {
+    auto &type = memoryProperties.memoryTypes[i];
+    if ((type.propertyFlags & barFlags) == barFlags &&
+        memoryProperties.memoryHeaps[type.heapIndex].size > barWindowSize) {
+      resizableBar = true;
+    }
+  }
+
+  std::cout << "resizable BAR: " << (resizableBar ? "yes" : "no") << std::endl;
+  for (auto usage :
+       {MemoryUsage::GpuOnly, MemoryUsage::CpuToGpu, MemoryUsage::GpuToCpu, MemoryUsage::Staging}) {
+    uint32_t typeIndex = findMemoryType(~0u, usage);
+    uint32_t heapIndex = memoryProperties.memoryTypes[typeIndex].heapIndex;
+    std::cout << "\t" << memoryUsageName(usage) << " -> memory type " << typeIndex << ", heap "
+              << heapIndex << " ("
+              << memoryProperties.memoryHeaps[heapIndex].size / (1024 * 1024) << " MiB"
+              << ((memoryProperties.memoryHeaps[heapIndex].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT)
+                      ? ", device local)"
+                      : ")")
+              << std::endl;
+  }
 }
 
 void BurnhopeDevice::createLogicalDevice() {
@@ -149,8 +209,14 @@ void BurnhopeDevice::createLogicalDevice() {
     queueCreateInfos.push_back(queueCreateInfo);
   }
 
+  VkPhysicalDeviceFeatures supportedFeatures;
+  vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+
   VkPhysicalDeviceFeatures deviceFeatures = {};
   deviceFeatures.samplerAnisotropy = VK_TRUE;
+  // used by GPU driven rendering when available
+  deviceFeatures.multiDrawIndirect = supportedFeatures.multiDrawIndirect;
+  deviceFeatures.drawIndirectFirstInstance = supportedFeatures.drawIndirectFirstInstance;
 
   VkDeviceCreateInfo createInfo = {};
   createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
@@ -158,6 +224,26 @@ void BurnhopeDevice::createLogicalDevice() {
   createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
   createInfo.pQueueCreateInfos = queueCreateInfos.data();
 
+  auto deviceExtensions = getRequiredDeviceExtensions();
+  if (physicalDeviceProperties2Enabled &&
+      isDeviceExtensionAvailable(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME)) {
+    deviceExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+    memoryBudgetEnabled = true;
+  }
+  if (isDeviceExtensionAvailable(VK_KHR_DESCRIPTOR_UPDATE_TEMPLATE_EXTENSION_NAME)) {
+    deviceExtensions.push_back(VK_KHR_DESCRIPTOR_UPDATE_TEMPLATE_EXTENSION_NAME);
+    descriptorUpdateTemplateEnabled = true;
+  }
+  if (physicalDeviceProperties2Enabled &&
+      isDeviceExtensionAvailable(VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME)) {
+    deviceExtensions.push_back(VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME);
+    pushDescriptorEnabled = true;
+  }
+  bool drawIndirectCountEnabled = false;
+  if (isDeviceExtensionAvailable(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME)) {
+    deviceExtensions.push_back(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+    drawIndirectCountEnabled = true;
+  }
   createInfo.pEnabledFeatures = &deviceFeatures;
   createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
   createInfo.ppEnabledExtensionNames = deviceExtensions.data();
@@ -177,6 +263,56 @@ void BurnhopeDevice::createLogicalDevice() {
 
   vkGetDeviceQueue(device_, indices.graphicsFamily, 0, &graphicsQueue_);
   vkGetDeviceQueue(device_, indices.presentFamily, 0, &presentQueue_);
+  enabledFeatures = deviceFeatures;
+
+  loadDescriptorFunctions();
+  if (drawIndirectCountEnabled) {
+    cmdDrawIndexedIndirectCount_ = (PFN_vkCmdDrawIndexedIndirectCountKHR)vkGetDeviceProcAddr(
+        device_,
+        "vkCmdDrawIndexedIndirectCountKHR");
+  }
+  std::cout << "multi draw indirect: " << (deviceFeatures.multiDrawIndirect ? "yes" : "no")
+            << ", indirect first instance: "
+            << (deviceFeatures.drawIndirectFirstInstance ? "yes" : "no")
+            << ", draw indirect count: " << (cmdDrawIndexedIndirectCount_ ? "yes" : "no")
+            << std::endl;
+}
+
+void BurnhopeDevice::loadDescriptorFunctions() {
+  if (descriptorUpdateTemplateEnabled) {
+    descriptorFunctions_.createUpdateTemplate =
+        (PFN_vkCreateDescriptorUpdateTemplateKHR)vkGetDeviceProcAddr(
+            device_,
+            "vkCreateDescriptorUpdateTemplateKHR");
+    descriptorFunctions_.destroyUpdateTemplate =
+        (PFN_vkDestroyDescriptorUpdateTemplateKHR)vkGetDeviceProcAddr(
+            device_,
+            "vkDestroyDescriptorUpdateTemplateKHR");
+    descriptorFunctions_.updateWithTemplate =
+        (PFN_vkUpdateDescriptorSetWithTemplateKHR)vkGetDeviceProcAddr(
+            device_,
+            "vkUpdateDescriptorSetWithTemplateKHR");
+  }
+  if (pushDescriptorEnabled) {
+    descriptorFunctions_.cmdPushDescriptorSet = (PFN_vkCmdPushDescriptorSetKHR)vkGetDeviceProcAddr(
+        device_,
+        "vkCmdPushDescriptorSetKHR");
+  }
+  std::cout << "descriptor update templates: " << (supportsUpdateTemplates() ? "yes" : "no")
+            << ", push descriptors: " << (supportsPushDescriptors() ? "yes" : "no") << std::endl;
+}
+
+void BurnhopeDevice::createMemoryTracker() {
+  PFN_vkGetPhysicalDeviceMemoryProperties2KHR getMemoryProperties2 = nullptr;
+  if (memoryBudgetEnabled) {
+    getMemoryProperties2 = (PFN_vkGetPhysicalDeviceMemoryProperties2KHR)vkGetInstanceProcAddr(
+        instance,
+        "vkGetPhysicalDeviceMemoryProperties2KHR");
+  }
+  memoryTracker_ = std::make_unique<BurnhopeMemoryTracker>(physicalDevice, getMemoryProperties2);
+  std::cout << "memory budget: "
+            << (memoryTracker_->hasMemoryBudget() ? "VK_EXT_memory_budget" : "tracked only")
+            << std::endl;
 }
 
 void BurnhopeDevice::createCommandPool() {
@@ -193,15 +329,110 @@ void BurnhopeDevice::createCommandPool() {
   }
 }
 
-void BurnhopeDevice::createSurface() { window.createWindowSurface(instance, &surface_); }
+void BurnhopeDevice::createPipelineCache() {
+  std::vector<char> cacheData;
+  std::ifstream file{pipelineCacheFile, std::ios::ate | std::ios::binary};
+  if (file.is_open()) {
+    cacheData.resize(static_cast<size_t>(file.tellg()));
+    file.seekg(0);
+    file.read(cacheData.data(), cacheData.size());
+    file.close();
+
+    if (!isPipelineCacheCompatible(cacheData)) {
+      std::cout << "pipeline cache: " << pipelineCacheFile
+                << " was written by a different device or driver, discarding" << std::endl;
+      cacheData.clear();
+    }
+  }
+
+  VkPipelineCacheCreateInfo cacheInfo{};
+  cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+  cacheInfo.initialDataSize = cacheData.size();
+  cacheInfo.pInitialData = cacheData.empty() ? nullptr : cacheData.data();
+
+  if (vkCreatePipelineCache(device_, &cacheInfo, nullptr, &pipelineCache_) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create pipeline cache!");
+  }
+
+  pipelineCacheWarm = !cacheData.empty();
+  std::cout << "pipeline cache: " << (pipelineCacheWarm ? "warm" : "cold") << " ("
+            << cacheData.size() << " bytes loaded)" << std::endl;
+}
+
+bool BurnhopeDevice::isPipelineCacheCompatible(const std::vector<char> &cacheData) {
+  // header layout is VkPipelineCacheHeaderVersionOne:
+  // headerSize, headerVersion, vendorID, deviceID (uint32 each) followed by pipelineCacheUUID
+  constexpr size_t headerSize = 4 * sizeof(uint32_t) + VK_UUID_SIZE;
+  if (cacheData.size() < headerSize) {
+    return false;
+  }
+
+  uint32_t header[4];
+  memcpy(header, cacheData.data(), sizeof(header));
+  if (header[0] < headerSize || header[1] != VK_PIPELINE_CACHE_HEADER_VERSION_ONE) {
+    return false;
+  }
+  if (header[2] != properties.vendorID || header[3] != properties.deviceID) {
+    return false;
+  }
+  return memcmp(
+             cacheData.data() + 4 * sizeof(uint32_t),
+             properties.pipelineCacheUUID,
+             VK_UUID_SIZE) == 0;
+}
+
+void BurnhopeDevice::savePipelineCache() {
+  size_t dataSize = 0;
+  if (vkGetPipelineCacheData(device_, pipelineCache_, &dataSize, nullptr) != VK_SUCCESS ||
+      dataSize == 0) {
+    return;
+  }
+
+  std::vector<char> cacheData(dataSize);
+  if (vkGetPipelineCacheData(device_, pipelineCache_, &dataSize, cacheData.data()) != VK_SUCCESS) {
+    std::cerr << "pipeline cache: failed to read cache data" << std::endl;
+    return;
+  }
+
+  // written next to the cache file and renamed, so an interrupted exit never leaves a bad cache
+  std::string tempFile = pipelineCacheFile + ".tmp";
+  {
+    std::ofstream file{tempFile, std::ios::binary | std::ios::trunc};
+    if (!file.is_open()) {
+      std::cerr << "pipeline cache: failed to open " << tempFile << " for writing" << std::endl;
+      return;
+    }
+    file.write(cacheData.data(), dataSize);
+    if (!file) {
+      std::cerr << "pipeline cache: failed to write " << tempFile << std::endl;
+      return;
+    }
+  }
+  std::error_code error;
+  std::filesystem::rename(tempFile, pipelineCacheFile, error);
+  if (error) {
+    std::cerr << "pipeline cache: failed to replace " << pipelineCacheFile << ": "
+              << error.message() << std::endl;
+    return;
+  }
+  std::cout << "pipeline cache: saved " << dataSize << " bytes" << std::endl;
+}
+
+void BurnhopeDevice::createSurface() {
+  if (isHeadless()) {
+    surface_ = VK_NULL_HANDLE;
+    return;
+  }
+  window->createWindowSurface(instance, &surface_);
+}
 
 bool BurnhopeDevice::isDeviceSuitable(VkPhysicalDevice device) {
   QueueFamilyIndices indices = findQueueFamilies(device);
 
   bool extensionsSupported = checkDeviceExtensionSupport(device);
 
-  bool swapChainAdequate = false;
-  if (extensionsSupported) {
+  bool swapChainAdequate = isHeadless();
+  if (extensionsSupported && !isHeadless()) {
     SwapChainSupportDetails swapChainSupport = querySwapChainSupport(device);
     swapChainAdequate = !swapChainSupport.formats.empty() && !swapChainSupport.presentModes.empty();
   }
@@ -260,11 +491,13 @@ bool BurnhopeDevice::checkValidationLayerSupport() {
 }
 
 std::vector<const char *> BurnhopeDevice::getRequiredExtensions() {
-  uint32_t glfwExtensionCount = 0;
-  const char **glfwExtensions;
-  glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
-
-  std::vector<const char *> extensions(glfwExtensions, glfwExtensions + glfwExtensionCount);
+  std::vector<const char *> extensions{};
+  if (!isHeadless()) {
+    uint32_t glfwExtensionCount = 0;
+    const char **glfwExtensions;
+    glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+    extensions.assign(glfwExtensions, glfwExtensions + glfwExtensionCount);
+  }
 
   if (enableValidationLayers) {
     extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
@@ -273,6 +506,13 @@ std::vector<const char *> BurnhopeDevice::getRequiredExtensions() {
   return extensions;
 }
 
+std::vector<const char *> BurnhopeDevice::getRequiredDeviceExtensions() {
+  if (isHeadless()) {
+    return {};
+  }
+  return {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
+}
+
 void BurnhopeDevice::hasGflwRequiredInstanceExtensions() {
   uint32_t extensionCount = 0;
   vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, nullptr);
@@ -307,6 +547,7 @@ bool BurnhopeDevice::checkDeviceExtensionSupport(VkPhysicalDevice device) {
       &extensionCount,
       availableExtensions.data());
 
+  auto deviceExtensions = getRequiredDeviceExtensions();
   std::set<std::string> requiredExtensions(deviceExtensions.begin(), deviceExtensions.end());
 
   for (const auto &extension : availableExtensions) {
@@ -316,6 +557,38 @@ bool BurnhopeDevice::checkDeviceExtensionSupport(VkPhysicalDevice device) {
   return requiredExtensions.empty();
 }
 
+bool BurnhopeDevice::isInstanceExtensionAvailable(const char *extensionName) {
+  uint32_t extensionCount = 0;
+  vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, nullptr);
+  std::vector<VkExtensionProperties> extensions(extensionCount);
+  vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, extensions.data());
+
+  for (const auto &extension : extensions) {
+    if (strcmp(extension.extensionName, extensionName) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool BurnhopeDevice::isDeviceExtensionAvailable(const char *extensionName) {
+  uint32_t extensionCount = 0;
+  vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, nullptr);
+  std::vector<VkExtensionProperties> extensions(extensionCount);
+  vkEnumerateDeviceExtensionProperties(
+      physicalDevice,
+      nullptr,
+      &extensionCount,
+      extensions.data());
+
+  for (const auto &extension : extensions) {
+    if (strcmp(extension.extensionName, extensionName) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
 QueueFamilyIndices BurnhopeDevice::findQueueFamilies(VkPhysicalDevice device) {
   QueueFamilyIndices indices;
 
@@ -331,8 +604,11 @@ QueueFamilyIndices BurnhopeDevice::findQueueFamilies(VkPhysicalDevice device) {
       indices.graphicsFamily = i;
       indices.graphicsFamilyHasValue = true;
     }
-    VkBool32 presentSupport = false;
-    vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface_, &presentSupport);
+    // without a surface nothing is presented, the "present" queue is just the graphics queue
+    VkBool32 presentSupport = isHeadless() && (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT);
+    if (!isHeadless()) {
+      vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface_, &presentSupport);
+    }
     if (queueFamily.queueCount > 0 && presentSupport) {
       indices.presentFamily = i;
       indices.presentFamilyHasValue = true;
@@ -390,11 +666,9 @@ VkFormat BurnhopeDevice::findSupportedFormat(
 }
 
 uint32_t BurnhopeDevice::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) {
-  VkPhysicalDeviceMemoryProperties memProperties;
-  vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
-  for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
+  for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++) {
     if ((typeFilter & (1 << i)) &&
-        (memProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+        (memoryProperties.memoryTypes[i].propertyFlags & properties) == properties) {
       return i;
     }
   }
@@ -402,12 +676,87 @@ uint32_t BurnhopeDevice::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFla
   throw std::runtime_error("failed to find suitable memory type!");
 }
 
+uint32_t BurnhopeDevice::findMemoryType(uint32_t typeFilter, MemoryUsage usage) {
+  VkMemoryPropertyFlags required = 0;
+  VkMemoryPropertyFlags preferred = 0;
+  VkMemoryPropertyFlags avoided = 0;
+  switch (usage) {
+    case MemoryUsage::GpuOnly:
+      preferred = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+      avoided = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+      break;
+    case MemoryUsage::CpuToGpu:
+      required = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+      // with resizable BAR the GPU reads these straight from VRAM instead of over PCIe
+      if (resizableBar) {
+        preferred = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+      } else {
+        avoided = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+      }
+      break;
+    case MemoryUsage::GpuToCpu:
+      required = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+      preferred = VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
+      break;
+    case MemoryUsage::Staging:
+      required = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+      avoided = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+      break;
+  }
+
+  // lowest cost wins: one point per missing preferred or present avoided flag
+  uint32_t bestIndex = memoryProperties.memoryTypeCount;
+  size_t bestCost = ~size_t{0};
+  for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++) {
+    VkMemoryPropertyFlags flags = memoryProperties.memoryTypes[i].propertyFlags;
+    if (!(typeFilter & (1 << i)) || (flags & required) != required) continue;
+
+    size_t cost =
+        std::bitset<32>(preferred & ~flags).count() + std::bitset<32>(avoided & flags).count();
+    if (cost < bestCost) {
+      bestCost = cost;
+      bestIndex = i;
+    }
+  }
+
+  if (bestIndex == memoryProperties.memoryTypeCount) {
+    throw std::runtime_error("failed to find suitable memory type!");
+  }
+  return bestIndex;
+}
+
 void BurnhopeDevice::createBuffer(
     VkDeviceSize size,
     VkBufferUsageFlags usage,
     VkMemoryPropertyFlags properties,
     VkBuffer &buffer,
     VkDeviceMemory &bufferMemory) {
+  auto memRequirements = createBufferHandle(size, usage, buffer);
+  allocateBufferMemory(
+      buffer,
+      usage,
+      memRequirements.size,
+      findMemoryType(memRequirements.memoryTypeBits, properties),
+      bufferMemory);
+}
+
+void BurnhopeDevice::createBuffer(
+    VkDeviceSize size,
+    VkBufferUsageFlags usage,
+    MemoryUsage memoryUsage,
+    VkBuffer &buffer,
+    VkDeviceMemory &bufferMemory) {
+  auto memRequirements = createBufferHandle(size, usage, buffer);
+  allocateBufferMemory(
+      buffer,
+      usage,
+      memRequirements.size,
+      findMemoryType(memRequirements.memoryTypeBits, memoryUsage),
+      bufferMemory);
+}
+
+VkMemoryRequirements BurnhopeDevice::createBufferHandle(
+    VkDeviceSize size, VkBufferUsageFlags usage, VkBuffer &buffer) {
   VkBufferCreateInfo bufferInfo{};
   bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
   bufferInfo.size = size;
@@ -420,15 +769,28 @@ void BurnhopeDevice::createBuffer(
 
   VkMemoryRequirements memRequirements;
   vkGetBufferMemoryRequirements(device_, buffer, &memRequirements);
+  return memRequirements;
+}
 
+void BurnhopeDevice::allocateBufferMemory(
+    VkBuffer buffer,
+    VkBufferUsageFlags usage,
+    VkDeviceSize allocationSize,
+    uint32_t memoryTypeIndex,
+    VkDeviceMemory &bufferMemory) {
   VkMemoryAllocateInfo allocInfo{};
   allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-  allocInfo.allocationSize = memRequirements.size;
-  allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
+  allocInfo.allocationSize = allocationSize;
+  allocInfo.memoryTypeIndex = memoryTypeIndex;
 
   if (vkAllocateMemory(device_, &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS) {
     throw std::runtime_error("failed to allocate vertex buffer memory!");
   }
+  memoryTracker_->recordAllocation(
+      bufferMemory,
+      memoryTypeIndex,
+      allocationSize,
+      BurnhopeMemoryTracker::categoryForBuffer(usage, getMemoryTypeFlags(memoryTypeIndex)));
 
   vkBindBufferMemory(device_, buffer, bufferMemory, 0);
 }
@@ -524,12 +886,22 @@ void BurnhopeDevice::createImageWithInfo(
   if (vkAllocateMemory(device_, &allocInfo, nullptr, &imageMemory) != VK_SUCCESS) {
     throw std::runtime_error("failed to allocate image memory!");
   }
+  memoryTracker_->recordAllocation(
+      imageMemory,
+      allocInfo.memoryTypeIndex,
+      allocInfo.allocationSize,
+      BurnhopeMemoryTracker::categoryForImage(imageInfo.usage));
 
   if (vkBindImageMemory(device_, image, imageMemory, 0) != VK_SUCCESS) {
     throw std::runtime_error("failed to bind image memory!");
   }
 }
 
+void BurnhopeDevice::freeMemory(VkDeviceMemory memory) {
+  memoryTracker_->recordFree(memory);
+  vkFreeMemory(device_, memory, nullptr);
+}
+
 void BurnhopeDevice::transitionImageLayout(
     VkImage image,
     VkFormat format,
@@ -1,8 +1,10 @@
 #pragma once
 
+#include "lve_memory_tracker.hpp"
 #include "lve_window.hpp"
 
 // std lib headers
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -22,6 +24,24 @@ struct QueueFamilyIndices {
   bool isComplete() { return graphicsFamilyHasValue && presentFamilyHasValue; }
 };
 
+// What a resource's memory is used for; drives memory type selection in findMemoryType.
+enum class MemoryUsage {
+  GpuOnly,       // written once via staging, read by the GPU (vertex/index buffers)
+  CpuToGpu,      // rewritten by the CPU every frame and read by the GPU (per-frame UBOs)
+  GpuToCpu,      // written by the GPU and read back by the CPU
+  Staging,       // short lived upload source for copies
+};
+
+const char *memoryUsageName(MemoryUsage usage);
+
+// entry points of optional descriptor extensions, null when the extension is not enabled
+struct DescriptorFunctions {
+  PFN_vkCreateDescriptorUpdateTemplateKHR createUpdateTemplate = nullptr;
+  PFN_vkDestroyDescriptorUpdateTemplateKHR destroyUpdateTemplate = nullptr;
+  PFN_vkUpdateDescriptorSetWithTemplateKHR updateWithTemplate = nullptr;
+  PFN_vkCmdPushDescriptorSetKHR cmdPushDescriptorSet = nullptr;
+};
+
 class BurnhopeDevice {
  public:
 #ifdef NDEBUG
@@ -31,6 +51,9 @@ class BurnhopeDevice {
 #endif
 
   BurnhopeDevice(BurnhopeWindow &window);
+  // a null window creates a headless device: no surface, no swapchain extension, present
+  // queue aliases the graphics queue
+  explicit BurnhopeDevice(BurnhopeWindow *window);
   ~BurnhopeDevice();
 
   // Not copyable or movable
@@ -44,9 +67,32 @@ class BurnhopeDevice {
   VkSurfaceKHR surface() { return surface_; }
   VkQueue graphicsQueue() { return graphicsQueue_; }
   VkQueue presentQueue() { return presentQueue_; }
+  VkPipelineCache pipelineCache() { return pipelineCache_; }
+  bool isHeadless() const { return window == nullptr; }
+  bool isPipelineCacheWarm() const { return pipelineCacheWarm; }
+  BurnhopeMemoryTracker &memoryTracker() { return *memoryTracker_; }
+  const DescriptorFunctions &descriptorFunctions() const { return descriptorFunctions_; }
+  bool supportsUpdateTemplates() const {
+    return descriptorFunctions_.createUpdateTemplate != nullptr;
+  }
+  bool supportsPushDescriptors() const {
+    return descriptorFunctions_.cmdPushDescriptorSet != nullptr;
+  }
+  // optional features that were available and turned on, e.g. multiDrawIndirect
+  const VkPhysicalDeviceFeatures &getEnabledFeatures() const { return enabledFeatures; }
+  // vkCmdDrawIndexedIndirectCountKHR, nullptr without VK_KHR_draw_indirect_count
+  PFN_vkCmdDrawIndexedIndirectCountKHR cmdDrawIndexedIndirectCount() const {
+    return cmdDrawIndexedIndirectCount_;
+  }
 
   SwapChainSupportDetails getSwapChainSupport() { return querySwapChainSupport(physicalDevice); }
   uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
+  uint32_t findMemoryType(uint32_t typeFilter, MemoryUsage usage);
+  VkMemoryPropertyFlags getMemoryTypeFlags(uint32_t memoryTypeIndex) const {
+    return memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags;
+  }
+  // true when a large (> 256 MiB) DEVICE_LOCAL | HOST_VISIBLE heap is exposed
+  bool hasResizableBar() const { return resizableBar; }
   QueueFamilyIndices findPhysicalQueueFamilies() { return findQueueFamilies(physicalDevice); }
   VkFormat findSupportedFormat(
       const std::vector<VkFormat> &candidates, VkImageTiling tiling, VkFormatFeatureFlags features);
@@ -58,6 +104,12 @@ class BurnhopeDevice {
       VkMemoryPropertyFlags properties,
       VkBuffer &buffer,
       VkDeviceMemory &bufferMemory);
+  void createBuffer(
+      VkDeviceSize size,
+      VkBufferUsageFlags usage,
+      MemoryUsage memoryUsage,
+      VkBuffer &buffer,
+      VkDeviceMemory &bufferMemory);
   VkCommandBuffer beginSingleTimeCommands();
   void endSingleTimeCommands(VkCommandBuffer commandBuffer);
   void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
@@ -69,6 +121,8 @@ class BurnhopeDevice {
       VkMemoryPropertyFlags properties,
       VkImage &image,
       VkDeviceMemory &imageMemory);
+  // frees memory from createBuffer / createImageWithInfo and removes it from the memory tracker
+  void freeMemory(VkDeviceMemory memory);
 
   void transitionImageLayout(
       VkImage image,
@@ -87,30 +141,59 @@ class BurnhopeDevice {
   void pickPhysicalDevice();
   void createLogicalDevice();
   void createCommandPool();
+  void createPipelineCache();
+  void savePipelineCache();
+  void createMemoryTracker();
+  void loadDescriptorFunctions();
+  void detectResizableBar();
 
   // helper functions
   bool isDeviceSuitable(VkPhysicalDevice device);
   std::vector<const char *> getRequiredExtensions();
+  std::vector<const char *> getRequiredDeviceExtensions();
   bool checkValidationLayerSupport();
   QueueFamilyIndices findQueueFamilies(VkPhysicalDevice device);
   void populateDebugMessengerCreateInfo(VkDebugUtilsMessengerCreateInfoEXT &createInfo);
   void hasGflwRequiredInstanceExtensions();
   bool checkDeviceExtensionSupport(VkPhysicalDevice device);
+  bool isInstanceExtensionAvailable(const char *extensionName);
+  bool isDeviceExtensionAvailable(const char *extensionName);
   SwapChainSupportDetails querySwapChainSupport(VkPhysicalDevice device);
+  bool isPipelineCacheCompatible(const std::vector<char> &cacheData);
+  VkMemoryRequirements createBufferHandle(
+      VkDeviceSize size, VkBufferUsageFlags usage, VkBuffer &buffer);
+  void allocateBufferMemory(
+      VkBuffer buffer,
+      VkBufferUsageFlags usage,
+      VkDeviceSize allocationSize,
+      uint32_t memoryTypeIndex,
+      VkDeviceMemory &bufferMemory);
 
   VkInstance instance;
   VkDebugUtilsMessengerEXT debugMessenger;
   VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
-  BurnhopeWindow &window;
+  VkPhysicalDeviceMemoryProperties memoryProperties;
+  bool resizableBar = false;
+  BurnhopeWindow *window;
   VkCommandPool commandPool;
 
   VkDevice device_;
   VkSurfaceKHR surface_;
   VkQueue graphicsQueue_;
   VkQueue presentQueue_;
+  VkPipelineCache pipelineCache_ = VK_NULL_HANDLE;
+  bool pipelineCacheWarm = false;
+  bool physicalDeviceProperties2Enabled = false;
+  bool memoryBudgetEnabled = false;
+  bool descriptorUpdateTemplateEnabled = false;
+  bool pushDescriptorEnabled = false;
+  DescriptorFunctions descriptorFunctions_{};
+  VkPhysicalDeviceFeatures enabledFeatures{};
+  PFN_vkCmdDrawIndexedIndirectCountKHR cmdDrawIndexedIndirectCount_ = nullptr;
+  std::unique_ptr<BurnhopeMemoryTracker> memoryTracker_;
 
   const std::vector<const char *> validationLayers = {"VK_LAYER_KHRONOS_validation"};
-  const std::vector<const char *> deviceExtensions = {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
+  const std::string pipelineCacheFile = "pipeline_cache.bin";
 };
 
 }  // namespace burnhope
@@ -9,20 +9,28 @@
 
 namespace burnhope {
 
-#define MAX_LIGHTS 10
+// capacity of the per-frame light buffer, lights are culled per cluster before shading
+#define MAX_LIGHTS 4096
 
 struct PointLight {
-  glm::vec4 position{};  // ignore w
+  glm::vec4 position{};  // w is the range, beyond which the light contributes nothing
   glm::vec4 color{};     // w is intensity
+  glm::ivec4 shadow{-1, 0, 0, 0};  // x is the first of its six shadow views, -1 if unshadowed
 };
 
 struct GlobalUbo {
   glm::mat4 projection{1.f};
   glm::mat4 view{1.f};
   glm::mat4 inverseView{1.f};
-  glm::vec4 ambientLightColor{1.f, 1.f, 1.f, .02f};  // w is intensity
-  PointLight pointLights[MAX_LIGHTS];
+  glm::vec4 ambientLightColor{1.f, 1.f, 1.f, .3f};  // scales the environment, w is intensity
+  // froxel grid mapping, see LightClusterSystem::updateUbo
+  glm::vec4 clusterDepth{};  // near, far, slice scale, slice bias
+  glm::vec2 screenSize{};
   int numLights;
+  int clusterDebug;  // non-zero shades lights per cluster as a heat map
+  glm::vec4 sunDirection{};  // towards the sun, w is intensity
+  glm::vec4 sunColor{};
+  int sunShadowView = -1;  // index into the shadow views, -1 if the sun casts no shadows
 };
 
 struct FrameInfo {
@@ -32,8 +40,16 @@ struct FrameInfo {
   BurnhopeCamera &camera;
   VkDescriptorSet globalDescriptorSet;
   BurnhopeDescriptorPool &frameDescriptorPool;  // pool of descriptors that is cleared each frame
-  BurnhopeGameObject::Map &gameObjects;
-  std::shared_ptr<BurnhopeTexture> shadowMap;
-  glm::mat4 lightSpaceMatrix;
+  BurnhopeComponentStore &components;
+  uint32_t lightCount = 0;  // point lights shaded this frame, set once they are gathered
+  VkDescriptorBufferInfo sceneBufferInfo{};  // set once the game objects buffer is updated
+  // Changes whenever the scene buffer is replaced. Descriptor caches compare it instead of the
+  // buffer handle, which a later buffer can reuse once the old one is freed.
+  uint64_t sceneBufferVersion = 0;
+  // world space bounds of the objects with a model, set along with sceneBufferInfo
+  const BoundingSphereArray *objectBounds = nullptr;
+  const std::vector<BurnhopeGameObject::id_t> *boundsOwners = nullptr;
+  // when set, already culling objectBounds for this frame on its worker thread
+  BurnhopeOcclusionCuller *occlusionCuller = nullptr;
 };
 }  // namespace burnhope
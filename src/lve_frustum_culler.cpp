@@ -0,0 +1,135 @@
+#include "lve_frustum_culler.hpp"
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define BURNHOPE_CULL_AVX
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define BURNHOPE_CULL_SSE
+#endif
+
+namespace burnhope {
+
+void BoundingSphereArray::clear() {
+  centerX.clear();
+  centerY.clear();
+  centerZ.clear();
+  radius.clear();
+}
+
+void BoundingSphereArray::reserve(size_t count) {
+  centerX.reserve(count);
+  centerY.reserve(count);
+  centerZ.reserve(count);
+  radius.reserve(count);
+}
+
+void BoundingSphereArray::push_back(const glm::vec4 &sphere) {
+  centerX.push_back(sphere.x);
+  centerY.push_back(sphere.y);
+  centerZ.push_back(sphere.z);
+  radius.push_back(sphere.w);
+}
+
+const char *BurnhopeFrustumCuller::instructionSet() {
+#if defined(BURNHOPE_CULL_AVX)
+  return "AVX";
+#elif defined(BURNHOPE_CULL_SSE)
+  return "SSE2";
+#else
+  return "scalar";
+#endif
+}
+
+void BurnhopeFrustumCuller::cullScalar(
+    const BoundingSphereArray &spheres,
+    const Planes &planes,
+    std::vector<uint32_t> &visibleIndices,
+    size_t first) {
+  for (size_t i = first; i < spheres.size(); i++) {
+    bool visible = true;
+    for (const auto &plane : planes) {
+      // same association as the SIMD paths so both agree on borderline spheres
+      float distance = (plane.x * spheres.centerX[i] + plane.y * spheres.centerY[i]) +
+                       (plane.z * spheres.centerZ[i] + plane.w);
+      if (distance < -spheres.radius[i]) {
+        visible = false;
+        break;
+      }
+    }
+    if (visible) {
+      visibleIndices.push_back(static_cast<uint32_t>(i));
+    }
+  }
+}
+
+void BurnhopeFrustumCuller::cull(
+    const BoundingSphereArray &spheres,
+    const Planes &planes,
+    std::vector<uint32_t> &visibleIndices) {
+  const size_t count = spheres.size();
+  size_t i = 0;
+
+#if defined(BURNHOPE_CULL_AVX)
+  __m256 planeX[6], planeY[6], planeZ[6], planeW[6];
+  for (int p = 0; p < 6; p++) {
+    planeX[p] = _mm256_set1_ps(planes[p].x);
+    planeY[p] = _mm256_set1_ps(planes[p].y);
+    planeZ[p] = _mm256_set1_ps(planes[p].z);
+    planeW[p] = _mm256_set1_ps(planes[p].w);
+  }
+  const __m256 zero = _mm256_setzero_ps();
+  for (; i + 8 <= count; i += 8) {
+    __m256 x = _mm256_loadu_ps(&spheres.centerX[i]);
+    __m256 y = _mm256_loadu_ps(&spheres.centerY[i]);
+    __m256 z = _mm256_loadu_ps(&spheres.centerZ[i]);
+    __m256 negRadius = _mm256_sub_ps(zero, _mm256_loadu_ps(&spheres.radius[i]));
+    __m256 inside = _mm256_cmp_ps(zero, zero, _CMP_EQ_OQ);
+    for (int p = 0; p < 6; p++) {
+      __m256 distance = _mm256_add_ps(
+          _mm256_add_ps(_mm256_mul_ps(planeX[p], x), _mm256_mul_ps(planeY[p], y)),
+          _mm256_add_ps(_mm256_mul_ps(planeZ[p], z), planeW[p]));
+      inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, negRadius, _CMP_GE_OQ));
+    }
+    int mask = _mm256_movemask_ps(inside);
+    for (int lane = 0; mask != 0; lane++, mask >>= 1) {
+      if (mask & 1) visibleIndices.push_back(static_cast<uint32_t>(i + lane));
+    }
+  }
+#elif defined(BURNHOPE_CULL_SSE)
+  __m128 planeX[6], planeY[6], planeZ[6], planeW[6];
+  for (int p = 0; p < 6; p++) {
+    planeX[p] = _mm_set1_ps(planes[p].x);
+    planeY[p] = _mm_set1_ps(planes[p].y);
+    planeZ[p] = _mm_set1_ps(planes[p].z);
+    planeW[p] = _mm_set1_ps(planes[p].w);
+  }
+  const __m128 zero = _mm_setzero_ps();
+  // two four wide halves per iteration to match the AVX path's eight objects
+  for (; i + 8 <= count; i += 8) {
+    int mask = 0;
+    for (int half = 0; half < 2; half++) {
+      size_t base = i + half * 4;
+      __m128 x = _mm_loadu_ps(&spheres.centerX[base]);
+      __m128 y = _mm_loadu_ps(&spheres.centerY[base]);
+      __m128 z = _mm_loadu_ps(&spheres.centerZ[base]);
+      __m128 negRadius = _mm_sub_ps(zero, _mm_loadu_ps(&spheres.radius[base]));
+      __m128 inside = _mm_cmpeq_ps(zero, zero);
+      for (int p = 0; p < 6; p++) {
+        __m128 distance = _mm_add_ps(
+            _mm_add_ps(_mm_mul_ps(planeX[p], x), _mm_mul_ps(planeY[p], y)),
+            _mm_add_ps(_mm_mul_ps(planeZ[p], z), planeW[p]));
+        inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negRadius));
+      }
+      mask |= _mm_movemask_ps(inside) << (half * 4);
+    }
+    for (int lane = 0; mask != 0; lane++, mask >>= 1) {
+      if (mask & 1) visibleIndices.push_back(static_cast<uint32_t>(i + lane));
+    }
+  }
+#endif
+
+  cullScalar(spheres, planes, visibleIndices, i);
+}
+
+}  // namespace burnhope
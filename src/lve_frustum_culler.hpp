@@ -0,0 +1,51 @@
+#pragma once
+
+// libs
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+// std
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace burnhope {
+
+// bounding spheres in structure of arrays form, so eight of them load with one AVX register per
+// component
+struct BoundingSphereArray {
+  std::vector<float> centerX;
+  std::vector<float> centerY;
+  std::vector<float> centerZ;
+  std::vector<float> radius;
+
+  size_t size() const { return radius.size(); }
+  void clear();
+  void reserve(size_t count);
+  // xyz is the center and w the radius
+  void push_back(const glm::vec4 &sphere);
+};
+
+// Frustum culling of bounding spheres, eight per iteration with AVX (BURNHOPE_AVX), two SSE
+// halves on other x86 builds and a scalar loop elsewhere.
+class BurnhopeFrustumCuller {
+ public:
+  using Planes = std::array<glm::vec4, 6>;
+
+  // appends the index of every sphere inside or intersecting all planes to visibleIndices
+  static void cull(
+      const BoundingSphereArray &spheres,
+      const Planes &planes,
+      std::vector<uint32_t> &visibleIndices);
+  // the same test one sphere at a time, used for the tail and as a reference
+  static void cullScalar(
+      const BoundingSphereArray &spheres,
+      const Planes &planes,
+      std::vector<uint32_t> &visibleIndices,
+      size_t first = 0);
+
+  static const char *instructionSet();
+};
+
+}  // namespace burnhope
@@ -1,10 +1,11 @@
 #include "lve_game_object.hpp"
 
-#include <numeric>
+// std
+#include <iostream>
 
 namespace burnhope {
 
-glm::mat4 TransformComponent::mat4() {
+glm::mat4 TransformComponent::mat4() const {
   const float c3 = glm::cos(rotation.z);
   const float s3 = glm::sin(rotation.z);
   const float c2 = glm::cos(rotation.x);
@@ -33,7 +34,7 @@ glm::mat4 TransformComponent::mat4() {
       {translation.x, translation.y, translation.z, 1.0f}};
 }
 
-glm::mat3 TransformComponent::normalMatrix() {
+glm::mat3 TransformComponent::normalMatrix() const {
   const float c3 = glm::cos(rotation.z);
   const float s3 = glm::sin(rotation.z);
   const float c2 = glm::cos(rotation.x);
@@ -61,53 +62,173 @@ glm::mat3 TransformComponent::normalMatrix() {
   };
 }
 
-BurnhopeGameObject& BurnhopeGameObjectManager::makePointLight(
+void BurnhopeComponentStore::removeAll(uint32_t entity) {
+  transforms.remove(entity);
+  models.remove(entity);
+  materials.remove(entity);
+  occluders.remove(entity);
+  pointLights.remove(entity);
+}
+
+BurnhopeGameObject::BurnhopeGameObject(BurnhopeComponentStore& store, id_t objId)
+    : store{&store}, id{objId}, generation{store.generations[objId]} {}
+
+void BurnhopeGameObject::setMaterial(std::shared_ptr<Material> material) {
+  store->materials.add(id, std::move(material));
+  store->structureVersion++;
+}
+
+BurnhopeModel* BurnhopeGameObject::model() const {
+  auto* model = store->models.tryGet(id);
+  return model != nullptr ? model->get() : nullptr;
+}
+
+void BurnhopeGameObject::setModel(std::shared_ptr<BurnhopeModel> model) {
+  if (model != nullptr) {
+    store->models.add(id, std::move(model));
+  } else {
+    store->models.remove(id);
+  }
+  store->structureVersion++;
+}
+
+OccluderMesh* BurnhopeGameObject::occluder() const {
+  auto* occluder = store->occluders.tryGet(id);
+  return occluder != nullptr ? occluder->get() : nullptr;
+}
+
+void BurnhopeGameObject::setOccluder(std::shared_ptr<OccluderMesh> occluder) {
+  if (occluder != nullptr) {
+    store->occluders.add(id, std::move(occluder));
+  } else {
+    store->occluders.remove(id);
+  }
+}
+
+PointLightComponent& BurnhopeGameObject::addPointLight(float intensity, glm::vec3 color) {
+  PointLightComponent pointLight{};
+  pointLight.lightIntensity = intensity;
+  pointLight.color = color;
+  return store->pointLights.add(id, pointLight);
+}
+
+BurnhopeGameObject BurnhopeGameObjectManager::createGameObject() {
+  BurnhopeGameObject::id_t id;
+  if (!freeIds.empty()) {
+    id = freeIds.back();
+    freeIds.pop_back();
+  } else {
+    id = static_cast<BurnhopeGameObject::id_t>(components.generations.size());
+    components.generations.push_back(0);
+  }
+  auto gameObject = BurnhopeGameObject{components, id};
+  components.transforms.add(id);
+  auto material = std::make_shared<Material>();
+  material->setDiffuseMap(textureDefault);
+  gameObject.setMaterial(std::move(material));
+  return gameObject;
+}
+
+void BurnhopeGameObjectManager::destroyGameObject(BurnhopeGameObject gameObject) {
+  if (!gameObject.isAlive()) return;
+  BurnhopeGameObject::id_t id = gameObject.getId();
+  // the last object's transform moves into the hole, so the scene records stay packed
+  components.removeAll(id);
+  components.generations[id]++;
+  components.structureVersion++;
+  freeIds.push_back(id);
+}
+
+BurnhopeGameObject BurnhopeGameObjectManager::makePointLight(
     float intensity, float radius, glm::vec3 color) {
-  auto& gameObj = createGameObject();
-  gameObj.color = color;
-  gameObj.transform.scale.x = radius;
-  gameObj.pointLight = std::make_unique<PointLightComponent>();
-  gameObj.pointLight->lightIntensity = intensity;
+  auto gameObj = createGameObject();
+  gameObj.transform().scale.x = radius;
+  gameObj.addPointLight(intensity, color);
   return gameObj;
 }
 
-BurnhopeGameObjectManager::BurnhopeGameObjectManager(BurnhopeDevice& device) {
-  // including nonCoherentAtomSize allows us to flush a specific index at once
-  int alignment = std::lcm(
-      device.properties.limits.nonCoherentAtomSize,
-      device.properties.limits.minUniformBufferOffsetAlignment);
-  for (int i = 0; i < uboBuffers.size(); i++) {
-    uboBuffers[i] = std::make_unique<BurnhopeBuffer>(
-        device,
-        sizeof(GameObjectBufferData),
-        BurnhopeGameObjectManager::MAX_GAME_OBJECTS,
-        VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
-        alignment);
-    uboBuffers[i]->map();
+BurnhopeGameObjectManager::BurnhopeGameObjectManager(BurnhopeDevice& device)
+    : lveDevice{device} {
+  for (size_t i = 0; i < sceneBuffers.size(); i++) {
+    sceneBuffers[i] = createSceneBuffer(INITIAL_SCENE_CAPACITY);
+    sceneBufferVersions[i] = ++nextSceneBufferVersion;
   }
 
   textureDefault = BurnhopeTexture::createTextureFromFile(device, "../textures/missing.png");
 }
 
-void BurnhopeGameObjectManager::updateBuffer(int frameIndex) {
-  // copy model matrix and normal matrix for each gameObj into
-  // buffer for this frame
-  for (auto& kv : gameObjects) {
-    auto& obj = kv.second;
-    GameObjectBufferData data{};
-    data.modelMatrix = obj.transform.mat4();
-    data.normalMatrix = obj.transform.normalMatrix();
-    uboBuffers[frameIndex]->writeToIndex(&data, kv.first);
-  }
-  uboBuffers[frameIndex]->flush();
+std::unique_ptr<BurnhopeBuffer> BurnhopeGameObjectManager::createSceneBuffer(uint32_t capacity) {
+  // records are tightly packed, flushDirtyRanges takes care of nonCoherentAtomSize
+  auto sceneBuffer = std::make_unique<BurnhopeBuffer>(
+      lveDevice,
+      sizeof(GameObjectBufferData),
+      capacity,
+      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+      MemoryUsage::CpuToGpu);
+  sceneBuffer->map();
+  return sceneBuffer;
 }
 
-VkDescriptorBufferInfo BurnhopeGameObject::getBufferInfo(int frameIndex) {
-  return gameObjectManager.getBufferInfoForGameObject(frameIndex, id);
+uint32_t BurnhopeGameObjectManager::getMaterialIndex(const Material* material) {
+  auto it = materialIndices.find(material);
+  if (it != materialIndices.end()) {
+    return it->second;
+  }
+  uint32_t index = static_cast<uint32_t>(materialIndices.size());
+  materialIndices.emplace(material, index);
+  return index;
 }
 
-BurnhopeGameObject::BurnhopeGameObject(id_t objId, const BurnhopeGameObjectManager& manager)
-    : id{objId}, gameObjectManager{manager} {}
+void BurnhopeGameObjectManager::updateBuffer(int frameIndex) {
+  // the buffer retired the last time this frame index came around is no longer in use
+  retiredSceneBuffers[frameIndex].reset();
+
+  // records are indexed by transform slot, which stays packed, so the buffer only has to hold
+  // the live objects no matter how many were created and destroyed before
+  auto& sceneBuffer = sceneBuffers[frameIndex];
+  uint32_t objectCount = getObjectCount();
+  uint32_t capacity = sceneBuffer->getInstanceCount();
+  if (capacity < objectCount ||
+      (capacity > INITIAL_SCENE_CAPACITY && objectCount < capacity / 4)) {
+    // shrinking leaves room for twice the objects, so churn around a size doesn't thrash
+    uint32_t newCapacity = INITIAL_SCENE_CAPACITY;
+    while (newCapacity < objectCount * 2 && newCapacity < capacity) {
+      newCapacity *= 2;
+    }
+    while (newCapacity < objectCount) {
+      newCapacity *= 2;
+    }
+    std::cout << "scene buffer " << frameIndex << " resized to " << newCapacity << " objects\n";
+    retiredSceneBuffers[frameIndex] = std::move(sceneBuffer);
+    sceneBuffer = createSceneBuffer(newCapacity);
+    sceneBufferVersions[frameIndex] = ++nextSceneBufferVersion;
+  }
+
+  // one pass over the packed transforms, the other components are looked up by entity
+  materialIndices.clear();
+  objectBounds.clear();
+  boundsOwners.clear();
+  auto transforms = components.transforms.components();
+  auto entities = components.transforms.entities();
+  for (size_t i = 0; i < transforms.size(); i++) {
+    const TransformComponent& transform = transforms[i];
+    BurnhopeGameObject::id_t entity = entities[i];
+    GameObjectBufferData data{};
+    data.modelMatrix = transform.mat4();
+    data.normalMatrix = transform.normalMatrix();
+    if (const auto* model = components.models.tryGet(entity)) {
+      glm::vec4 sphere = (*model)->getBoundingSphere();
+      glm::vec3 scale = glm::abs(transform.scale);
+      float maxScale = glm::max(scale.x, glm::max(scale.y, scale.z));
+      glm::vec4 center = data.modelMatrix * glm::vec4(glm::vec3(sphere), 1.f);
+      data.boundingSphere = glm::vec4(glm::vec3(center), sphere.w * maxScale);
+      objectBounds.push_back(data.boundingSphere);
+      boundsOwners.push_back(entity);
+    }
+    data.materialIndex = getMaterialIndex(components.materials.get(entity).get());
+    sceneBuffer->writeToIndex(&data, static_cast<uint32_t>(i));
+  }
+  sceneBuffer->flushDirtyRanges();
+}
 
-}  // namespace burnhope
\ No newline at end of file
+}  // namespace burnhope
@@ -1,6 +1,9 @@
 #pragma once
 #include "Material.hpp"
+#include "lve_component_store.hpp"
+#include "lve_frustum_culler.hpp"
 #include "lve_model.hpp"
+#include "lve_occlusion_culler.hpp"
 #include "lve_swap_chain.hpp"
 #include "lve_texture.hpp"
 
@@ -9,6 +12,7 @@
 
 // std
 #include <memory>
+#include <optional>
 #include <unordered_map>
 
 namespace burnhope {
@@ -21,58 +25,93 @@ struct TransformComponent {
   // Matrix corrsponds to Translate * Ry * Rx * Rz * Scale
   // Rotations correspond to Tait-bryan angles of Y(1), X(2), Z(3)
   // https://en.wikipedia.org/wiki/Euler_angles#Rotation_matrix
-  glm::mat4 mat4();
+  glm::mat4 mat4() const;
 
-  glm::mat3 normalMatrix();
+  glm::mat3 normalMatrix() const;
 };
 
 struct PointLightComponent {
   float lightIntensity = 1.0f;
+  glm::vec3 color{1.f};
 };
 
+// Every component of every object, one tightly packed array per component type. Systems
+// iterate the array they need as a contiguous span instead of walking all objects.
+struct BurnhopeComponentStore {
+  ComponentArray<TransformComponent> transforms;
+  ComponentArray<std::shared_ptr<BurnhopeModel>> models;
+  ComponentArray<std::shared_ptr<Material>> materials;
+  // marks the object as an occluder for CPU occlusion culling
+  ComponentArray<std::shared_ptr<OccluderMesh>> occluders;
+  ComponentArray<PointLightComponent> pointLights;
+
+  // per entity id, bumped when the id is freed so handles to the destroyed object stop matching
+  std::vector<uint32_t> generations;
+  // bumped whenever objects are added or destroyed or change model or material, so cached draw
+  // lists get rebuilt
+  uint64_t structureVersion = 0;
+
+  // removes every component of the entity
+  void removeAll(uint32_t entity);
+};
+
+// one record per object in the GPU scene buffer, matches GameObjectData in simple_shader.vert
+// (std430)
 struct GameObjectBufferData {
   glm::mat4 modelMatrix{1.f};
   glm::mat4 normalMatrix{1.f};
+  glm::vec4 boundingSphere{0.f};  // world space, xyz is the center and w the radius
+  uint32_t materialIndex = 0;
+  uint32_t padding[3]{};
 };
+static_assert(sizeof(GameObjectBufferData) == 160, "must match the std430 array stride");
 
 class BurnhopeGameObjectManager;  // forward declare game object manager class
 
+// Handle to an object whose components live in the manager's component store. Cheap to copy,
+// and stays valid while the store grows. Ids are reused once an object is destroyed, the
+// generation tells a stale handle from the object now holding its id.
 class BurnhopeGameObject {
  public:
-  using id_t = unsigned int;
-  using Map = std::unordered_map<id_t, BurnhopeGameObject>;
-
-  BurnhopeGameObject(BurnhopeGameObject &&) = default;
-  BurnhopeGameObject(const BurnhopeGameObject &) = delete;
-  BurnhopeGameObject &operator=(const BurnhopeGameObject &) = delete;
-  BurnhopeGameObject &operator=(BurnhopeGameObject &&) = delete;
-
-  id_t getId() { return id; }
-
-  VkDescriptorBufferInfo getBufferInfo(int frameIndex);
-
-  glm::vec3 color{};
-  TransformComponent transform{};
-
-  // Optional pointer components
-  std::shared_ptr<BurnhopeModel> model{};
-  std::shared_ptr<Material> material;
-  
-
-  std::unique_ptr<PointLightComponent> pointLight = nullptr;
+  using id_t = uint32_t;
+
+  id_t getId() const { return id; }
+  uint32_t getGeneration() const { return generation; }
+  // false once the object has been destroyed, the accessors below must not be used then
+  bool isAlive() const { return store->generations[id] == generation; }
+
+  // Index of the object's record in the scene buffer, drawn as firstInstance. It is the
+  // object's slot in the packed transforms, so it changes when other objects are destroyed.
+  uint32_t getSceneIndex() const { return store->transforms.slotOf(id); }
+
+  // every object has a transform and a material
+  TransformComponent &transform() const { return store->transforms.get(id); }
+  const std::shared_ptr<Material> &material() const { return store->materials.get(id); }
+  void setMaterial(std::shared_ptr<Material> material);
+
+  // optional components, nullptr when the object has none. Setting nullptr removes them.
+  BurnhopeModel *model() const;
+  void setModel(std::shared_ptr<BurnhopeModel> model);
+  OccluderMesh *occluder() const;
+  void setOccluder(std::shared_ptr<OccluderMesh> occluder);
+  PointLightComponent *pointLight() const { return store->pointLights.tryGet(id); }
+  PointLightComponent &addPointLight(float intensity, glm::vec3 color);
 
  private:
-  BurnhopeGameObject(id_t objId, const BurnhopeGameObjectManager &manager);
+  BurnhopeGameObject(BurnhopeComponentStore &store, id_t objId);
 
+  BurnhopeComponentStore *store;
   id_t id;
-  const BurnhopeGameObjectManager &gameObjectManager;
+  uint32_t generation;
 
   friend class BurnhopeGameObjectManager;
 };
 
 class BurnhopeGameObjectManager {
  public:
-  static constexpr int MAX_GAME_OBJECTS = 1000;
+  // The scene buffers start with this many records and double when the object count outgrows
+  // them. They halve again once the objects fit in a quarter, never below this.
+  static constexpr uint32_t INITIAL_SCENE_CAPACITY = 1024;
 
   BurnhopeGameObjectManager(BurnhopeDevice &device);
   BurnhopeGameObjectManager(const BurnhopeGameObjectManager &) = delete;
@@ -80,31 +119,73 @@ class BurnhopeGameObjectManager {
   BurnhopeGameObjectManager(BurnhopeGameObjectManager &&) = delete;
   BurnhopeGameObjectManager &operator=(BurnhopeGameObjectManager &&) = delete;
 
-  BurnhopeGameObject &createGameObject() {
-    assert(currentId < MAX_GAME_OBJECTS && "Max game object count exceeded!");
-    auto gameObject = BurnhopeGameObject{currentId++, *this};
-    auto gameObjectId = gameObject.getId();
-    gameObject.material = std::make_shared<Material>();
-    gameObject.material->diffuseMap = textureDefault;
-    gameObjects.emplace(gameObjectId, std::move(gameObject));
-    return gameObjects.at(gameObjectId);
-  }
+  // a new object with a transform and a material of its own, reusing a freed id if there is one
+  BurnhopeGameObject createGameObject();
+  // Removes the object's components and frees its id. Its handles stop being alive. Not between
+  // updateBuffer and the end of recording, since scene indices move.
+  void destroyGameObject(BurnhopeGameObject gameObject);
 
-  BurnhopeGameObject &makePointLight(
+  BurnhopeGameObject makePointLight(
       float intensity = 10.f, float radius = 0.1f, glm::vec3 color = glm::vec3(1.f));
 
-  VkDescriptorBufferInfo getBufferInfoForGameObject(
-      int frameIndex, BurnhopeGameObject::id_t gameObjectId) const {
-    return uboBuffers[frameIndex]->descriptorInfoForIndex(gameObjectId);
+  // the object currently holding the id, nullopt if the id is free or was never handed out
+  std::optional<BurnhopeGameObject> getGameObject(BurnhopeGameObject::id_t id) {
+    if (id >= components.generations.size() || !components.transforms.has(id)) {
+      return std::nullopt;
+    }
+    return BurnhopeGameObject{components, id};
+  }
+  uint32_t getObjectCount() const { return static_cast<uint32_t>(components.transforms.size()); }
+  // ids handed out so far, live or free
+  uint32_t getIdCapacity() const { return static_cast<uint32_t>(components.generations.size()); }
+
+  // bumped whenever objects are added or change model or material. Call markStructureChanged
+  // after changing a model or material in place so cached draw lists get rebuilt.
+  uint64_t getStructureVersion() const { return components.structureVersion; }
+  void markStructureChanged() { components.structureVersion++; }
+
+  // the whole scene buffer of a frame, bound once and indexed with gl_InstanceIndex
+  VkDescriptorBufferInfo getSceneBufferInfo(int frameIndex) const {
+    return sceneBuffers[frameIndex]->descriptorInfo();
   }
 
+  // Writes every object's record into this frame's scene buffer, resizing it first if needed.
+  // Call after the frame's fence has been waited on.
   void updateBuffer(int frameIndex);
+  uint32_t getSceneCapacity(int frameIndex) const {
+    return sceneBuffers[frameIndex]->getInstanceCount();
+  }
+  // unique to each scene buffer ever created, so it changes whenever one is replaced
+  uint64_t getSceneBufferVersion(int frameIndex) const {
+    return sceneBufferVersions[frameIndex];
+  }
+
+  // world space bounding spheres of every object with a model as of the last updateBuffer, with
+  // the object each one belongs to
+  const BoundingSphereArray &getObjectBounds() const { return objectBounds; }
+  const std::vector<BurnhopeGameObject::id_t> &getBoundsOwners() const { return boundsOwners; }
 
-  BurnhopeGameObject::Map gameObjects{};
-  std::vector<std::unique_ptr<BurnhopeBuffer>> uboBuffers{BurnhopeSwapChain::MAX_FRAMES_IN_FLIGHT};
+  BurnhopeComponentStore components{};
+  std::vector<std::unique_ptr<BurnhopeBuffer>> sceneBuffers{
+      BurnhopeSwapChain::MAX_FRAMES_IN_FLIGHT};
 
  private:
-  BurnhopeGameObject::id_t currentId = 0;
+  std::unique_ptr<BurnhopeBuffer> createSceneBuffer(uint32_t capacity);
+  uint32_t getMaterialIndex(const Material *material);
+
+  BurnhopeDevice &lveDevice;
+  std::vector<BurnhopeGameObject::id_t> freeIds;
+  std::vector<uint64_t> sceneBufferVersions =
+      std::vector<uint64_t>(BurnhopeSwapChain::MAX_FRAMES_IN_FLIGHT);
+  uint64_t nextSceneBufferVersion = 0;
+  // a replaced scene buffer is freed the next time its frame index comes around, after that
+  // frame's fence has been waited on again
+  std::vector<std::unique_ptr<BurnhopeBuffer>> retiredSceneBuffers{
+      BurnhopeSwapChain::MAX_FRAMES_IN_FLIGHT};
+  BoundingSphereArray objectBounds;
+  std::vector<BurnhopeGameObject::id_t> boundsOwners;
+  // materials in use this frame, in first-seen order
+  std::unordered_map<const Material *, uint32_t> materialIndices;
   std::shared_ptr<BurnhopeTexture> textureDefault;
 };
 
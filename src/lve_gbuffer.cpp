@@ -0,0 +1,273 @@
+#include "lve_gbuffer.hpp"
+
+// std
+#include <stdexcept>
+#include <vector>
+
+namespace burnhope {
+
+namespace {
+
+// attachment indices of the render pass and framebuffer
+constexpr uint32_t ALBEDO_ATTACHMENT = 0;
+constexpr uint32_t NORMAL_ATTACHMENT = 1;
+constexpr uint32_t ORM_ATTACHMENT = 2;
+constexpr uint32_t DEPTH_ATTACHMENT = 3;
+constexpr uint32_t LIT_ATTACHMENT = 4;
+constexpr uint32_t ATTACHMENT_COUNT = 5;
+
+constexpr VkFormat ALBEDO_FORMAT = VK_FORMAT_R8G8B8A8_UNORM;
+constexpr VkFormat NORMAL_FORMAT = VK_FORMAT_R16G16B16A16_SFLOAT;
+constexpr VkFormat ORM_FORMAT = VK_FORMAT_R8G8B8A8_UNORM;
+constexpr VkFormat LIT_FORMAT = VK_FORMAT_R16G16B16A16_SFLOAT;
+
+}  // namespace
+
+BurnhopeGBuffer::BurnhopeGBuffer(BurnhopeDevice &device, VkExtent2D extent)
+    : lveDevice{device}, extent{extent} {
+  createAttachments();
+  createRenderPass();
+  createFramebuffer();
+  createSampler();
+}
+
+BurnhopeGBuffer::~BurnhopeGBuffer() {
+  vkDestroySampler(lveDevice.device(), pointSampler, nullptr);
+  vkDestroyFramebuffer(lveDevice.device(), framebuffer, nullptr);
+  vkDestroyRenderPass(lveDevice.device(), renderPass, nullptr);
+}
+
+void BurnhopeGBuffer::resize(VkExtent2D newExtent) {
+  // the depth format is picked again, the same one the render pass was created with
+  vkDestroyFramebuffer(lveDevice.device(), framebuffer, nullptr);
+  framebuffer = VK_NULL_HANDLE;
+  extent = newExtent;
+  createAttachments();
+  createFramebuffer();
+}
+
+void BurnhopeGBuffer::createAttachments() {
+  VkExtent3D attachmentExtent{extent.width, extent.height, 1};
+  // the G-buffer only lives within the render pass
+  const VkImageUsageFlags geometryUsage =
+      VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT;
+  albedo = std::make_unique<BurnhopeTexture>(
+      lveDevice, ALBEDO_FORMAT, attachmentExtent, geometryUsage, VK_SAMPLE_COUNT_1_BIT);
+  normal = std::make_unique<BurnhopeTexture>(
+      lveDevice, NORMAL_FORMAT, attachmentExtent, geometryUsage, VK_SAMPLE_COUNT_1_BIT);
+  orm = std::make_unique<BurnhopeTexture>(
+      lveDevice, ORM_FORMAT, attachmentExtent, geometryUsage, VK_SAMPLE_COUNT_1_BIT);
+
+  VkFormat depthFormat = lveDevice.findSupportedFormat(
+      {VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT},
+      VK_IMAGE_TILING_OPTIMAL,
+      VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT);
+  depth = std::make_unique<BurnhopeTexture>(
+      lveDevice,
+      depthFormat,
+      attachmentExtent,
+      VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT |
+          VK_IMAGE_USAGE_SAMPLED_BIT,
+      VK_SAMPLE_COUNT_1_BIT);
+  litColor = std::make_unique<BurnhopeTexture>(
+      lveDevice,
+      LIT_FORMAT,
+      attachmentExtent,
+      VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+      VK_SAMPLE_COUNT_1_BIT);
+}
+
+void BurnhopeGBuffer::createRenderPass() {
+  std::array<VkAttachmentDescription, ATTACHMENT_COUNT> attachments{};
+  const std::array<VkFormat, ATTACHMENT_COUNT> formats{
+      ALBEDO_FORMAT,
+      NORMAL_FORMAT,
+      ORM_FORMAT,
+      depth->getFormat(),
+      LIT_FORMAT};
+  for (uint32_t i = 0; i < ATTACHMENT_COUNT; i++) {
+    attachments[i].format = formats[i];
+    attachments[i].samples = VK_SAMPLE_COUNT_1_BIT;
+    attachments[i].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    // the G-buffer is consumed by the lighting subpass and never needs to reach memory
+    attachments[i].storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    attachments[i].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    attachments[i].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    attachments[i].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    attachments[i].finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+  }
+  // depth and the lit color are sampled by the swapchain pass afterwards
+  attachments[DEPTH_ATTACHMENT].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+  attachments[DEPTH_ATTACHMENT].finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+  attachments[LIT_ATTACHMENT].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+  attachments[LIT_ATTACHMENT].finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+  const std::array<VkAttachmentReference, GEOMETRY_COLOR_ATTACHMENTS> geometryColorRefs{{
+      {ALBEDO_ATTACHMENT, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL},
+      {NORMAL_ATTACHMENT, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL},
+      {ORM_ATTACHMENT, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL},
+  }};
+  const VkAttachmentReference geometryDepthRef{
+      DEPTH_ATTACHMENT,
+      VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL};
+  const std::array<VkAttachmentReference, 4> lightingInputRefs{{
+      {ALBEDO_ATTACHMENT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL},
+      {NORMAL_ATTACHMENT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL},
+      {ORM_ATTACHMENT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL},
+      {DEPTH_ATTACHMENT, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL},
+  }};
+  const VkAttachmentReference lightingColorRef{
+      LIT_ATTACHMENT,
+      VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL};
+
+  std::array<VkSubpassDescription, 2> subpasses{};
+  subpasses[GEOMETRY_SUBPASS].pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+  subpasses[GEOMETRY_SUBPASS].colorAttachmentCount = GEOMETRY_COLOR_ATTACHMENTS;
+  subpasses[GEOMETRY_SUBPASS].pColorAttachments = geometryColorRefs.data();
+  subpasses[GEOMETRY_SUBPASS].pDepthStencilAttachment = &geometryDepthRef;
+  subpasses[LIGHTING_SUBPASS].pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+  subpasses[LIGHTING_SUBPASS].inputAttachmentCount =
+      static_cast<uint32_t>(lightingInputRefs.size());
+  subpasses[LIGHTING_SUBPASS].pInputAttachments = lightingInputRefs.data();
+  subpasses[LIGHTING_SUBPASS].colorAttachmentCount = 1;
+  subpasses[LIGHTING_SUBPASS].pColorAttachments = &lightingColorRef;
+
+  std::array<VkSubpassDependency, 3> dependencies{};
+  // the previous frame's swapchain pass is done sampling depth and the lit color
+  dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+  dependencies[0].dstSubpass = GEOMETRY_SUBPASS;
+  dependencies[0].srcStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+  dependencies[0].srcAccessMask = 0;
+  dependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT |
+                                 VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT |
+                                 VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+  dependencies[0].dstAccessMask =
+      VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+  // every pixel only reads its own G-buffer texel, so the dependency is by region
+  dependencies[1].srcSubpass = GEOMETRY_SUBPASS;
+  dependencies[1].dstSubpass = LIGHTING_SUBPASS;
+  dependencies[1].srcStageMask =
+      VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+  dependencies[1].srcAccessMask =
+      VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+  dependencies[1].dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+  dependencies[1].dstAccessMask = VK_ACCESS_INPUT_ATTACHMENT_READ_BIT;
+  dependencies[1].dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
+
+  dependencies[2].srcSubpass = LIGHTING_SUBPASS;
+  dependencies[2].dstSubpass = VK_SUBPASS_EXTERNAL;
+  dependencies[2].srcStageMask =
+      VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+  dependencies[2].srcAccessMask =
+      VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+  dependencies[2].dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+  dependencies[2].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+  VkRenderPassCreateInfo renderPassInfo{};
+  renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+  renderPassInfo.attachmentCount = ATTACHMENT_COUNT;
+  renderPassInfo.pAttachments = attachments.data();
+  renderPassInfo.subpassCount = static_cast<uint32_t>(subpasses.size());
+  renderPassInfo.pSubpasses = subpasses.data();
+  renderPassInfo.dependencyCount = static_cast<uint32_t>(dependencies.size());
+  renderPassInfo.pDependencies = dependencies.data();
+  if (vkCreateRenderPass(lveDevice.device(), &renderPassInfo, nullptr, &renderPass) !=
+      VK_SUCCESS) {
+    throw std::runtime_error("failed to create g-buffer render pass!");
+  }
+}
+
+void BurnhopeGBuffer::createFramebuffer() {
+  std::array<VkImageView, ATTACHMENT_COUNT> views{
+      albedo->getImageView(),
+      normal->getImageView(),
+      orm->getImageView(),
+      depth->getImageView(),
+      litColor->getImageView()};
+  VkFramebufferCreateInfo framebufferInfo{};
+  framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+  framebufferInfo.renderPass = renderPass;
+  framebufferInfo.attachmentCount = ATTACHMENT_COUNT;
+  framebufferInfo.pAttachments = views.data();
+  framebufferInfo.width = extent.width;
+  framebufferInfo.height = extent.height;
+  framebufferInfo.layers = 1;
+  if (vkCreateFramebuffer(lveDevice.device(), &framebufferInfo, nullptr, &framebuffer) !=
+      VK_SUCCESS) {
+    throw std::runtime_error("failed to create g-buffer framebuffer!");
+  }
+}
+
+void BurnhopeGBuffer::createSampler() {
+  // the swapchain pass reads one texel per pixel, and depth formats may not support filtering
+  VkSamplerCreateInfo samplerInfo{};
+  samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+  samplerInfo.magFilter = VK_FILTER_NEAREST;
+  samplerInfo.minFilter = VK_FILTER_NEAREST;
+  samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+  samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+  samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+  samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+  samplerInfo.maxAnisotropy = 1.f;
+  samplerInfo.minLod = 0.f;
+  samplerInfo.maxLod = 0.f;
+  samplerInfo.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_BLACK;
+  if (vkCreateSampler(lveDevice.device(), &samplerInfo, nullptr, &pointSampler) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create g-buffer sampler!");
+  }
+}
+
+std::array<VkDescriptorImageInfo, 4> BurnhopeGBuffer::getInputAttachmentInfos() const {
+  return {{
+      {VK_NULL_HANDLE, albedo->getImageView(), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL},
+      {VK_NULL_HANDLE, normal->getImageView(), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL},
+      {VK_NULL_HANDLE, orm->getImageView(), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL},
+      {VK_NULL_HANDLE, depth->getImageView(), VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL},
+  }};
+}
+
+VkDescriptorImageInfo BurnhopeGBuffer::getLitColorInfo() const {
+  return {pointSampler, litColor->getImageView(), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+}
+
+VkDescriptorImageInfo BurnhopeGBuffer::getDepthInfo() const {
+  return {pointSampler, depth->getImageView(), VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL};
+}
+
+void BurnhopeGBuffer::beginRenderPass(VkCommandBuffer commandBuffer, VkClearColorValue clearColor) {
+  std::array<VkClearValue, ATTACHMENT_COUNT> clearValues{};
+  clearValues[DEPTH_ATTACHMENT].depthStencil = {1.f, 0};
+  clearValues[LIT_ATTACHMENT].color = clearColor;
+
+  VkRenderPassBeginInfo renderPassInfo{};
+  renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+  renderPassInfo.renderPass = renderPass;
+  renderPassInfo.framebuffer = framebuffer;
+  renderPassInfo.renderArea.offset = {0, 0};
+  renderPassInfo.renderArea.extent = extent;
+  renderPassInfo.clearValueCount = ATTACHMENT_COUNT;
+  renderPassInfo.pClearValues = clearValues.data();
+  vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+
+  VkViewport viewport{};
+  viewport.x = 0.f;
+  viewport.y = 0.f;
+  viewport.width = static_cast<float>(extent.width);
+  viewport.height = static_cast<float>(extent.height);
+  viewport.minDepth = 0.f;
+  viewport.maxDepth = 1.f;
+  VkRect2D scissor{{0, 0}, extent};
+  vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+  vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+}
+
+void BurnhopeGBuffer::nextSubpass(VkCommandBuffer commandBuffer) {
+  vkCmdNextSubpass(commandBuffer, VK_SUBPASS_CONTENTS_INLINE);
+}
+
+void BurnhopeGBuffer::endRenderPass(VkCommandBuffer commandBuffer) {
+  vkCmdEndRenderPass(commandBuffer);
+}
+
+}  // namespace burnhope
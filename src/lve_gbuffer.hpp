@@ -0,0 +1,68 @@
+#pragma once
+
+#include "lve_device.hpp"
+#include "lve_texture.hpp"
+
+// std
+#include <array>
+#include <memory>
+
+namespace burnhope {
+
+// Thin G-buffer for deferred shading and the two subpass render pass that fills and consumes it.
+// Subpass 0 writes albedo, world normal and ORM (ao, roughness, metallic) with depth. Subpass 1
+// reads them back as input attachments, so on tiled GPUs they never leave tile memory, and
+// writes the lit color. The lit color and depth are stored for the swapchain pass to sample.
+class BurnhopeGBuffer {
+ public:
+  static constexpr uint32_t GEOMETRY_SUBPASS = 0;
+  static constexpr uint32_t LIGHTING_SUBPASS = 1;
+  // color attachments written by the geometry subpass, in location order
+  static constexpr uint32_t GEOMETRY_COLOR_ATTACHMENTS = 3;
+
+  BurnhopeGBuffer(BurnhopeDevice &device, VkExtent2D extent);
+  ~BurnhopeGBuffer();
+
+  BurnhopeGBuffer(const BurnhopeGBuffer &) = delete;
+  BurnhopeGBuffer &operator=(const BurnhopeGBuffer &) = delete;
+
+  // Recreates the attachments and framebuffer at the new extent. The render pass is kept, so
+  // pipelines created against it at any time stay valid. The G-buffer must not be in use.
+  void resize(VkExtent2D newExtent);
+
+  // lives as long as the G-buffer
+  VkRenderPass getRenderPass() const { return renderPass; }
+  VkExtent2D getExtent() const { return extent; }
+
+  // albedo, normal, orm and depth, as read by the lighting subpass
+  std::array<VkDescriptorImageInfo, 4> getInputAttachmentInfos() const;
+  // point sampled, in their layouts after the render pass
+  VkDescriptorImageInfo getLitColorInfo() const;
+  VkDescriptorImageInfo getDepthInfo() const;
+
+  // Begins the render pass in the geometry subpass, with the viewport and scissor covering the
+  // G-buffer. Draws are recorded inline.
+  void beginRenderPass(VkCommandBuffer commandBuffer, VkClearColorValue clearColor);
+  void nextSubpass(VkCommandBuffer commandBuffer);
+  void endRenderPass(VkCommandBuffer commandBuffer);
+
+ private:
+  void createAttachments();
+  void createRenderPass();
+  void createFramebuffer();
+  void createSampler();
+
+  BurnhopeDevice &lveDevice;
+  VkExtent2D extent;
+
+  std::unique_ptr<BurnhopeTexture> albedo;
+  std::unique_ptr<BurnhopeTexture> normal;
+  std::unique_ptr<BurnhopeTexture> orm;
+  std::unique_ptr<BurnhopeTexture> depth;
+  std::unique_ptr<BurnhopeTexture> litColor;
+  VkSampler pointSampler = VK_NULL_HANDLE;
+  VkRenderPass renderPass = VK_NULL_HANDLE;
+  VkFramebuffer framebuffer = VK_NULL_HANDLE;
+};
+
+}  // namespace burnhope
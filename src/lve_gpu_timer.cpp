@@ -0,0 +1,108 @@
+#include "lve_gpu_timer.hpp"
+
+// std
+#include <cassert>
+#include <stdexcept>
+
+namespace burnhope {
+
+BurnhopeGpuTimer::BurnhopeGpuTimer(BurnhopeDevice &device, uint32_t scopeCount)
+    : lveDevice{device},
+      scopeCount{scopeCount},
+      timestamps(scopeCount * 2),
+      totalMilliseconds(scopeCount),
+      sampleCounts(scopeCount) {
+  assert(scopeCount <= 64 && "BurnhopeGpuTimer tracks written scopes in a 64 bit mask");
+
+  // timestampComputeAndGraphics guarantees timestampValidBits > 0 on every graphics queue
+  supported = lveDevice.properties.limits.timestampComputeAndGraphics == VK_TRUE;
+  if (!supported) {
+    return;
+  }
+  nanosecondsPerTick = lveDevice.properties.limits.timestampPeriod;
+
+  VkQueryPoolCreateInfo poolInfo{};
+  poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+  poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+  poolInfo.queryCount = scopeCount * 2;
+  for (auto &queryPool : queryPools) {
+    if (vkCreateQueryPool(lveDevice.device(), &poolInfo, nullptr, &queryPool) != VK_SUCCESS) {
+      throw std::runtime_error("failed to create timestamp query pool!");
+    }
+  }
+}
+
+BurnhopeGpuTimer::~BurnhopeGpuTimer() {
+  for (VkQueryPool queryPool : queryPools) {
+    vkDestroyQueryPool(lveDevice.device(), queryPool, nullptr);
+  }
+}
+
+void BurnhopeGpuTimer::beginFrame(VkCommandBuffer commandBuffer, int frameIndex) {
+  if (!supported) {
+    return;
+  }
+  currentFrameIndex = frameIndex;
+  VkQueryPool queryPool = queryPools[frameIndex];
+
+  if (writtenScopes[frameIndex] != 0) {
+    // the frame's fence has signaled, so everything it wrote is available
+    vkGetQueryPoolResults(
+        lveDevice.device(),
+        queryPool,
+        0,
+        scopeCount * 2,
+        timestamps.size() * sizeof(uint64_t),
+        timestamps.data(),
+        sizeof(uint64_t),
+        VK_QUERY_RESULT_64_BIT);
+    for (uint32_t scope = 0; scope < scopeCount; scope++) {
+      if ((writtenScopes[frameIndex] & (1ull << scope)) == 0) continue;
+      uint64_t ticks = timestamps[scope * 2 + 1] - timestamps[scope * 2];
+      totalMilliseconds[scope] += ticks * nanosecondsPerTick / 1e6;
+      sampleCounts[scope]++;
+    }
+  }
+
+  vkCmdResetQueryPool(commandBuffer, queryPool, 0, scopeCount * 2);
+  writtenScopes[frameIndex] = 0;
+}
+
+void BurnhopeGpuTimer::beginScope(VkCommandBuffer commandBuffer, uint32_t scope) {
+  if (!supported) {
+    return;
+  }
+  assert(scope < scopeCount && "GPU timer scope out of range");
+  vkCmdWriteTimestamp(
+      commandBuffer,
+      VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+      queryPools[currentFrameIndex],
+      scope * 2);
+}
+
+void BurnhopeGpuTimer::endScope(VkCommandBuffer commandBuffer, uint32_t scope) {
+  if (!supported) {
+    return;
+  }
+  assert(scope < scopeCount && "GPU timer scope out of range");
+  vkCmdWriteTimestamp(
+      commandBuffer,
+      VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+      queryPools[currentFrameIndex],
+      scope * 2 + 1);
+  writtenScopes[currentFrameIndex] |= 1ull << scope;
+}
+
+std::vector<double> BurnhopeGpuTimer::takeAverages() {
+  std::vector<double> averages(scopeCount, 0.0);
+  for (uint32_t scope = 0; scope < scopeCount; scope++) {
+    if (sampleCounts[scope] > 0) {
+      averages[scope] = totalMilliseconds[scope] / sampleCounts[scope];
+    }
+    totalMilliseconds[scope] = 0.0;
+    sampleCounts[scope] = 0;
+  }
+  return averages;
+}
+
+}  // namespace burnhope
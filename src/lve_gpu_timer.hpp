@@ -0,0 +1,50 @@
+#pragma once
+
+#include "lve_device.hpp"
+#include "lve_swap_chain.hpp"
+
+// std
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace burnhope {
+
+// GPU time of up to scopeCount scopes per frame from timestamp queries, with one query pool per
+// frame in flight. Results are read back when the frame index comes around again, after its
+// fence has been waited on, so reading never stalls.
+class BurnhopeGpuTimer {
+ public:
+  BurnhopeGpuTimer(BurnhopeDevice &device, uint32_t scopeCount);
+  ~BurnhopeGpuTimer();
+
+  BurnhopeGpuTimer(const BurnhopeGpuTimer &) = delete;
+  BurnhopeGpuTimer &operator=(const BurnhopeGpuTimer &) = delete;
+
+  // false when the graphics queue can't write timestamps, every call is a no-op then
+  bool isSupported() const { return supported; }
+
+  // Collects the frame's previous results and resets its queries. Record outside a render pass,
+  // at the start of the frame's command buffer.
+  void beginFrame(VkCommandBuffer commandBuffer, int frameIndex);
+  void beginScope(VkCommandBuffer commandBuffer, uint32_t scope);
+  void endScope(VkCommandBuffer commandBuffer, uint32_t scope);
+
+  // average milliseconds per frame of every scope since the last call, 0 for unused scopes
+  std::vector<double> takeAverages();
+
+ private:
+  BurnhopeDevice &lveDevice;
+  uint32_t scopeCount;
+  bool supported = false;
+  double nanosecondsPerTick = 1.0;
+  std::array<VkQueryPool, BurnhopeSwapChain::MAX_FRAMES_IN_FLIGHT> queryPools{};
+  // scopes with both timestamps written in each frame's pool
+  std::array<uint64_t, BurnhopeSwapChain::MAX_FRAMES_IN_FLIGHT> writtenScopes{};
+  int currentFrameIndex = 0;
+  std::vector<uint64_t> timestamps;
+  std::vector<double> totalMilliseconds;
+  std::vector<uint32_t> sampleCounts;
+};
+
+}  // namespace burnhope
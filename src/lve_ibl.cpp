@@ -0,0 +1,548 @@
+#include "lve_ibl.hpp"
+
+// libs
+#include <glm/gtc/constants.hpp>
+#include <glm/gtc/packing.hpp>
+#include <stb_image.h>
+
+// std
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace burnhope {
+
+namespace {
+
+constexpr uint32_t SPECULAR_SAMPLES = 128;
+constexpr uint32_t BRDF_SAMPLES = 512;
+// SH projection runs over the first source level at most this wide
+constexpr uint32_t SH_SOURCE_WIDTH = 256;
+constexpr char CACHE_MAGIC[8] = {'B', 'H', 'I', 'B', 'L', 0, 0, 0};
+
+struct CacheHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t specularSize;
+  uint32_t specularMipLevels;
+  uint32_t brdfLutSize;
+  uint64_t sourceHash;
+};
+
+// Precomputed data as stored in the cache, the maps as half floats ready for upload:
+// RGBA for the specular cube map, mip by mip and face by face, RG for the BRDF LUT.
+struct IblData {
+  std::array<glm::vec4, 9> irradianceSH{};
+  std::vector<uint16_t> specular;
+  std::vector<uint16_t> brdfLut;
+};
+
+// equirectangular image, -y is up as in the scene. v = 0 is straight up.
+struct Equirect {
+  uint32_t width = 0;
+  uint32_t height = 0;
+  std::vector<glm::vec3> texels;
+
+  glm::vec3 texel(uint32_t x, uint32_t y) const { return texels[y * width + x]; }
+};
+
+// runs fn(i) for i in [0, count) on every hardware thread
+template <typename Fn>
+void parallelFor(uint32_t count, Fn &&fn) {
+  uint32_t threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+  std::atomic<uint32_t> next{0};
+  auto worker = [&]() {
+    for (uint32_t i = next++; i < count; i = next++) {
+      fn(i);
+    }
+  };
+  std::vector<std::thread> threads;
+  for (uint32_t t = 1; t < threadCount; t++) {
+    threads.emplace_back(worker);
+  }
+  worker();
+  for (auto &thread : threads) {
+    thread.join();
+  }
+}
+
+uint64_t fnv1a(const void *data, size_t size, uint64_t hash = 14695981039346656037ull) {
+  const auto *bytes = static_cast<const uint8_t *>(data);
+  for (size_t i = 0; i < size; i++) {
+    hash = (hash ^ bytes[i]) * 1099511628211ull;
+  }
+  return hash;
+}
+
+glm::vec2 equirectUv(glm::vec3 direction) {
+  float u = std::atan2(direction.z, direction.x) / glm::two_pi<float>() + .5f;
+  float v = std::acos(glm::clamp(-direction.y, -1.f, 1.f)) / glm::pi<float>();
+  return {u, v};
+}
+
+glm::vec3 equirectDirection(float u, float v) {
+  float phi = (u - .5f) * glm::two_pi<float>();
+  float theta = v * glm::pi<float>();
+  return {std::cos(phi) * std::sin(theta), -std::cos(theta), std::sin(phi) * std::sin(theta)};
+}
+
+// wraps horizontally, clamps vertically
+glm::vec3 sampleBilinear(const Equirect &image, glm::vec2 uv) {
+  float x = uv.x * image.width - .5f;
+  float y = glm::clamp(uv.y * image.height - .5f, 0.f, image.height - 1.f);
+  float x0 = std::floor(x);
+  float y0 = std::floor(y);
+  float fx = x - x0;
+  float fy = y - y0;
+  auto wrapX = [&image](float px) {
+    int ix = static_cast<int>(px) % static_cast<int>(image.width);
+    return static_cast<uint32_t>(ix < 0 ? ix + static_cast<int>(image.width) : ix);
+  };
+  uint32_t ix0 = wrapX(x0);
+  uint32_t ix1 = wrapX(x0 + 1.f);
+  uint32_t iy0 = static_cast<uint32_t>(y0);
+  uint32_t iy1 = std::min(iy0 + 1, image.height - 1);
+  glm::vec3 top = glm::mix(image.texel(ix0, iy0), image.texel(ix1, iy0), fx);
+  glm::vec3 bottom = glm::mix(image.texel(ix0, iy1), image.texel(ix1, iy1), fx);
+  return glm::mix(top, bottom, fy);
+}
+
+// trilinear lookup in a pyramid of 2x box filtered levels
+glm::vec3 sampleLod(const std::vector<Equirect> &levels, glm::vec3 direction, float lod) {
+  lod = glm::clamp(lod, 0.f, static_cast<float>(levels.size() - 1));
+  uint32_t level = static_cast<uint32_t>(lod);
+  glm::vec2 uv = equirectUv(direction);
+  glm::vec3 color = sampleBilinear(levels[level], uv);
+  if (level + 1 < levels.size()) {
+    color = glm::mix(color, sampleBilinear(levels[level + 1], uv), lod - level);
+  }
+  return color;
+}
+
+std::vector<Equirect> buildPyramid(Equirect source) {
+  std::vector<Equirect> levels;
+  levels.push_back(std::move(source));
+  while (levels.back().width > 8 && levels.back().height > 4) {
+    const Equirect &previous = levels.back();
+    Equirect next{};
+    next.width = previous.width / 2;
+    next.height = previous.height / 2;
+    next.texels.resize(next.width * next.height);
+    for (uint32_t y = 0; y < next.height; y++) {
+      for (uint32_t x = 0; x < next.width; x++) {
+        next.texels[y * next.width + x] =
+            .25f * (previous.texel(2 * x, 2 * y) + previous.texel(2 * x + 1, 2 * y) +
+                    previous.texel(2 * x, 2 * y + 1) + previous.texel(2 * x + 1, 2 * y + 1));
+      }
+    }
+    levels.push_back(std::move(next));
+  }
+  return levels;
+}
+
+// sky gradient over a darker ground, for scenes without an environment map
+Equirect proceduralSky() {
+  Equirect sky{};
+  sky.width = 512;
+  sky.height = 256;
+  sky.texels.resize(sky.width * sky.height);
+  const glm::vec3 zenith{.25f, .45f, .85f};
+  const glm::vec3 horizon{.8f, .85f, .9f};
+  const glm::vec3 ground{.3f, .27f, .24f};
+  for (uint32_t y = 0; y < sky.height; y++) {
+    float up = -equirectDirection(0.f, (y + .5f) / sky.height).y;
+    glm::vec3 color = up > 0.f ? glm::mix(horizon, zenith, std::pow(up, .5f))
+                               : glm::mix(horizon, ground, std::min(-up * 4.f, 1.f));
+    for (uint32_t x = 0; x < sky.width; x++) {
+      sky.texels[y * sky.width + x] = color;
+    }
+  }
+  return sky;
+}
+
+// Vulkan cube face order and orientation: +x, -x, +y, -y, +z, -z
+glm::vec3 cubeDirection(uint32_t face, uint32_t x, uint32_t y, uint32_t size) {
+  float s = 2.f * (x + .5f) / size - 1.f;
+  float t = 2.f * (y + .5f) / size - 1.f;
+  switch (face) {
+    case 0:
+      return glm::normalize(glm::vec3{1.f, -t, -s});
+    case 1:
+      return glm::normalize(glm::vec3{-1.f, -t, s});
+    case 2:
+      return glm::normalize(glm::vec3{s, 1.f, t});
+    case 3:
+      return glm::normalize(glm::vec3{s, -1.f, -t});
+    case 4:
+      return glm::normalize(glm::vec3{s, -t, 1.f});
+    default:
+      return glm::normalize(glm::vec3{-s, -t, -1.f});
+  }
+}
+
+glm::vec2 hammersley(uint32_t i, uint32_t count) {
+  uint32_t bits = i;
+  bits = (bits << 16u) | (bits >> 16u);
+  bits = ((bits & 0x55555555u) << 1u) | ((bits & 0xAAAAAAAAu) >> 1u);
+  bits = ((bits & 0x33333333u) << 2u) | ((bits & 0xCCCCCCCCu) >> 2u);
+  bits = ((bits & 0x0F0F0F0Fu) << 4u) | ((bits & 0xF0F0F0F0u) >> 4u);
+  bits = ((bits & 0x00FF00FFu) << 8u) | ((bits & 0xFF00FF00u) >> 8u);
+  return {static_cast<float>(i) / count, static_cast<float>(bits) * 2.3283064365386963e-10f};
+}
+
+// GGX distributed half vector around N
+glm::vec3 importanceSampleGGX(glm::vec2 xi, glm::vec3 N, float roughness) {
+  float a = roughness * roughness;
+  float phi = glm::two_pi<float>() * xi.x;
+  float cosTheta = std::sqrt((1.f - xi.y) / (1.f + (a * a - 1.f) * xi.y));
+  float sinTheta = std::sqrt(1.f - cosTheta * cosTheta);
+  glm::vec3 H{std::cos(phi) * sinTheta, std::sin(phi) * sinTheta, cosTheta};
+
+  glm::vec3 up = std::abs(N.z) < .999f ? glm::vec3{0.f, 0.f, 1.f} : glm::vec3{1.f, 0.f, 0.f};
+  glm::vec3 tangent = glm::normalize(glm::cross(up, N));
+  glm::vec3 bitangent = glm::cross(N, tangent);
+  return glm::normalize(tangent * H.x + bitangent * H.y + N * H.z);
+}
+
+float distributionGGX(float NdotH, float roughness) {
+  float a2 = roughness * roughness * roughness * roughness;
+  float denom = NdotH * NdotH * (a2 - 1.f) + 1.f;
+  return a2 / (glm::pi<float>() * denom * denom);
+}
+
+// real SH basis up to band 2, same order and constants as shIrradiance in simple_shader.frag
+std::array<float, 9> shBasis(glm::vec3 d) {
+  return {
+      .282095f,
+      .488603f * d.y,
+      .488603f * d.z,
+      .488603f * d.x,
+      1.092548f * d.x * d.y,
+      1.092548f * d.y * d.z,
+      .315392f * (3.f * d.z * d.z - 1.f),
+      1.092548f * d.x * d.z,
+      .546274f * (d.x * d.x - d.y * d.y)};
+}
+
+// projects the radiance onto SH9 and convolves it with the clamped cosine lobe, divided by pi
+std::array<glm::vec4, 9> projectIrradiance(const std::vector<Equirect> &levels) {
+  const Equirect *source = &levels.back();
+  for (const auto &level : levels) {
+    if (level.width <= SH_SOURCE_WIDTH) {
+      source = &level;
+      break;
+    }
+  }
+
+  // one partial sum per row, added up in order so results don't depend on the thread count
+  std::vector<std::array<glm::vec3, 9>> rowSums(source->height);
+  parallelFor(source->height, [&](uint32_t y) {
+    std::array<glm::vec3, 9> sum{};
+    float v = (y + .5f) / source->height;
+    float solidAngle = glm::two_pi<float>() / source->width * glm::pi<float>() / source->height *
+                       std::sin(v * glm::pi<float>());
+    for (uint32_t x = 0; x < source->width; x++) {
+      auto basis = shBasis(equirectDirection((x + .5f) / source->width, v));
+      glm::vec3 radiance = source->texel(x, y) * solidAngle;
+      for (uint32_t i = 0; i < 9; i++) {
+        sum[i] += radiance * basis[i];
+      }
+    }
+    rowSums[y] = sum;
+  });
+
+  // cosine lobe convolution per band, pi, 2pi/3 and pi/4, over pi
+  const float bandScale[9] = {1.f, 2.f / 3.f, 2.f / 3.f, 2.f / 3.f, .25f, .25f, .25f, .25f, .25f};
+  std::array<glm::vec4, 9> coefficients{};
+  for (const auto &rowSum : rowSums) {
+    for (uint32_t i = 0; i < 9; i++) {
+      coefficients[i] += glm::vec4{rowSum[i] * bandScale[i], 0.f};
+    }
+  }
+  return coefficients;
+}
+
+std::vector<uint16_t> prefilterSpecular(const std::vector<Equirect> &levels) {
+  std::vector<size_t> mipOffsets;
+  size_t texelCount = 0;
+  for (uint32_t mip = 0; mip < BurnhopeIbl::SPECULAR_MIP_LEVELS; mip++) {
+    mipOffsets.push_back(texelCount);
+    uint32_t size = std::max(BurnhopeIbl::SPECULAR_SIZE >> mip, 1u);
+    texelCount += 6 * size * size;
+  }
+  std::vector<uint16_t> texels(texelCount * 4);
+
+  const float sourceTexelSolidAngle =
+      4.f * glm::pi<float>() / (levels[0].width * levels[0].height);
+  // one job per mip, face and row
+  std::vector<glm::uvec3> jobs;
+  for (uint32_t mip = 0; mip < BurnhopeIbl::SPECULAR_MIP_LEVELS; mip++) {
+    uint32_t size = std::max(BurnhopeIbl::SPECULAR_SIZE >> mip, 1u);
+    for (uint32_t face = 0; face < 6; face++) {
+      for (uint32_t y = 0; y < size; y++) {
+        jobs.push_back({mip, face, y});
+      }
+    }
+  }
+  parallelFor(static_cast<uint32_t>(jobs.size()), [&](uint32_t jobIndex) {
+    const uint32_t mip = jobs[jobIndex].x;
+    const uint32_t face = jobs[jobIndex].y;
+    const uint32_t y = jobs[jobIndex].z;
+    const uint32_t size = std::max(BurnhopeIbl::SPECULAR_SIZE >> mip, 1u);
+    const float roughness = static_cast<float>(mip) / (BurnhopeIbl::SPECULAR_MIP_LEVELS - 1);
+    for (uint32_t x = 0; x < size; x++) {
+      // the split sum's N = V = R assumption
+      glm::vec3 N = cubeDirection(face, x, y, size);
+      glm::vec3 color{0.f};
+      if (mip == 0) {
+        // a mirror, only filtered down to the cube's own resolution
+        float cubeTexelSolidAngle = 4.f * glm::pi<float>() / (6.f * size * size);
+        color = sampleLod(levels, N, .5f * std::log2(cubeTexelSolidAngle / sourceTexelSolidAngle));
+      } else {
+        float totalWeight = 0.f;
+        for (uint32_t i = 0; i < SPECULAR_SAMPLES; i++) {
+          glm::vec3 H = importanceSampleGGX(hammersley(i, SPECULAR_SAMPLES), N, roughness);
+          float NdotH = glm::dot(N, H);
+          glm::vec3 L = 2.f * NdotH * H - N;
+          float NdotL = glm::dot(N, L);
+          if (NdotL <= 0.f) continue;
+          // filtered importance sampling, reading a source level as wide as the sample's
+          // share of the lobe keeps few samples from aliasing
+          float pdf = distributionGGX(NdotH, roughness) * .25f;
+          float sampleSolidAngle = 1.f / (SPECULAR_SAMPLES * pdf + 1e-4f);
+          float lod = .5f * std::log2(sampleSolidAngle / sourceTexelSolidAngle) + 1.f;
+          color += sampleLod(levels, L, lod) * NdotL;
+          totalWeight += NdotL;
+        }
+        color /= std::max(totalWeight, 1e-4f);
+      }
+      size_t texel = mipOffsets[mip] + (static_cast<size_t>(face) * size + y) * size + x;
+      texels[texel * 4 + 0] = glm::packHalf1x16(color.x);
+      texels[texel * 4 + 1] = glm::packHalf1x16(color.y);
+      texels[texel * 4 + 2] = glm::packHalf1x16(color.z);
+      texels[texel * 4 + 3] = glm::packHalf1x16(1.f);
+    }
+  });
+  return texels;
+}
+
+// scale and bias to F0 of the specular BRDF integrated over the hemisphere, by NdotV along u
+// and roughness along v
+std::vector<uint16_t> integrateBrdf() {
+  const uint32_t size = BurnhopeIbl::BRDF_LUT_SIZE;
+  std::vector<uint16_t> texels(size * size * 2);
+  parallelFor(size, [&](uint32_t y) {
+    float roughness = (y + .5f) / size;
+    // Schlick-GGX k for image based lighting
+    float k = roughness * roughness * .5f;
+    for (uint32_t x = 0; x < size; x++) {
+      float NdotV = (x + .5f) / size;
+      glm::vec3 V{std::sqrt(1.f - NdotV * NdotV), 0.f, NdotV};
+      const glm::vec3 N{0.f, 0.f, 1.f};
+      float scale = 0.f;
+      float bias = 0.f;
+      for (uint32_t i = 0; i < BRDF_SAMPLES; i++) {
+        glm::vec3 H = importanceSampleGGX(hammersley(i, BRDF_SAMPLES), N, roughness);
+        float VdotH = std::max(glm::dot(V, H), 0.f);
+        glm::vec3 L = 2.f * VdotH * H - V;
+        float NdotL = std::max(L.z, 0.f);
+        float NdotH = std::max(H.z, 0.f);
+        if (NdotL <= 0.f) continue;
+        float G = (NdotV / (NdotV * (1.f - k) + k)) * (NdotL / (NdotL * (1.f - k) + k));
+        float visibility = G * VdotH / (NdotH * NdotV);
+        float fresnel = std::pow(1.f - VdotH, 5.f);
+        scale += (1.f - fresnel) * visibility;
+        bias += fresnel * visibility;
+      }
+      texels[(y * size + x) * 2 + 0] = glm::packHalf1x16(scale / BRDF_SAMPLES);
+      texels[(y * size + x) * 2 + 1] = glm::packHalf1x16(bias / BRDF_SAMPLES);
+    }
+  });
+  return texels;
+}
+
+bool readCache(const std::string &path, uint64_t sourceHash, IblData &data) {
+  std::ifstream file{path, std::ios::binary};
+  if (!file) {
+    return false;
+  }
+  CacheHeader header{};
+  file.read(reinterpret_cast<char *>(&header), sizeof(header));
+  if (!file || std::memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0 ||
+      header.version != BurnhopeIbl::CACHE_VERSION ||
+      header.specularSize != BurnhopeIbl::SPECULAR_SIZE ||
+      header.specularMipLevels != BurnhopeIbl::SPECULAR_MIP_LEVELS ||
+      header.brdfLutSize != BurnhopeIbl::BRDF_LUT_SIZE || header.sourceHash != sourceHash) {
+    return false;
+  }
+  file.read(reinterpret_cast<char *>(data.irradianceSH.data()), sizeof(data.irradianceSH));
+  file.read(
+      reinterpret_cast<char *>(data.specular.data()),
+      data.specular.size() * sizeof(uint16_t));
+  file.read(
+      reinterpret_cast<char *>(data.brdfLut.data()),
+      data.brdfLut.size() * sizeof(uint16_t));
+  return static_cast<bool>(file);
+}
+
+void writeCache(const std::string &path, uint64_t sourceHash, const IblData &data) {
+  // written next to the target and renamed, so an interrupted write never leaves a bad cache
+  std::string tempPath = path + ".tmp";
+  {
+    std::ofstream file{tempPath, std::ios::binary | std::ios::trunc};
+    CacheHeader header{};
+    std::memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    header.version = BurnhopeIbl::CACHE_VERSION;
+    header.specularSize = BurnhopeIbl::SPECULAR_SIZE;
+    header.specularMipLevels = BurnhopeIbl::SPECULAR_MIP_LEVELS;
+    header.brdfLutSize = BurnhopeIbl::BRDF_LUT_SIZE;
+    header.sourceHash = sourceHash;
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(
+        reinterpret_cast<const char *>(data.irradianceSH.data()),
+        sizeof(data.irradianceSH));
+    file.write(
+        reinterpret_cast<const char *>(data.specular.data()),
+        data.specular.size() * sizeof(uint16_t));
+    file.write(
+        reinterpret_cast<const char *>(data.brdfLut.data()),
+        data.brdfLut.size() * sizeof(uint16_t));
+    if (!file) {
+      std::cout << "failed to write ibl cache " << tempPath << "\n";
+      return;
+    }
+  }
+  std::error_code error;
+  std::filesystem::rename(tempPath, path, error);
+  if (error) {
+    std::cout << "failed to write ibl cache " << path << ": " << error.message() << "\n";
+  }
+}
+
+}  // namespace
+
+BurnhopeIbl::BurnhopeIbl(
+    BurnhopeDevice &device,
+    const std::string &environmentPath,
+    const std::string &cacheDirectory)
+    : lveDevice{device} {
+  auto start = std::chrono::high_resolution_clock::now();
+
+  // the cache key covers the source bytes and every setting of the precompute
+  std::vector<char> sourceBytes;
+  if (!environmentPath.empty()) {
+    std::ifstream file{environmentPath, std::ios::binary};
+    if (file) {
+      sourceBytes.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    } else {
+      std::cout << "environment map " << environmentPath << " not found, using a procedural sky\n";
+    }
+  }
+  const uint32_t settings[] = {
+      CACHE_VERSION,
+      SPECULAR_SIZE,
+      SPECULAR_MIP_LEVELS,
+      SPECULAR_SAMPLES,
+      BRDF_LUT_SIZE,
+      BRDF_SAMPLES};
+  uint64_t sourceHash = fnv1a(sourceBytes.data(), sourceBytes.size());
+  sourceHash = fnv1a(settings, sizeof(settings), sourceHash);
+
+  std::ostringstream cacheName;
+  cacheName << "ibl_" << std::hex << std::setw(16) << std::setfill('0') << sourceHash << ".bin";
+  const std::string cachePath = (std::filesystem::path{cacheDirectory} / cacheName.str()).string();
+
+  size_t specularTexels = 0;
+  for (uint32_t mip = 0; mip < SPECULAR_MIP_LEVELS; mip++) {
+    uint32_t size = std::max(SPECULAR_SIZE >> mip, 1u);
+    specularTexels += 6 * size * size;
+  }
+  IblData data{};
+  data.specular.resize(specularTexels * 4);
+  data.brdfLut.resize(BRDF_LUT_SIZE * BRDF_LUT_SIZE * 2);
+
+  bool cached = readCache(cachePath, sourceHash, data);
+  if (!cached) {
+    Equirect source{};
+    if (!sourceBytes.empty()) {
+      int width, height, channels;
+      float *pixels = stbi_loadf_from_memory(
+          reinterpret_cast<const stbi_uc *>(sourceBytes.data()),
+          static_cast<int>(sourceBytes.size()),
+          &width,
+          &height,
+          &channels,
+          STBI_rgb);
+      if (!pixels) {
+        throw std::runtime_error("failed to load environment map " + environmentPath);
+      }
+      source.width = static_cast<uint32_t>(width);
+      source.height = static_cast<uint32_t>(height);
+      source.texels.reserve(source.width * source.height);
+      for (size_t i = 0; i < static_cast<size_t>(width) * height; i++) {
+        source.texels.emplace_back(pixels[i * 3], pixels[i * 3 + 1], pixels[i * 3 + 2]);
+      }
+      stbi_image_free(pixels);
+    } else {
+      source = proceduralSky();
+    }
+
+    std::vector<Equirect> levels = buildPyramid(std::move(source));
+    data.irradianceSH = projectIrradiance(levels);
+    data.specular = prefilterSpecular(levels);
+    data.brdfLut = integrateBrdf();
+
+    std::error_code error;
+    std::filesystem::create_directories(cacheDirectory, error);
+    writeCache(cachePath, sourceHash, data);
+  }
+
+  EnvironmentUbo ubo{};
+  for (uint32_t i = 0; i < 9; i++) {
+    ubo.irradianceSH[i] = data.irradianceSH[i];
+  }
+  ubo.params = {static_cast<float>(SPECULAR_MIP_LEVELS - 1), 0.f, 0.f, 0.f};
+  environmentBuffer = std::make_unique<BurnhopeBuffer>(
+      lveDevice,
+      sizeof(EnvironmentUbo),
+      1,
+      VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+      MemoryUsage::CpuToGpu);
+  environmentBuffer->map();
+  environmentBuffer->writeToBuffer(&ubo);
+  environmentBuffer->flushDirtyRanges();
+
+  specularMap = std::make_unique<BurnhopeTexture>(
+      lveDevice,
+      VK_FORMAT_R16G16B16A16_SFLOAT,
+      VkExtent3D{SPECULAR_SIZE, SPECULAR_SIZE, 1},
+      SPECULAR_MIP_LEVELS,
+      6,
+      4 * sizeof(uint16_t),
+      data.specular.data());
+  brdfLut = std::make_unique<BurnhopeTexture>(
+      lveDevice,
+      VK_FORMAT_R16G16_SFLOAT,
+      VkExtent3D{BRDF_LUT_SIZE, BRDF_LUT_SIZE, 1},
+      1,
+      1,
+      2 * sizeof(uint16_t),
+      data.brdfLut.data());
+
+  auto end = std::chrono::high_resolution_clock::now();
+  std::cout << "ibl " << (cached ? "loaded from " : "precomputed into ") << cachePath << " in "
+            << std::chrono::duration<double, std::milli>(end - start).count() << " ms\n";
+}
+
+}  // namespace burnhope
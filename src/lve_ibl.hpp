@@ -0,0 +1,62 @@
+#pragma once
+
+#include "lve_buffer.hpp"
+#include "lve_device.hpp"
+#include "lve_texture.hpp"
+
+// libs
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+// std
+#include <memory>
+#include <string>
+
+namespace burnhope {
+
+// Image based lighting from an equirectangular HDR environment. Three things are precomputed
+// on all CPU cores:
+// - diffuse irradiance as 9 spherical harmonics coefficients
+// - a GGX prefiltered specular cube map, with roughness 0 to 1 over its mip chain
+// - the split-sum BRDF lookup table
+// The results are cached on disk, keyed by a hash of the source image and the precompute
+// settings, so later launches only load them. Shading then costs one cube and one LUT fetch.
+class BurnhopeIbl {
+ public:
+  static constexpr uint32_t SPECULAR_SIZE = 128;
+  static constexpr uint32_t SPECULAR_MIP_LEVELS = 6;
+  static constexpr uint32_t BRDF_LUT_SIZE = 128;
+  // bump when the precompute changes, so stale caches are rebuilt
+  static constexpr uint32_t CACHE_VERSION = 1;
+
+  // matches Environment in simple_shader.frag
+  struct EnvironmentUbo {
+    glm::vec4 irradianceSH[9];  // irradiance / pi, rgb
+    glm::vec4 params;  // x is the specular map's last mip level
+  };
+
+  // An empty or missing environmentPath uses a procedural sky instead. Cache files are written to
+  // cacheDirectory, which is created if needed.
+  BurnhopeIbl(
+      BurnhopeDevice &device,
+      const std::string &environmentPath,
+      const std::string &cacheDirectory = "cache");
+
+  BurnhopeIbl(const BurnhopeIbl &) = delete;
+  BurnhopeIbl &operator=(const BurnhopeIbl &) = delete;
+
+  VkDescriptorBufferInfo getEnvironmentBufferInfo() const {
+    return environmentBuffer->descriptorInfo();
+  }
+  VkDescriptorImageInfo getSpecularInfo() const { return specularMap->getImageInfo(); }
+  VkDescriptorImageInfo getBrdfLutInfo() const { return brdfLut->getImageInfo(); }
+
+ private:
+  BurnhopeDevice &lveDevice;
+  std::unique_ptr<BurnhopeBuffer> environmentBuffer;
+  std::unique_ptr<BurnhopeTexture> specularMap;
+  std::unique_ptr<BurnhopeTexture> brdfLut;
+};
+
+}  // namespace burnhope
@@ -0,0 +1,177 @@
+#include "lve_memory_tracker.hpp"
+
+// std
+#include <cassert>
+#include <iomanip>
+#include <iostream>
+
+namespace burnhope {
+
+namespace {
+
+double toMiB(VkDeviceSize bytes) { return static_cast<double>(bytes) / (1024.0 * 1024.0); }
+
+}  // namespace
+
+const char *memoryCategoryName(MemoryCategory category) {
+  switch (category) {
+    case MemoryCategory::Vertex:
+      return "vertex";
+    case MemoryCategory::Index:
+      return "index";
+    case MemoryCategory::Texture:
+      return "texture";
+    case MemoryCategory::Uniform:
+      return "ubo";
+    case MemoryCategory::Storage:
+      return "ssbo";
+    case MemoryCategory::Staging:
+      return "staging";
+    case MemoryCategory::Attachment:
+      return "attachment";
+    default:
+      return "other";
+  }
+}
+
+BurnhopeMemoryTracker::BurnhopeMemoryTracker(
+    VkPhysicalDevice physicalDevice,
+    PFN_vkGetPhysicalDeviceMemoryProperties2KHR getMemoryProperties2)
+    : physicalDevice{physicalDevice}, getMemoryProperties2{getMemoryProperties2} {
+  vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+  trackedHeaps.resize(memoryProperties.memoryHeapCount);
+  for (uint32_t i = 0; i < memoryProperties.memoryHeapCount; i++) {
+    trackedHeaps[i].flags = memoryProperties.memoryHeaps[i].flags;
+    trackedHeaps[i].size = memoryProperties.memoryHeaps[i].size;
+  }
+}
+
+MemoryCategory BurnhopeMemoryTracker::categoryForBuffer(
+    VkBufferUsageFlags usage, VkMemoryPropertyFlags properties) {
+  if (usage & VK_BUFFER_USAGE_VERTEX_BUFFER_BIT) return MemoryCategory::Vertex;
+  if (usage & VK_BUFFER_USAGE_INDEX_BUFFER_BIT) return MemoryCategory::Index;
+  if (usage & VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT) return MemoryCategory::Uniform;
+  if (usage & VK_BUFFER_USAGE_STORAGE_BUFFER_BIT) return MemoryCategory::Storage;
+  if ((usage & (VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT)) &&
+      (properties & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)) {
+    return MemoryCategory::Staging;
+  }
+  return MemoryCategory::Other;
+}
+
+MemoryCategory BurnhopeMemoryTracker::categoryForImage(VkImageUsageFlags usage) {
+  if (usage & (VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT |
+               VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT)) {
+    return MemoryCategory::Attachment;
+  }
+  return MemoryCategory::Texture;
+}
+
+void BurnhopeMemoryTracker::recordAllocation(
+    VkDeviceMemory memory,
+    uint32_t memoryTypeIndex,
+    VkDeviceSize size,
+    MemoryCategory category) {
+  std::lock_guard<std::mutex> lock{mutex};
+  uint32_t heapIndex = heapIndexForType(memoryTypeIndex);
+  allocations[memory] = {memoryTypeIndex, heapIndex, size, category};
+
+  auto &heap = trackedHeaps[heapIndex];
+  heap.trackedBytes += size;
+  heap.allocationCount++;
+  heap.categoryBytes[static_cast<size_t>(category)] += size;
+}
+
+void BurnhopeMemoryTracker::recordFree(VkDeviceMemory memory) {
+  if (memory == VK_NULL_HANDLE) return;
+
+  std::lock_guard<std::mutex> lock{mutex};
+  auto it = allocations.find(memory);
+  assert(it != allocations.end() && "Freeing memory that was not allocated through the device");
+  if (it == allocations.end()) return;
+
+  auto &heap = trackedHeaps[it->second.heapIndex];
+  heap.trackedBytes -= it->second.size;
+  heap.allocationCount--;
+  heap.categoryBytes[static_cast<size_t>(it->second.category)] -= it->second.size;
+  allocations.erase(it);
+}
+
+VkMemoryPropertyFlags BurnhopeMemoryTracker::getPropertyFlags(VkDeviceMemory memory) const {
+  std::lock_guard<std::mutex> lock{mutex};
+  auto it = allocations.find(memory);
+  assert(it != allocations.end() && "Memory was not allocated through the device");
+  return memoryProperties.memoryTypes[it->second.memoryTypeIndex].propertyFlags;
+}
+
+std::vector<MemoryHeapStats> BurnhopeMemoryTracker::getHeapStats() const {
+  std::vector<MemoryHeapStats> stats;
+  {
+    std::lock_guard<std::mutex> lock{mutex};
+    stats = trackedHeaps;
+  }
+
+  if (hasMemoryBudget()) {
+    VkPhysicalDeviceMemoryBudgetPropertiesEXT budgetProperties{};
+    budgetProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+    VkPhysicalDeviceMemoryProperties2 properties2{};
+    properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+    properties2.pNext = &budgetProperties;
+    getMemoryProperties2(physicalDevice, &properties2);
+
+    for (uint32_t i = 0; i < stats.size(); i++) {
+      stats[i].budget = budgetProperties.heapBudget[i];
+      stats[i].usage = budgetProperties.heapUsage[i];
+    }
+  } else {
+    for (auto &heap : stats) {
+      heap.budget = heap.size;
+      heap.usage = heap.trackedBytes;
+    }
+  }
+  return stats;
+}
+
+VkDeviceSize BurnhopeMemoryTracker::getCategoryBytes(MemoryCategory category) const {
+  std::lock_guard<std::mutex> lock{mutex};
+  VkDeviceSize total = 0;
+  for (auto &heap : trackedHeaps) {
+    total += heap.categoryBytes[static_cast<size_t>(category)];
+  }
+  return total;
+}
+
+void BurnhopeMemoryTracker::logReport() const {
+  auto stats = getHeapStats();
+  std::cout << std::fixed << std::setprecision(1);
+  for (uint32_t i = 0; i < stats.size(); i++) {
+    auto &heap = stats[i];
+    std::cout << "memory heap " << i
+              << ((heap.flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) ? " (device)" : " (host)")
+              << ": " << toMiB(heap.usage) << " / " << toMiB(heap.budget) << " MiB"
+              << (hasMemoryBudget() ? "" : " (tracked)") << ", ours " << toMiB(heap.trackedBytes)
+              << " MiB in " << heap.allocationCount << " allocations [";
+    for (size_t c = 0; c < heap.categoryBytes.size(); c++) {
+      if (heap.categoryBytes[c] == 0) continue;
+      std::cout << " " << memoryCategoryName(static_cast<MemoryCategory>(c)) << "="
+                << toMiB(heap.categoryBytes[c]);
+    }
+    std::cout << " ]" << std::endl;
+
+    if (heap.usageRatio() >= BUDGET_WARNING_RATIO) {
+      std::cerr << "warning: memory heap " << i << " at " << heap.usageRatio() * 100.f
+                << "% of its budget" << std::endl;
+    }
+  }
+  std::cout << std::defaultfloat;
+}
+
+void BurnhopeMemoryTracker::tick(float frameTime) {
+  timeSinceLastLog += frameTime;
+  if (timeSinceLastLog >= LOG_INTERVAL_SECONDS) {
+    timeSinceLastLog = 0.f;
+    logReport();
+  }
+}
+
+}  // namespace burnhope
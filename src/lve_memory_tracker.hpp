@@ -0,0 +1,105 @@
+#pragma once
+
+// vulkan headers
+#include <vulkan/vulkan.h>
+
+// std lib headers
+#include <array>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace burnhope {
+
+enum class MemoryCategory : uint32_t {
+  Vertex = 0,
+  Index,
+  Texture,
+  Uniform,
+  Storage,
+  Staging,
+  Attachment,
+  Other,
+  Count
+};
+
+const char *memoryCategoryName(MemoryCategory category);
+
+struct MemoryHeapStats {
+  VkMemoryHeapFlags flags = 0;
+  VkDeviceSize size = 0;
+  // budget/usage come from VK_EXT_memory_budget when available, otherwise the budget is the heap
+  // size and usage is what this process has allocated through the tracker
+  VkDeviceSize budget = 0;
+  VkDeviceSize usage = 0;
+  VkDeviceSize trackedBytes = 0;
+  uint32_t allocationCount = 0;
+  std::array<VkDeviceSize, static_cast<size_t>(MemoryCategory::Count)> categoryBytes{};
+
+  float usageRatio() const {
+    return budget > 0 ? static_cast<float>(usage) / static_cast<float>(budget) : 0.f;
+  }
+};
+
+// Counts every VkDeviceMemory allocation made through BurnhopeDevice by heap and category.
+class BurnhopeMemoryTracker {
+ public:
+  // heaps above this fraction of their budget are reported as warnings
+  static constexpr float BUDGET_WARNING_RATIO = 0.9f;
+  static constexpr float LOG_INTERVAL_SECONDS = 10.f;
+
+  BurnhopeMemoryTracker(
+      VkPhysicalDevice physicalDevice,
+      PFN_vkGetPhysicalDeviceMemoryProperties2KHR getMemoryProperties2);
+
+  BurnhopeMemoryTracker(const BurnhopeMemoryTracker &) = delete;
+  BurnhopeMemoryTracker &operator=(const BurnhopeMemoryTracker &) = delete;
+
+  static MemoryCategory categoryForBuffer(
+      VkBufferUsageFlags usage, VkMemoryPropertyFlags properties);
+  static MemoryCategory categoryForImage(VkImageUsageFlags usage);
+
+  void recordAllocation(
+      VkDeviceMemory memory,
+      uint32_t memoryTypeIndex,
+      VkDeviceSize size,
+      MemoryCategory category);
+  void recordFree(VkDeviceMemory memory);
+
+  bool hasMemoryBudget() const { return getMemoryProperties2 != nullptr; }
+  uint32_t heapIndexForType(uint32_t memoryTypeIndex) const {
+    return memoryProperties.memoryTypes[memoryTypeIndex].heapIndex;
+  }
+
+  // property flags of the memory type the allocation actually landed in, which may be a superset
+  // of what was requested (e.g. HOST_COHERENT)
+  VkMemoryPropertyFlags getPropertyFlags(VkDeviceMemory memory) const;
+
+  std::vector<MemoryHeapStats> getHeapStats() const;
+  VkDeviceSize getCategoryBytes(MemoryCategory category) const;
+
+  // prints one line per heap plus a warning for every heap close to its budget
+  void logReport() const;
+  // call once per frame, logs a report every LOG_INTERVAL_SECONDS
+  void tick(float frameTime);
+
+ private:
+  struct Allocation {
+    uint32_t memoryTypeIndex;
+    uint32_t heapIndex;
+    VkDeviceSize size;
+    MemoryCategory category;
+  };
+
+  VkPhysicalDevice physicalDevice;
+  PFN_vkGetPhysicalDeviceMemoryProperties2KHR getMemoryProperties2;
+  VkPhysicalDeviceMemoryProperties memoryProperties{};
+
+  mutable std::mutex mutex;
+  std::unordered_map<VkDeviceMemory, Allocation> allocations;
+  std::vector<MemoryHeapStats> trackedHeaps;
+  float timeSinceLastLog = 0.f;
+};
+
+}  // namespace burnhope
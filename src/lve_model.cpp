@@ -11,6 +11,7 @@
 // std
 #include <cassert>
 #include <cstring>
+#include <limits>
 #include <unordered_map>
 
 #ifndef ENGINE_DIR
@@ -31,7 +32,9 @@ struct hash<burnhope::BurnhopeModel::Vertex> {
 namespace burnhope {
 
 BurnhopeModel::BurnhopeModel(BurnhopeDevice &device, const BurnhopeModel::Builder &builder) : lveDevice{device} {
+  computeBoundingSphere(builder.vertices);
   createVertexBuffers(builder.vertices);
+  createPositionBuffer(builder.vertices);
   createIndexBuffers(builder.indices);
 }
 
@@ -44,6 +47,23 @@ std::unique_ptr<BurnhopeModel> BurnhopeModel::createModelFromFile(
   return std::make_unique<BurnhopeModel>(device, builder);
 }
 
+void BurnhopeModel::computeBoundingSphere(const std::vector<Vertex> &vertices) {
+  // centered on the bounding box, not minimal but cheap and stable
+  glm::vec3 minPos{std::numeric_limits<float>::max()};
+  glm::vec3 maxPos{std::numeric_limits<float>::lowest()};
+  for (const auto &vertex : vertices) {
+    minPos = glm::min(minPos, vertex.position);
+    maxPos = glm::max(maxPos, vertex.position);
+  }
+  glm::vec3 center = (minPos + maxPos) * 0.5f;
+  float radiusSquared = 0.f;
+  for (const auto &vertex : vertices) {
+    glm::vec3 offset = vertex.position - center;
+    radiusSquared = glm::max(radiusSquared, glm::dot(offset, offset));
+  }
+  boundingSphere = glm::vec4(center, glm::sqrt(radiusSquared));
+}
+
 void BurnhopeModel::createVertexBuffers(const std::vector<Vertex> &vertices) {
   vertexCount = static_cast<uint32_t>(vertices.size());
   assert(vertexCount >= 3 && "Vertex count must be at least 3");
@@ -55,7 +75,7 @@ void BurnhopeModel::createVertexBuffers(const std::vector<Vertex> &vertices) {
       vertexSize,
       vertexCount,
       VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+      MemoryUsage::Staging,
   };
 
   stagingBuffer.map();
@@ -66,11 +86,42 @@ void BurnhopeModel::createVertexBuffers(const std::vector<Vertex> &vertices) {
       vertexSize,
       vertexCount,
       VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+      MemoryUsage::GpuOnly);
 
   lveDevice.copyBuffer(stagingBuffer.getBuffer(), vertexBuffer->getBuffer(), bufferSize);
 }
 
+void BurnhopeModel::createPositionBuffer(const std::vector<Vertex> &vertices) {
+  // 12 bytes per vertex instead of the full 68, depth-only passes fetch much less
+  std::vector<glm::vec3> positions;
+  positions.reserve(vertices.size());
+  for (const auto &vertex : vertices) {
+    positions.push_back(vertex.position);
+  }
+  VkDeviceSize bufferSize = sizeof(positions[0]) * vertexCount;
+  uint32_t positionSize = sizeof(positions[0]);
+
+  BurnhopeBuffer stagingBuffer{
+      lveDevice,
+      positionSize,
+      vertexCount,
+      VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+      MemoryUsage::Staging,
+  };
+
+  stagingBuffer.map();
+  stagingBuffer.writeToBuffer((void *)positions.data());
+
+  positionBuffer = std::make_unique<BurnhopeBuffer>(
+      lveDevice,
+      positionSize,
+      vertexCount,
+      VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+      MemoryUsage::GpuOnly);
+
+  lveDevice.copyBuffer(stagingBuffer.getBuffer(), positionBuffer->getBuffer(), bufferSize);
+}
+
 void BurnhopeModel::createIndexBuffers(const std::vector<uint32_t> &indices) {
   indexCount = static_cast<uint32_t>(indices.size());
   hasIndexBuffer = indexCount > 0;
@@ -87,7 +138,7 @@ void BurnhopeModel::createIndexBuffers(const std::vector<uint32_t> &indices) {
       indexSize,
       indexCount,
       VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+      MemoryUsage::Staging,
   };
 
   stagingBuffer.map();
@@ -98,16 +149,17 @@ void BurnhopeModel::createIndexBuffers(const std::vector<uint32_t> &indices) {
       indexSize,
       indexCount,
       VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+      MemoryUsage::GpuOnly);
 
   lveDevice.copyBuffer(stagingBuffer.getBuffer(), indexBuffer->getBuffer(), bufferSize);
 }
 
-void BurnhopeModel::draw(VkCommandBuffer commandBuffer) {
+void BurnhopeModel::draw(
+    VkCommandBuffer commandBuffer, uint32_t instanceCount, uint32_t firstInstance) {
   if (hasIndexBuffer) {
-    vkCmdDrawIndexed(commandBuffer, indexCount, 1, 0, 0, 0);
+    vkCmdDrawIndexed(commandBuffer, indexCount, instanceCount, 0, 0, firstInstance);
   } else {
-    vkCmdDraw(commandBuffer, vertexCount, 1, 0, 0);
+    vkCmdDraw(commandBuffer, vertexCount, instanceCount, 0, firstInstance);
   }
 }
 
@@ -121,6 +173,16 @@ void BurnhopeModel::bind(VkCommandBuffer commandBuffer) {
   }
 }
 
+void BurnhopeModel::bindPositions(VkCommandBuffer commandBuffer) {
+  VkBuffer buffers[] = {positionBuffer->getBuffer()};
+  VkDeviceSize offsets[] = {0};
+  vkCmdBindVertexBuffers(commandBuffer, 0, 1, buffers, offsets);
+
+  if (hasIndexBuffer) {
+    vkCmdBindIndexBuffer(commandBuffer, indexBuffer->getBuffer(), 0, VK_INDEX_TYPE_UINT32);
+  }
+}
+
 std::vector<VkVertexInputBindingDescription> BurnhopeModel::Vertex::getBindingDescriptions() {
   std::vector<VkVertexInputBindingDescription> bindingDescriptions(1);
   bindingDescriptions[0].binding = 0;
@@ -142,6 +204,20 @@ std::vector<VkVertexInputAttributeDescription> BurnhopeModel::Vertex::getAttribu
   return attributeDescriptions;
 }
 
+std::vector<VkVertexInputBindingDescription>
+BurnhopeModel::Vertex::getPositionBindingDescriptions() {
+  std::vector<VkVertexInputBindingDescription> bindingDescriptions(1);
+  bindingDescriptions[0].binding = 0;
+  bindingDescriptions[0].stride = sizeof(glm::vec3);
+  bindingDescriptions[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+  return bindingDescriptions;
+}
+
+std::vector<VkVertexInputAttributeDescription>
+BurnhopeModel::Vertex::getPositionAttributeDescriptions() {
+  return {{0, 0, VK_FORMAT_R32G32B32_SFLOAT, 0}};
+}
+
 void BurnhopeModel::Builder::loadModel(const std::string &filepath) {
   tinyobj::attrib_t attrib;
   std::vector<tinyobj::shape_t> shapes;
@@ -25,6 +25,9 @@ class BurnhopeModel {
 
     static std::vector<VkVertexInputBindingDescription> getBindingDescriptions();
     static std::vector<VkVertexInputAttributeDescription> getAttributeDescriptions();
+    // tightly packed positions only, the stream bound by bindPositions
+    static std::vector<VkVertexInputBindingDescription> getPositionBindingDescriptions();
+    static std::vector<VkVertexInputAttributeDescription> getPositionAttributeDescriptions();
 
     bool operator==(const Vertex &other) const {
       return position == other.position && color == other.color && normal == other.normal &&
@@ -49,19 +52,33 @@ class BurnhopeModel {
       BurnhopeDevice &device, const std::string &filepath);
 
   void bind(VkCommandBuffer commandBuffer);
-  void draw(VkCommandBuffer commandBuffer);
+  // binds the position-only stream and the index buffer, for depth-only passes
+  void bindPositions(VkCommandBuffer commandBuffer);
+  // firstInstance is visible to the vertex shader through gl_InstanceIndex
+  void draw(VkCommandBuffer commandBuffer, uint32_t instanceCount = 1, uint32_t firstInstance = 0);
+
+  bool hasIndices() const { return hasIndexBuffer; }
+  uint32_t getIndexCount() const { return indexCount; }
+
+  // model space bounding sphere, xyz is the center and w the radius
+  glm::vec4 getBoundingSphere() const { return boundingSphere; }
 
  private:
+  void computeBoundingSphere(const std::vector<Vertex> &vertices);
   void createVertexBuffers(const std::vector<Vertex> &vertices);
+  void createPositionBuffer(const std::vector<Vertex> &vertices);
   void createIndexBuffers(const std::vector<uint32_t> &indices);
 
   BurnhopeDevice &lveDevice;
 
   std::unique_ptr<BurnhopeBuffer> vertexBuffer;
   uint32_t vertexCount;
+  std::unique_ptr<BurnhopeBuffer> positionBuffer;
 
   bool hasIndexBuffer = false;
   std::unique_ptr<BurnhopeBuffer> indexBuffer;
   uint32_t indexCount;
+
+  glm::vec4 boundingSphere{0.f};
 };
 }  // namespace burnhope
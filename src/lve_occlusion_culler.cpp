@@ -0,0 +1,369 @@
+#include "lve_occlusion_culler.hpp"
+
+#include "lve_game_object.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define BURNHOPE_OCCLUSION_SSE
+#endif
+
+// std
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace burnhope {
+
+namespace {
+
+constexpr uint32_t FULL_TILE_MASK = 0xffffffffu;
+// vertices closer than this to the eye plane are not clipped, their triangles are skipped, which
+// only ever loses occlusion
+constexpr float MIN_CLIP_W = 1e-3f;
+
+// edge function a * x + b * y + c, positive inside the triangle
+struct Edge {
+  float a;
+  float b;
+  float c;
+};
+
+uint64_t microsSince(std::chrono::high_resolution_clock::time_point start) {
+  return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+                                   std::chrono::high_resolution_clock::now() - start)
+                                   .count());
+}
+
+glm::vec3 toScreen(const glm::vec4 &clip) {
+  glm::vec3 ndc = glm::vec3(clip) / clip.w;
+  return {
+      (ndc.x * .5f + .5f) * BurnhopeOcclusionCuller::WIDTH,
+      (ndc.y * .5f + .5f) * BurnhopeOcclusionCuller::HEIGHT,
+      ndc.z};
+}
+
+// bit (row * TILE_WIDTH + column) is set for every pixel center of the tile inside all edges
+uint32_t tileCoverage(uint32_t tileX, uint32_t tileY, const Edge (&edges)[3]) {
+  const float left = static_cast<float>(tileX * BurnhopeOcclusionCuller::TILE_WIDTH);
+  const float top = static_cast<float>(tileY * BurnhopeOcclusionCuller::TILE_HEIGHT);
+  uint32_t coverage = 0;
+#if defined(BURNHOPE_OCCLUSION_SSE)
+  // one row of eight pixels per iteration, as two halves of four
+  const __m128 zero = _mm_setzero_ps();
+  const __m128 xLow = _mm_add_ps(_mm_set1_ps(left), _mm_setr_ps(.5f, 1.5f, 2.5f, 3.5f));
+  const __m128 xHigh = _mm_add_ps(xLow, _mm_set1_ps(4.f));
+  for (uint32_t row = 0; row < BurnhopeOcclusionCuller::TILE_HEIGHT; row++) {
+    const float y = top + row + .5f;
+    __m128 insideLow = _mm_castsi128_ps(_mm_set1_epi32(-1));
+    __m128 insideHigh = insideLow;
+    for (const Edge &edge : edges) {
+      const __m128 a = _mm_set1_ps(edge.a);
+      const __m128 rowValue = _mm_set1_ps(edge.b * y + edge.c);
+      insideLow =
+          _mm_and_ps(insideLow, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(a, xLow), rowValue), zero));
+      insideHigh =
+          _mm_and_ps(insideHigh, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(a, xHigh), rowValue), zero));
+    }
+    const uint32_t rowBits = static_cast<uint32_t>(_mm_movemask_ps(insideLow)) |
+                             (static_cast<uint32_t>(_mm_movemask_ps(insideHigh)) << 4);
+    coverage |= rowBits << (row * BurnhopeOcclusionCuller::TILE_WIDTH);
+  }
+#else
+  for (uint32_t row = 0; row < BurnhopeOcclusionCuller::TILE_HEIGHT; row++) {
+    const float y = top + row + .5f;
+    for (uint32_t column = 0; column < BurnhopeOcclusionCuller::TILE_WIDTH; column++) {
+      const float x = left + column + .5f;
+      bool inside = true;
+      for (const Edge &edge : edges) {
+        inside = inside && edge.a * x + edge.b * y + edge.c >= 0.f;
+      }
+      if (inside) {
+        coverage |= 1u << (row * BurnhopeOcclusionCuller::TILE_WIDTH + column);
+      }
+    }
+  }
+#endif
+  return coverage;
+}
+
+}  // namespace
+
+std::shared_ptr<OccluderMesh> OccluderMesh::createBox(glm::vec3 min, glm::vec3 max) {
+  auto mesh = std::make_shared<OccluderMesh>();
+  for (uint32_t corner = 0; corner < 8; corner++) {
+    mesh->vertices.push_back(
+        {(corner & 1) ? max.x : min.x, (corner & 2) ? max.y : min.y, (corner & 4) ? max.z : min.z});
+  }
+  // two triangles per face, winding does not matter since both sides are rasterized
+  mesh->indices = {
+      0, 1, 3, 0, 3, 2,  // -z
+      4, 6, 7, 4, 7, 5,  // +z
+      0, 4, 5, 0, 5, 1,  // -y
+      2, 3, 7, 2, 7, 6,  // +y
+      0, 2, 6, 0, 6, 4,  // -x
+      1, 5, 7, 1, 7, 3,  // +x
+  };
+  return mesh;
+}
+
+BurnhopeOcclusionCuller::BurnhopeOcclusionCuller()
+    : tileDepth0(TILES_X * TILES_Y), tileDepth1(TILES_X * TILES_Y), tileMask(TILES_X * TILES_Y) {
+  worker = std::thread(&BurnhopeOcclusionCuller::workerLoop, this);
+}
+
+BurnhopeOcclusionCuller::~BurnhopeOcclusionCuller() {
+  {
+    std::lock_guard<std::mutex> lock{mutex};
+    stopping = true;
+  }
+  jobReady.notify_one();
+  worker.join();
+}
+
+void BurnhopeOcclusionCuller::begin(
+    const glm::mat4 &viewProjection,
+    const BurnhopeFrustumCuller::Planes &frustumPlanes,
+    const BoundingSphereArray &bounds,
+    const BurnhopeComponentStore &components,
+    const std::vector<uint32_t> &owners) {
+  {
+    std::unique_lock<std::mutex> lock{mutex};
+    jobFinished.wait(lock, [this] { return jobDone; });
+  }
+
+  this->viewProjection = viewProjection;
+  this->frustumPlanes = frustumPlanes;
+  this->bounds = &bounds;
+  occluders.clear();
+  isOccluder.assign(bounds.size(), 0);
+  for (size_t i = 0; i < owners.size(); i++) {
+    if (const auto *occluder = components.occluders.tryGet(owners[i])) {
+      occluders.push_back({occluder->get(), components.transforms.get(owners[i]).mat4()});
+      isOccluder[i] = 1;
+    }
+  }
+
+  {
+    std::lock_guard<std::mutex> lock{mutex};
+    jobPending = true;
+    jobDone = false;
+  }
+  jobReady.notify_one();
+}
+
+const std::vector<uint32_t> &BurnhopeOcclusionCuller::waitForVisible() {
+  auto start = std::chrono::high_resolution_clock::now();
+  {
+    std::unique_lock<std::mutex> lock{mutex};
+    jobFinished.wait(lock, [this] { return jobDone; });
+  }
+  stats.waitMicros += microsSince(start);
+  return visible;
+}
+
+BurnhopeOcclusionCuller::Stats BurnhopeOcclusionCuller::takeStats() {
+  std::unique_lock<std::mutex> lock{mutex};
+  jobFinished.wait(lock, [this] { return jobDone; });
+  Stats taken = stats;
+  stats = {};
+  return taken;
+}
+
+void BurnhopeOcclusionCuller::workerLoop() {
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock{mutex};
+      jobReady.wait(lock, [this] { return jobPending || stopping; });
+      if (stopping) {
+        return;
+      }
+      jobPending = false;
+    }
+    runJob();
+    {
+      std::lock_guard<std::mutex> lock{mutex};
+      jobDone = true;
+    }
+    jobFinished.notify_all();
+  }
+}
+
+void BurnhopeOcclusionCuller::runJob() {
+  auto start = std::chrono::high_resolution_clock::now();
+  clearDepth();
+  for (const Occluder &occluder : occluders) {
+    rasterizeOccluder(occluder);
+  }
+  stats.rasterMicros += microsSince(start);
+
+  start = std::chrono::high_resolution_clock::now();
+  frustumVisible.clear();
+  BurnhopeFrustumCuller::cull(*bounds, frustumPlanes, frustumVisible);
+  visible.clear();
+  for (uint32_t index : frustumVisible) {
+    // occluders would mostly hide themselves, they are always drawn when in view
+    if (isOccluder[index]) {
+      visible.push_back(index);
+      continue;
+    }
+    stats.tested++;
+    glm::vec4 sphere{
+        bounds->centerX[index],
+        bounds->centerY[index],
+        bounds->centerZ[index],
+        bounds->radius[index]};
+    if (isOccluded(sphere)) {
+      stats.occluded++;
+    } else {
+      visible.push_back(index);
+    }
+  }
+  stats.testMicros += microsSince(start);
+  stats.jobs++;
+}
+
+void BurnhopeOcclusionCuller::clearDepth() {
+  std::fill(tileDepth0.begin(), tileDepth0.end(), 1.f);
+  std::fill(tileDepth1.begin(), tileDepth1.end(), 0.f);
+  std::fill(tileMask.begin(), tileMask.end(), 0u);
+}
+
+void BurnhopeOcclusionCuller::rasterizeOccluder(const Occluder &occluder) {
+  const glm::mat4 modelViewProjection = viewProjection * occluder.modelMatrix;
+  clipVertices.clear();
+  for (const glm::vec3 &vertex : occluder.mesh->vertices) {
+    clipVertices.push_back(modelViewProjection * glm::vec4(vertex, 1.f));
+  }
+
+  const auto &indices = occluder.mesh->indices;
+  for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+    const glm::vec4 &c0 = clipVertices[indices[i]];
+    const glm::vec4 &c1 = clipVertices[indices[i + 1]];
+    const glm::vec4 &c2 = clipVertices[indices[i + 2]];
+    if (c0.w < MIN_CLIP_W || c1.w < MIN_CLIP_W || c2.w < MIN_CLIP_W) {
+      continue;
+    }
+    rasterizeTriangle(toScreen(c0), toScreen(c1), toScreen(c2));
+    stats.occluderTriangles++;
+  }
+}
+
+void BurnhopeOcclusionCuller::rasterizeTriangle(
+    const glm::vec3 &v0, const glm::vec3 &v1, const glm::vec3 &v2) {
+  const glm::vec3 d1 = v1 - v0;
+  const glm::vec3 d2 = v2 - v0;
+  const float area = d1.x * d2.y - d1.y * d2.x;
+  if (std::abs(area) < 1e-6f) {
+    return;
+  }
+
+  const float minX = std::min({v0.x, v1.x, v2.x});
+  const float maxX = std::max({v0.x, v1.x, v2.x});
+  const float minY = std::min({v0.y, v1.y, v2.y});
+  const float maxY = std::max({v0.y, v1.y, v2.y});
+  if (maxX < 0.f || maxY < 0.f || minX >= WIDTH || minY >= HEIGHT) {
+    return;
+  }
+  const float minDepth = std::min({v0.z, v1.z, v2.z});
+  const float maxDepth = std::max({v0.z, v1.z, v2.z});
+
+  // edges flipped for clockwise triangles so the inside is always positive
+  const float sign = area > 0.f ? 1.f : -1.f;
+  const glm::vec3 *corners[3] = {&v0, &v1, &v2};
+  Edge edges[3];
+  for (int e = 0; e < 3; e++) {
+    const glm::vec3 &from = *corners[e];
+    const glm::vec3 &to = *corners[(e + 1) % 3];
+    edges[e].a = -(to.y - from.y) * sign;
+    edges[e].b = (to.x - from.x) * sign;
+    edges[e].c = -(edges[e].a * from.x + edges[e].b * from.y);
+  }
+
+  // depth is affine in screen space: z = v0.z + dzdx * (x - v0.x) + dzdy * (y - v0.y)
+  const float dzdx = (d1.z * d2.y - d2.z * d1.y) / area;
+  const float dzdy = (d2.z * d1.x - d1.z * d2.x) / area;
+
+  const uint32_t tileX0 = static_cast<uint32_t>(std::max(minX, 0.f)) / TILE_WIDTH;
+  const uint32_t tileY0 = static_cast<uint32_t>(std::max(minY, 0.f)) / TILE_HEIGHT;
+  const uint32_t tileX1 = static_cast<uint32_t>(std::min(maxX, WIDTH - 1.f)) / TILE_WIDTH;
+  const uint32_t tileY1 = static_cast<uint32_t>(std::min(maxY, HEIGHT - 1.f)) / TILE_HEIGHT;
+  for (uint32_t tileY = tileY0; tileY <= tileY1; tileY++) {
+    for (uint32_t tileX = tileX0; tileX <= tileX1; tileX++) {
+      const uint32_t tile = tileY * TILES_X + tileX;
+      if (minDepth >= tileDepth0[tile]) {
+        continue;
+      }
+      const uint32_t coverage = tileCoverage(tileX, tileY, edges);
+      if (coverage == 0) {
+        continue;
+      }
+
+      // farthest point of the depth plane over the tile, the plane is linear so it is at a corner
+      const float left = static_cast<float>(tileX * TILE_WIDTH) - v0.x;
+      const float top = static_cast<float>(tileY * TILE_HEIGHT) - v0.y;
+      const float depthX = std::max(dzdx * left, dzdx * (left + TILE_WIDTH));
+      const float depthY = std::max(dzdy * top, dzdy * (top + TILE_HEIGHT));
+      const float tileMaxDepth = std::clamp(v0.z + depthX + depthY, minDepth, maxDepth);
+      updateTile(tile, coverage, tileMaxDepth);
+    }
+  }
+}
+
+void BurnhopeOcclusionCuller::updateTile(uint32_t tile, uint32_t coverage, float triangleDepth) {
+  // every pixel of the reference layer is at most tileDepth0 deep. Covered pixels merge into the
+  // working layer, and once it covers the whole tile its farthest depth becomes the new
+  // reference.
+  const uint32_t mask = tileMask[tile] | coverage;
+  const float depth1 = std::max(tileDepth1[tile], triangleDepth);
+  if (mask == FULL_TILE_MASK) {
+    tileDepth0[tile] = std::min(tileDepth0[tile], depth1);
+    tileDepth1[tile] = 0.f;
+    tileMask[tile] = 0;
+  } else {
+    tileDepth1[tile] = depth1;
+    tileMask[tile] = mask;
+  }
+}
+
+bool BurnhopeOcclusionCuller::isOccluded(const glm::vec4 &sphere) const {
+  float minX = static_cast<float>(WIDTH);
+  float maxX = 0.f;
+  float minY = static_cast<float>(HEIGHT);
+  float maxY = 0.f;
+  float minDepth = 1.f;
+  for (uint32_t corner = 0; corner < 8; corner++) {
+    glm::vec4 world{
+        sphere.x + ((corner & 1) ? sphere.w : -sphere.w),
+        sphere.y + ((corner & 2) ? sphere.w : -sphere.w),
+        sphere.z + ((corner & 4) ? sphere.w : -sphere.w),
+        1.f};
+    glm::vec4 clip = viewProjection * world;
+    if (clip.w < MIN_CLIP_W) {
+      return false;  // the box crosses the eye plane
+    }
+    glm::vec3 screen = toScreen(clip);
+    minX = std::min(minX, screen.x);
+    maxX = std::max(maxX, screen.x);
+    minY = std::min(minY, screen.y);
+    maxY = std::max(maxY, screen.y);
+    minDepth = std::min(minDepth, screen.z);
+  }
+  if (maxX < 0.f || maxY < 0.f || minX >= WIDTH || minY >= HEIGHT) {
+    return false;
+  }
+
+  const uint32_t tileX0 = static_cast<uint32_t>(std::max(minX, 0.f)) / TILE_WIDTH;
+  const uint32_t tileY0 = static_cast<uint32_t>(std::max(minY, 0.f)) / TILE_HEIGHT;
+  const uint32_t tileX1 = static_cast<uint32_t>(std::min(maxX, WIDTH - 1.f)) / TILE_WIDTH;
+  const uint32_t tileY1 = static_cast<uint32_t>(std::min(maxY, HEIGHT - 1.f)) / TILE_HEIGHT;
+  for (uint32_t tileY = tileY0; tileY <= tileY1; tileY++) {
+    for (uint32_t tileX = tileX0; tileX <= tileX1; tileX++) {
+      if (minDepth <= tileDepth0[tileY * TILES_X + tileX]) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+}  // namespace burnhope
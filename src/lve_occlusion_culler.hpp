@@ -0,0 +1,129 @@
+#pragma once
+
+#include "lve_frustum_culler.hpp"
+
+// libs
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+// std
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace burnhope {
+
+struct BurnhopeComponentStore;
+
+// Simplified closed mesh that hides whatever is behind it, in the owning object's model space.
+// It should fit inside the rendered model so culling stays conservative.
+struct OccluderMesh {
+  std::vector<glm::vec3> vertices;
+  std::vector<uint32_t> indices;  // triangle list
+
+  static std::shared_ptr<OccluderMesh> createBox(glm::vec3 min, glm::vec3 max);
+};
+
+// CPU occlusion culling on a worker thread. Occluder meshes are rasterized into a low resolution
+// depth buffer made of 8x4 pixel tiles, each with a coverage mask and two depth layers in the
+// style of masked software occlusion culling, and the boxes around the bounding spheres that
+// pass frustum culling are tested against it.
+class BurnhopeOcclusionCuller {
+ public:
+  static constexpr uint32_t WIDTH = 256;
+  static constexpr uint32_t HEIGHT = 128;
+  static constexpr uint32_t TILE_WIDTH = 8;
+  static constexpr uint32_t TILE_HEIGHT = 4;
+  static constexpr uint32_t TILES_X = WIDTH / TILE_WIDTH;
+  static constexpr uint32_t TILES_Y = HEIGHT / TILE_HEIGHT;
+
+  struct Stats {
+    uint32_t jobs = 0;
+    uint32_t occluderTriangles = 0;
+    uint32_t tested = 0;  // objects inside the frustum that are not occluders themselves
+    uint32_t occluded = 0;
+    uint64_t rasterMicros = 0;  // worker thread
+    uint64_t testMicros = 0;    // worker thread, frustum and occlusion tests
+    uint64_t waitMicros = 0;    // time the render thread spent blocked on results
+
+    float hitRate() const { return tested == 0 ? 0.f : static_cast<float>(occluded) / tested; }
+
+    Stats &operator+=(const Stats &other) {
+      jobs += other.jobs;
+      occluderTriangles += other.occluderTriangles;
+      tested += other.tested;
+      occluded += other.occluded;
+      rasterMicros += other.rasterMicros;
+      testMicros += other.testMicros;
+      waitMicros += other.waitMicros;
+      return *this;
+    }
+  };
+
+  BurnhopeOcclusionCuller();
+  ~BurnhopeOcclusionCuller();
+
+  BurnhopeOcclusionCuller(const BurnhopeOcclusionCuller &) = delete;
+  BurnhopeOcclusionCuller &operator=(const BurnhopeOcclusionCuller &) = delete;
+
+  // Starts culling bounds on the worker thread. The occluders are taken from the owners with an
+  // occluder mesh. bounds and the owners' meshes must not change until waitForVisible returns.
+  void begin(
+      const glm::mat4 &viewProjection,
+      const BurnhopeFrustumCuller::Planes &frustumPlanes,
+      const BoundingSphereArray &bounds,
+      const BurnhopeComponentStore &components,
+      const std::vector<uint32_t> &owners);
+  // Blocks until the job started by begin is done and returns the indices into its bounds that
+  // are inside the frustum and not occluded.
+  const std::vector<uint32_t> &waitForVisible();
+
+  // returns the counters accumulated since the last call and resets them
+  Stats takeStats();
+
+ private:
+  struct Occluder {
+    const OccluderMesh *mesh;
+    glm::mat4 modelMatrix;
+  };
+
+  void workerLoop();
+  void runJob();
+  void clearDepth();
+  void rasterizeOccluder(const Occluder &occluder);
+  void rasterizeTriangle(const glm::vec3 &v0, const glm::vec3 &v1, const glm::vec3 &v2);
+  void updateTile(uint32_t tile, uint32_t coverage, float triangleDepth);
+  bool isOccluded(const glm::vec4 &sphere) const;
+
+  // job, written by begin while the worker is idle
+  glm::mat4 viewProjection{1.f};
+  BurnhopeFrustumCuller::Planes frustumPlanes{};
+  const BoundingSphereArray *bounds = nullptr;
+  std::vector<Occluder> occluders;
+  std::vector<uint8_t> isOccluder;
+
+  // results and scratch, owned by the worker while a job runs
+  std::vector<uint32_t> frustumVisible;
+  std::vector<uint32_t> visible;
+  std::vector<glm::vec4> clipVertices;
+  // per tile: farthest depth of the fully covered reference layer, the working layer's farthest
+  // depth and which of its 32 pixels the working layer covers
+  std::vector<float> tileDepth0;
+  std::vector<float> tileDepth1;
+  std::vector<uint32_t> tileMask;
+  Stats stats{};
+
+  std::thread worker;
+  std::mutex mutex;
+  std::condition_variable jobReady;
+  std::condition_variable jobFinished;
+  bool jobPending = false;
+  bool jobDone = true;
+  bool stopping = false;
+};
+
+}  // namespace burnhope
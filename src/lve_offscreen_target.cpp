@@ -0,0 +1,326 @@
+#include "lve_offscreen_target.hpp"
+
+#include "lve_buffer.hpp"
+
+// std
+#include <array>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+
+namespace burnhope {
+
+namespace {
+
+uint32_t crc32(const unsigned char *data, size_t length, uint32_t crc = 0) {
+  static const std::array<uint32_t, 256> table = [] {
+    std::array<uint32_t, 256> t{};
+    for (uint32_t n = 0; n < 256; n++) {
+      uint32_t c = n;
+      for (int k = 0; k < 8; k++) {
+        c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+      }
+      t[n] = c;
+    }
+    return t;
+  }();
+
+  crc = ~crc;
+  for (size_t i = 0; i < length; i++) {
+    crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+  }
+  return ~crc;
+}
+
+void appendBigEndian(std::vector<unsigned char> &out, uint32_t value) {
+  out.push_back(static_cast<unsigned char>(value >> 24));
+  out.push_back(static_cast<unsigned char>(value >> 16));
+  out.push_back(static_cast<unsigned char>(value >> 8));
+  out.push_back(static_cast<unsigned char>(value));
+}
+
+void appendChunk(
+    std::vector<unsigned char> &out, const char type[4], const std::vector<unsigned char> &data) {
+  appendBigEndian(out, static_cast<uint32_t>(data.size()));
+  size_t crcStart = out.size();
+  out.insert(out.end(), type, type + 4);
+  out.insert(out.end(), data.begin(), data.end());
+  appendBigEndian(out, crc32(out.data() + crcStart, out.size() - crcStart));
+}
+
+// Writes an uncompressed (stored deflate blocks) RGBA png. Output size is not a concern for
+// regression captures and this keeps us free of an image writing dependency.
+void writePng(
+    const std::string &filepath, uint32_t width, uint32_t height, const unsigned char *rgba) {
+  std::vector<unsigned char> raw;
+  raw.reserve((width * 4 + 1) * height);
+  for (uint32_t y = 0; y < height; y++) {
+    raw.push_back(0);  // filter type: none
+    const unsigned char *row = rgba + static_cast<size_t>(y) * width * 4;
+    raw.insert(raw.end(), row, row + width * 4);
+  }
+
+  std::vector<unsigned char> zlib{0x78, 0x01};
+  constexpr size_t maxBlockSize = 65535;
+  for (size_t offset = 0; offset < raw.size() || offset == 0; offset += maxBlockSize) {
+    size_t blockSize = std::min(maxBlockSize, raw.size() - offset);
+    bool lastBlock = offset + blockSize >= raw.size();
+    zlib.push_back(lastBlock ? 1 : 0);
+    zlib.push_back(static_cast<unsigned char>(blockSize & 0xff));
+    zlib.push_back(static_cast<unsigned char>(blockSize >> 8));
+    zlib.push_back(static_cast<unsigned char>(~blockSize & 0xff));
+    zlib.push_back(static_cast<unsigned char>((~blockSize >> 8) & 0xff));
+    zlib.insert(zlib.end(), raw.begin() + offset, raw.begin() + offset + blockSize);
+    if (lastBlock) break;
+  }
+  uint32_t a = 1, b = 0;
+  for (unsigned char c : raw) {
+    a = (a + c) % 65521;
+    b = (b + a) % 65521;
+  }
+  appendBigEndian(zlib, (b << 16) | a);
+
+  std::vector<unsigned char> header;
+  appendBigEndian(header, width);
+  appendBigEndian(header, height);
+  header.insert(header.end(), {8, 6, 0, 0, 0});  // 8 bit depth, RGBA, default compression
+
+  std::vector<unsigned char> png{0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+  appendChunk(png, "IHDR", header);
+  appendChunk(png, "IDAT", zlib);
+  appendChunk(png, "IEND", {});
+
+  std::ofstream file{filepath, std::ios::binary | std::ios::trunc};
+  if (!file.is_open()) {
+    throw std::runtime_error("failed to open file: " + filepath);
+  }
+  file.write(reinterpret_cast<const char *>(png.data()), png.size());
+}
+
+}  // namespace
+
+BurnhopeOffscreenTarget::BurnhopeOffscreenTarget(BurnhopeDevice &deviceRef, VkExtent2D extent)
+    : device{deviceRef}, extent{extent} {
+  createTargets();
+  createRenderPass();
+  createFramebuffer();
+  createSyncObjects();
+}
+
+BurnhopeOffscreenTarget::~BurnhopeOffscreenTarget() {
+  vkDestroyFramebuffer(device.device(), framebuffer, nullptr);
+  vkDestroyRenderPass(device.device(), renderPass, nullptr);
+
+  for (size_t i = 0; i < inFlightFences.size(); i++) {
+    vkDestroyFence(device.device(), inFlightFences[i], nullptr);
+  }
+}
+
+void BurnhopeOffscreenTarget::createTargets() {
+  colorTarget = std::make_unique<BurnhopeTexture>(
+      device,
+      COLOR_FORMAT,
+      VkExtent3D{extent.width, extent.height, 1},
+      VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+      VK_SAMPLE_COUNT_1_BIT);
+  depthTarget = std::make_unique<BurnhopeTexture>(
+      device,
+      findDepthFormat(),
+      VkExtent3D{extent.width, extent.height, 1},
+      VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
+      VK_SAMPLE_COUNT_1_BIT);
+}
+
+void BurnhopeOffscreenTarget::createRenderPass() {
+  VkAttachmentDescription depthAttachment{};
+  depthAttachment.format = depthTarget->getFormat();
+  depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+  depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+  depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+  depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+  depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+  depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+  VkAttachmentReference depthAttachmentRef{};
+  depthAttachmentRef.attachment = 1;
+  depthAttachmentRef.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+  // the color target is left in TRANSFER_SRC so it can be read back without another transition
+  VkAttachmentDescription colorAttachment = {};
+  colorAttachment.format = COLOR_FORMAT;
+  colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+  colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+  colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+  colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+  colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+  colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  colorAttachment.finalLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+
+  VkAttachmentReference colorAttachmentRef = {};
+  colorAttachmentRef.attachment = 0;
+  colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+  VkSubpassDescription subpass = {};
+  subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+  subpass.colorAttachmentCount = 1;
+  subpass.pColorAttachments = &colorAttachmentRef;
+  subpass.pDepthStencilAttachment = &depthAttachmentRef;
+
+  std::array<VkSubpassDependency, 2> dependencies{};
+  dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+  dependencies[0].dstSubpass = 0;
+  // both frames in flight render into this target, so the previous frame's attachment writes
+  // and its readback must finish before this frame clears and writes again
+  dependencies[0].srcStageMask =
+      VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT |
+      VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT;
+  dependencies[0].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
+                                  VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT |
+                                  VK_ACCESS_TRANSFER_READ_BIT;
+  dependencies[0].dstStageMask =
+      VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+  dependencies[0].dstAccessMask =
+      VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+  dependencies[1].srcSubpass = 0;
+  dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+  dependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+  dependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+  dependencies[1].dstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+  dependencies[1].dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+  std::array<VkAttachmentDescription, 2> attachments = {colorAttachment, depthAttachment};
+  VkRenderPassCreateInfo renderPassInfo = {};
+  renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+  renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+  renderPassInfo.pAttachments = attachments.data();
+  renderPassInfo.subpassCount = 1;
+  renderPassInfo.pSubpasses = &subpass;
+  renderPassInfo.dependencyCount = static_cast<uint32_t>(dependencies.size());
+  renderPassInfo.pDependencies = dependencies.data();
+
+  if (vkCreateRenderPass(device.device(), &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create offscreen render pass!");
+  }
+}
+
+void BurnhopeOffscreenTarget::createFramebuffer() {
+  std::array<VkImageView, 2> attachments = {
+      colorTarget->getImageView(),
+      depthTarget->getImageView()};
+
+  VkFramebufferCreateInfo framebufferInfo = {};
+  framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+  framebufferInfo.renderPass = renderPass;
+  framebufferInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+  framebufferInfo.pAttachments = attachments.data();
+  framebufferInfo.width = extent.width;
+  framebufferInfo.height = extent.height;
+  framebufferInfo.layers = 1;
+
+  if (vkCreateFramebuffer(device.device(), &framebufferInfo, nullptr, &framebuffer) !=
+      VK_SUCCESS) {
+    throw std::runtime_error("failed to create offscreen framebuffer!");
+  }
+}
+
+void BurnhopeOffscreenTarget::createSyncObjects() {
+  inFlightFences.resize(BurnhopeSwapChain::MAX_FRAMES_IN_FLIGHT);
+
+  VkFenceCreateInfo fenceInfo = {};
+  fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+  fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+
+  for (size_t i = 0; i < inFlightFences.size(); i++) {
+    if (vkCreateFence(device.device(), &fenceInfo, nullptr, &inFlightFences[i]) != VK_SUCCESS) {
+      throw std::runtime_error("failed to create synchronization objects for a frame!");
+    }
+  }
+}
+
+VkResult BurnhopeOffscreenTarget::acquireNextImage(uint32_t *imageIndex) {
+  vkWaitForFences(
+      device.device(),
+      1,
+      &inFlightFences[currentFrame],
+      VK_TRUE,
+      std::numeric_limits<uint64_t>::max());
+  *imageIndex = 0;
+  return VK_SUCCESS;
+}
+
+VkResult BurnhopeOffscreenTarget::submitCommandBuffers(
+    const VkCommandBuffer *buffers, uint32_t *imageIndex) {
+  VkSubmitInfo submitInfo = {};
+  submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+  submitInfo.commandBufferCount = 1;
+  submitInfo.pCommandBuffers = buffers;
+
+  vkResetFences(device.device(), 1, &inFlightFences[currentFrame]);
+  VkResult result =
+      vkQueueSubmit(device.graphicsQueue(), 1, &submitInfo, inFlightFences[currentFrame]);
+
+  currentFrame = (currentFrame + 1) % inFlightFences.size();
+  return result;
+}
+
+void BurnhopeOffscreenTarget::saveToPng(const std::string &filepath) {
+  vkWaitForFences(
+      device.device(),
+      static_cast<uint32_t>(inFlightFences.size()),
+      inFlightFences.data(),
+      VK_TRUE,
+      std::numeric_limits<uint64_t>::max());
+
+  BurnhopeBuffer readbackBuffer{
+      device,
+      4,
+      extent.width * extent.height,
+      VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+      MemoryUsage::GpuToCpu,
+  };
+  readbackBuffer.map();
+
+  VkCommandBuffer commandBuffer = device.beginSingleTimeCommands();
+  VkBufferImageCopy region{};
+  region.bufferOffset = 0;
+  region.bufferRowLength = 0;
+  region.bufferImageHeight = 0;
+  region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+  region.imageSubresource.mipLevel = 0;
+  region.imageSubresource.baseArrayLayer = 0;
+  region.imageSubresource.layerCount = 1;
+  region.imageOffset = {0, 0, 0};
+  region.imageExtent = {extent.width, extent.height, 1};
+  vkCmdCopyImageToBuffer(
+      commandBuffer,
+      colorTarget->getImage(),
+      VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+      readbackBuffer.getBuffer(),
+      1,
+      &region);
+  device.endSingleTimeCommands(commandBuffer);
+  // readback memory prefers HOST_CACHED, which is not necessarily coherent
+  if (!readbackBuffer.isHostCoherent()) {
+    readbackBuffer.invalidate();
+  }
+
+  writePng(
+      filepath,
+      extent.width,
+      extent.height,
+      static_cast<const unsigned char *>(readbackBuffer.getMappedMemory()));
+  std::cout << "offscreen target written to " << filepath << std::endl;
+}
+
+VkFormat BurnhopeOffscreenTarget::findDepthFormat() {
+  return device.findSupportedFormat(
+      {VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT},
+      VK_IMAGE_TILING_OPTIMAL,
+      VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT);
+}
+
+}  // namespace burnhope
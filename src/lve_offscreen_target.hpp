@@ -0,0 +1,63 @@
+#pragma once
+
+#include "lve_device.hpp"
+#include "lve_swap_chain.hpp"
+#include "lve_texture.hpp"
+
+// vulkan headers
+#include <vulkan/vulkan.h>
+
+// std lib headers
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace burnhope {
+
+// Stand-in for BurnhopeSwapChain when running without a window: renders into a single color and
+// depth BurnhopeTexture pair and can read the color target back to a PNG file.
+class BurnhopeOffscreenTarget {
+ public:
+  static constexpr VkFormat COLOR_FORMAT = VK_FORMAT_R8G8B8A8_SRGB;
+
+  BurnhopeOffscreenTarget(BurnhopeDevice &deviceRef, VkExtent2D extent);
+  ~BurnhopeOffscreenTarget();
+
+  BurnhopeOffscreenTarget(const BurnhopeOffscreenTarget &) = delete;
+  BurnhopeOffscreenTarget &operator=(const BurnhopeOffscreenTarget &) = delete;
+
+  VkFramebuffer getFrameBuffer(int index) { return framebuffer; }
+  VkRenderPass getRenderPass() { return renderPass; }
+  VkExtent2D getExtent() { return extent; }
+  BurnhopeTexture &getColorTarget() { return *colorTarget; }
+
+  float extentAspectRatio() {
+    return static_cast<float>(extent.width) / static_cast<float>(extent.height);
+  }
+  VkFormat findDepthFormat();
+
+  VkResult acquireNextImage(uint32_t *imageIndex);
+  VkResult submitCommandBuffers(const VkCommandBuffer *buffers, uint32_t *imageIndex);
+
+  // waits for all submitted frames and writes the color target as an 8-bit RGBA png
+  void saveToPng(const std::string &filepath);
+
+ private:
+  void createTargets();
+  void createRenderPass();
+  void createFramebuffer();
+  void createSyncObjects();
+
+  BurnhopeDevice &device;
+  VkExtent2D extent;
+
+  std::unique_ptr<BurnhopeTexture> colorTarget;
+  std::unique_ptr<BurnhopeTexture> depthTarget;
+  VkRenderPass renderPass;
+  VkFramebuffer framebuffer;
+
+  std::vector<VkFence> inFlightFences;
+  size_t currentFrame = 0;
+};
+
+}  // namespace burnhope
@@ -4,9 +4,11 @@
 
 // std
 #include <cassert>
+#include <chrono>
 #include <fstream>
 #include <iostream>
 #include <stdexcept>
+#include <utility>
 
 #ifndef ENGINE_DIR
 #define ENGINE_DIR "../"
@@ -59,10 +61,12 @@ void BurnhopePipeline::createGraphicsPipeline(
       "Cannot create graphics pipeline: no renderPass provided in configInfo");
 
   auto vertCode = readFile(vertFilepath);
-  auto fragCode = readFile(fragFilepath);
-
   createShaderModule(vertCode, &vertShaderModule);
-  createShaderModule(fragCode, &fragShaderModule);
+  const bool hasFragmentStage = !fragFilepath.empty();
+  if (hasFragmentStage) {
+    auto fragCode = readFile(fragFilepath);
+    createShaderModule(fragCode, &fragShaderModule);
+  }
 
   VkPipelineShaderStageCreateInfo shaderStages[2];
   shaderStages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
@@ -71,14 +75,16 @@ void BurnhopePipeline::createGraphicsPipeline(
   shaderStages[0].pName = "main";
   shaderStages[0].flags = 0;
   shaderStages[0].pNext = nullptr;
-  shaderStages[0].pSpecializationInfo = nullptr;
+  const VkSpecializationInfo* specializationInfo =
+      configInfo.specializationInfo.mapEntryCount > 0 ? &configInfo.specializationInfo : nullptr;
+  shaderStages[0].pSpecializationInfo = specializationInfo;
   shaderStages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
   shaderStages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
   shaderStages[1].module = fragShaderModule;
   shaderStages[1].pName = "main";
   shaderStages[1].flags = 0;
   shaderStages[1].pNext = nullptr;
-  shaderStages[1].pSpecializationInfo = nullptr;
+  shaderStages[1].pSpecializationInfo = specializationInfo;
 
   auto& bindingDescriptions = configInfo.bindingDescriptions;
   auto& attributeDescriptions = configInfo.attributeDescriptions;
@@ -92,7 +98,7 @@ void BurnhopePipeline::createGraphicsPipeline(
 
   VkGraphicsPipelineCreateInfo pipelineInfo{};
   pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-  pipelineInfo.stageCount = 2;
+  pipelineInfo.stageCount = hasFragmentStage ? 2 : 1;
   pipelineInfo.pStages = shaderStages;
   pipelineInfo.pVertexInputState = &vertexInputInfo;
   pipelineInfo.pInputAssemblyState = &configInfo.inputAssemblyInfo;
@@ -110,15 +116,23 @@ void BurnhopePipeline::createGraphicsPipeline(
   pipelineInfo.basePipelineIndex = -1;
   pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
 
+  auto startTime = std::chrono::high_resolution_clock::now();
   if (vkCreateGraphicsPipelines(
           lveDevice.device(),
-          VK_NULL_HANDLE,
+          lveDevice.pipelineCache(),
           1,
           &pipelineInfo,
           nullptr,
           &graphicsPipeline) != VK_SUCCESS) {
     throw std::runtime_error("failed to create graphics pipeline");
   }
+  float creationTime = std::chrono::duration<float, std::chrono::milliseconds::period>(
+                           std::chrono::high_resolution_clock::now() - startTime)
+                           .count();
+  std::cout << "pipeline " << vertFilepath << " + "
+            << (hasFragmentStage ? fragFilepath : "no fragment stage") << ": " << creationTime
+            << " ms (" << (lveDevice.isPipelineCacheWarm() ? "warm" : "cold") << " cache)"
+            << std::endl;
 }
 
 void BurnhopePipeline::createShaderModule(const std::vector<char>& code, VkShaderModule* shaderModule) {
@@ -136,6 +150,92 @@ void BurnhopePipeline::bind(VkCommandBuffer commandBuffer) {
   vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
 }
 
+BurnhopePipelineVariants::BurnhopePipelineVariants(
+    BurnhopeDevice& device,
+    const std::string& vertFilepath,
+    const std::string& fragFilepath,
+    ConfigureFn configure,
+    SpecializeFn specialize)
+    : lveDevice{device},
+      vertFilepath{vertFilepath},
+      fragFilepath{fragFilepath},
+      configure{std::move(configure)},
+      specialize{std::move(specialize)} {}
+
+BurnhopePipeline* BurnhopePipelineVariants::get(uint32_t variantMask) {
+  auto it = variants.find(variantMask);
+  if (it != variants.end()) {
+    return it->second.get();
+  }
+
+  std::vector<uint32_t> constants = specialize(variantMask);
+  std::vector<VkSpecializationMapEntry> mapEntries(constants.size());
+  for (uint32_t i = 0; i < mapEntries.size(); i++) {
+    mapEntries[i].constantID = i;
+    mapEntries[i].offset = i * sizeof(uint32_t);
+    mapEntries[i].size = sizeof(uint32_t);
+  }
+
+  PipelineConfigInfo configInfo{};
+  configure(variantMask, configInfo);
+  configInfo.specializationInfo.mapEntryCount = static_cast<uint32_t>(mapEntries.size());
+  configInfo.specializationInfo.pMapEntries = mapEntries.data();
+  configInfo.specializationInfo.dataSize = constants.size() * sizeof(uint32_t);
+  configInfo.specializationInfo.pData = constants.data();
+
+  std::cout << "pipeline variant " << variantMask << ":" << std::endl;
+  auto pipeline =
+      std::make_unique<BurnhopePipeline>(lveDevice, vertFilepath, fragFilepath, configInfo);
+  return variants.emplace(variantMask, std::move(pipeline)).first->second.get();
+}
+
+BurnhopeComputePipeline::BurnhopeComputePipeline(
+    BurnhopeDevice& device, const std::string& compFilepath, VkPipelineLayout pipelineLayout)
+    : lveDevice{device} {
+  assert(
+      pipelineLayout != VK_NULL_HANDLE &&
+      "Cannot create compute pipeline: no pipelineLayout provided");
+
+  auto compCode = BurnhopePipeline::readFile(compFilepath);
+  VkShaderModuleCreateInfo moduleInfo{};
+  moduleInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+  moduleInfo.codeSize = compCode.size();
+  moduleInfo.pCode = reinterpret_cast<const uint32_t*>(compCode.data());
+  if (vkCreateShaderModule(lveDevice.device(), &moduleInfo, nullptr, &compShaderModule) !=
+      VK_SUCCESS) {
+    throw std::runtime_error("failed to create shader module");
+  }
+
+  VkComputePipelineCreateInfo pipelineInfo{};
+  pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+  pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+  pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+  pipelineInfo.stage.module = compShaderModule;
+  pipelineInfo.stage.pName = "main";
+  pipelineInfo.layout = pipelineLayout;
+  pipelineInfo.basePipelineIndex = -1;
+  pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+
+  if (vkCreateComputePipelines(
+          lveDevice.device(),
+          lveDevice.pipelineCache(),
+          1,
+          &pipelineInfo,
+          nullptr,
+          &computePipeline) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create compute pipeline");
+  }
+}
+
+BurnhopeComputePipeline::~BurnhopeComputePipeline() {
+  vkDestroyShaderModule(lveDevice.device(), compShaderModule, nullptr);
+  vkDestroyPipeline(lveDevice.device(), computePipeline, nullptr);
+}
+
+void BurnhopeComputePipeline::bind(VkCommandBuffer commandBuffer) {
+  vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, computePipeline);
+}
+
 void BurnhopePipeline::defaultPipelineConfigInfo(PipelineConfigInfo& configInfo) {
   configInfo.inputAssemblyInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
   configInfo.inputAssemblyInfo.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
@@ -223,4 +323,22 @@ void BurnhopePipeline::enableAlphaBlending(PipelineConfigInfo& configInfo) {
   configInfo.colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
 }
 
+void BurnhopePipeline::enableDepthOnly(PipelineConfigInfo& configInfo) {
+  configInfo.colorBlendAttachment.blendEnable = VK_FALSE;
+  configInfo.colorBlendAttachment.colorWriteMask = 0;
+  configInfo.bindingDescriptions = BurnhopeModel::Vertex::getPositionBindingDescriptions();
+  configInfo.attributeDescriptions = BurnhopeModel::Vertex::getPositionAttributeDescriptions();
+}
+
+void BurnhopePipeline::enableDepthEqual(PipelineConfigInfo& configInfo) {
+  configInfo.depthStencilInfo.depthWriteEnable = VK_FALSE;
+  configInfo.depthStencilInfo.depthCompareOp = VK_COMPARE_OP_EQUAL;
+}
+
+void BurnhopePipeline::enableColorAttachments(PipelineConfigInfo& configInfo, uint32_t count) {
+  configInfo.colorBlendAttachments.assign(count, configInfo.colorBlendAttachment);
+  configInfo.colorBlendInfo.attachmentCount = count;
+  configInfo.colorBlendInfo.pAttachments = configInfo.colorBlendAttachments.data();
+}
+
 }  // namespace burnhope
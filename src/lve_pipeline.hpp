@@ -3,7 +3,10 @@
 #include "lve_device.hpp"
 
 // std
+#include <functional>
+#include <memory>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 namespace burnhope {
@@ -20,6 +23,8 @@ struct PipelineConfigInfo {
   VkPipelineRasterizationStateCreateInfo rasterizationInfo;
   VkPipelineMultisampleStateCreateInfo multisampleInfo;
   VkPipelineColorBlendAttachmentState colorBlendAttachment;
+  // one state per color attachment when a subpass writes more than one
+  std::vector<VkPipelineColorBlendAttachmentState> colorBlendAttachments{};
   VkPipelineColorBlendStateCreateInfo colorBlendInfo;
   VkPipelineDepthStencilStateCreateInfo depthStencilInfo;
   std::vector<VkDynamicState> dynamicStateEnables;
@@ -27,10 +32,14 @@ struct PipelineConfigInfo {
   VkPipelineLayout pipelineLayout = nullptr;
   VkRenderPass renderPass = nullptr;
   uint32_t subpass = 0;
+  // applied to every stage, constant ids a stage doesn't declare are ignored. Its pointers only
+  // need to stay valid until the pipeline is created.
+  VkSpecializationInfo specializationInfo{};
 };
 
 class BurnhopePipeline {
  public:
+  // an empty fragFilepath creates a pipeline without a fragment stage, e.g. for depth-only passes
   BurnhopePipeline(
       BurnhopeDevice& device,
       const std::string& vertFilepath,
@@ -45,10 +54,17 @@ class BurnhopePipeline {
 
   static void defaultPipelineConfigInfo(PipelineConfigInfo& configInfo);
   static void enableAlphaBlending(PipelineConfigInfo& configInfo);
+  // position-only vertex stream and no color writes, for depth pre-passes
+  static void enableDepthOnly(PipelineConfigInfo& configInfo);
+  // only shades fragments whose depth matches what a depth pre-pass already wrote
+  static void enableDepthEqual(PipelineConfigInfo& configInfo);
+  // Writes count color attachments with the current colorBlendAttachment state, e.g. for
+  // G-buffer subpasses. Call after any other change to colorBlendAttachment.
+  static void enableColorAttachments(PipelineConfigInfo& configInfo, uint32_t count);
 
- private:
   static std::vector<char> readFile(const std::string& filepath);
 
+ private:
   void createGraphicsPipeline(
       const std::string& vertFilepath,
       const std::string& fragFilepath,
@@ -59,6 +75,56 @@ class BurnhopePipeline {
   BurnhopeDevice& lveDevice;
   VkPipeline graphicsPipeline;
   VkShaderModule vertShaderModule;
-  VkShaderModule fragShaderModule;
+  VkShaderModule fragShaderModule = VK_NULL_HANDLE;
+};
+
+// Pipelines built from one shader pair that differ in their specialization constants and
+// optionally their fixed function state, so each variant's shaders get compiled with dead
+// branches and texture fetches removed. A variant is created the first time its mask is asked
+// for and kept until the cache is destroyed.
+class BurnhopePipelineVariants {
+ public:
+  // fills the pipeline config of a variant, specializationInfo is set by the cache
+  using ConfigureFn = std::function<void(uint32_t variantMask, PipelineConfigInfo &configInfo)>;
+  // values of the 32-bit specialization constants 0, 1, 2... of a variant
+  using SpecializeFn = std::function<std::vector<uint32_t>(uint32_t variantMask)>;
+
+  BurnhopePipelineVariants(
+      BurnhopeDevice &device,
+      const std::string &vertFilepath,
+      const std::string &fragFilepath,
+      ConfigureFn configure,
+      SpecializeFn specialize);
+
+  BurnhopePipelineVariants(const BurnhopePipelineVariants &) = delete;
+  BurnhopePipelineVariants &operator=(const BurnhopePipelineVariants &) = delete;
+
+  BurnhopePipeline *get(uint32_t variantMask);
+  size_t size() const { return variants.size(); }
+
+ private:
+  BurnhopeDevice &lveDevice;
+  std::string vertFilepath;
+  std::string fragFilepath;
+  ConfigureFn configure;
+  SpecializeFn specialize;
+  std::unordered_map<uint32_t, std::unique_ptr<BurnhopePipeline>> variants;
+};
+
+class BurnhopeComputePipeline {
+ public:
+  BurnhopeComputePipeline(
+      BurnhopeDevice& device, const std::string& compFilepath, VkPipelineLayout pipelineLayout);
+  ~BurnhopeComputePipeline();
+
+  BurnhopeComputePipeline(const BurnhopeComputePipeline&) = delete;
+  BurnhopeComputePipeline& operator=(const BurnhopeComputePipeline&) = delete;
+
+  void bind(VkCommandBuffer commandBuffer);
+
+ private:
+  BurnhopeDevice& lveDevice;
+  VkPipeline computePipeline;
+  VkShaderModule compShaderModule;
 };
 }  // namespace burnhope
@@ -0,0 +1,245 @@
+#include "lve_render_queue.hpp"
+
+// std
+#include <cassert>
+#include <numeric>
+
+namespace burnhope {
+
+namespace {
+
+constexpr uint64_t DEPTH_MASK = (1ull << BurnhopeRenderQueue::DEPTH_BITS) - 1;
+
+// maps [0, inf) onto [0, DEPTH_MASK] monotonically, so no far plane is needed
+uint64_t quantizeDepth(float viewDistance) {
+  float distance = viewDistance > 0.f ? viewDistance : 0.f;
+  float normalized = distance / (1.f + distance);
+  return static_cast<uint64_t>(normalized * static_cast<float>(DEPTH_MASK)) & DEPTH_MASK;
+}
+
+uint64_t bucketBits(BurnhopeRenderQueue::Bucket bucket) {
+  return static_cast<uint64_t>(bucket) << 60;
+}
+
+}  // namespace
+
+uint64_t BurnhopeRenderQueue::makeDepthPrePassKey(
+    uint32_t pipelineId, uint32_t meshId, float viewDistance) {
+  return bucketBits(Bucket::DepthPrePass) | (static_cast<uint64_t>(pipelineId & 0xFF) << 52) |
+         (static_cast<uint64_t>(meshId & 0xFFFF) << 20) | quantizeDepth(viewDistance);
+}
+
+uint64_t BurnhopeRenderQueue::makeOpaqueKey(
+    uint32_t pipelineId, uint32_t materialId, uint32_t meshId, float viewDistance) {
+  return bucketBits(Bucket::Opaque) | (static_cast<uint64_t>(pipelineId & 0xFF) << 52) |
+         (static_cast<uint64_t>(materialId & 0xFFFF) << 36) |
+         (static_cast<uint64_t>(meshId & 0xFFFF) << 20) | quantizeDepth(viewDistance);
+}
+
+uint64_t BurnhopeRenderQueue::makeBlendedKey(
+    uint32_t pipelineId, uint32_t materialId, uint32_t meshId, float viewDistance) {
+  return bucketBits(Bucket::Blended) | ((DEPTH_MASK - quantizeDepth(viewDistance)) << 40) |
+         (static_cast<uint64_t>(pipelineId & 0xFF) << 32) |
+         (static_cast<uint64_t>(materialId & 0xFFFF) << 16) |
+         static_cast<uint64_t>(meshId & 0xFFFF);
+}
+
+void BurnhopeRenderQueue::radixSort(
+    const std::vector<uint64_t> &keys,
+    std::vector<uint32_t> &order,
+    std::vector<uint32_t> &scratch) {
+  const size_t count = keys.size();
+  order.resize(count);
+  std::iota(order.begin(), order.end(), 0u);
+  if (count < 2) return;
+  scratch.resize(count);
+
+  // all eight digit histograms in a single pass over the keys
+  std::array<std::array<uint32_t, 256>, 8> histograms{};
+  for (uint64_t key : keys) {
+    for (int digit = 0; digit < 8; digit++) {
+      histograms[digit][(key >> (digit * 8)) & 0xFF]++;
+    }
+  }
+
+  for (int digit = 0; digit < 8; digit++) {
+    auto &histogram = histograms[digit];
+    const int shift = digit * 8;
+    if (histogram[(keys[0] >> shift) & 0xFF] == count) continue;
+
+    uint32_t offset = 0;
+    for (auto &bucket : histogram) {
+      uint32_t bucketCount = bucket;
+      bucket = offset;
+      offset += bucketCount;
+    }
+    for (uint32_t index : order) {
+      scratch[histogram[(keys[index] >> shift) & 0xFF]++] = index;
+    }
+    order.swap(scratch);
+  }
+}
+
+uint32_t BurnhopeRenderQueue::stateId(const void *state) {
+  auto it = stateIds.find(state);
+  if (it != stateIds.end()) {
+    return it->second;
+  }
+  uint32_t id = static_cast<uint32_t>(stateIds.size());
+  stateIds.emplace(state, id);
+  return id;
+}
+
+void BurnhopeRenderQueue::reset() {
+  packets.clear();
+  keys.clear();
+  order.clear();
+  stateIds.clear();
+}
+
+void BurnhopeRenderQueue::submit(const RenderPacket &packet) {
+  assert(packet.pipeline != nullptr && "Render packet without a pipeline");
+  packets.push_back(packet);
+  keys.push_back(packet.sortKey);
+}
+
+void BurnhopeRenderQueue::sort() { radixSort(keys, order, scratch); }
+
+void BurnhopeRenderQueue::execute(VkCommandBuffer commandBuffer) {
+  executeRange(commandBuffer, 0, 1);
+}
+
+void BurnhopeRenderQueue::executeRange(
+    VkCommandBuffer commandBuffer, uint32_t rangeIndex, uint32_t rangeCount) {
+  assert(order.size() == packets.size() && "BurnhopeRenderQueue::sort must run before execute");
+  assert(rangeIndex < rangeCount && "Render queue range out of bounds");
+
+  const size_t first = order.size() * rangeIndex / rangeCount;
+  const size_t last = order.size() * (rangeIndex + 1) / rangeCount;
+
+  // every range starts from nothing bound, it may be in its own command buffer
+  Stats rangeStats{};
+  BurnhopePipeline *boundPipeline = nullptr;
+  VkPipelineLayout boundLayout = VK_NULL_HANDLE;
+  std::array<VkDescriptorSet, RenderPacket::MAX_DESCRIPTOR_SETS> boundSets{};
+  BurnhopeModel *boundModel = nullptr;
+  bool boundPositionsOnly = false;
+
+  for (size_t i = first; i < last; i++) {
+    const RenderPacket &packet = packets[order[i]];
+    rangeStats.packets++;
+
+    if (packet.pipeline != boundPipeline) {
+      packet.pipeline->bind(commandBuffer);
+      boundPipeline = packet.pipeline;
+      rangeStats.pipelineBinds++;
+    } else {
+      rangeStats.pipelineBindsSaved++;
+    }
+
+    // sets bound under another layout are not assumed to stay compatible
+    if (packet.pipelineLayout != boundLayout) {
+      boundSets.fill(VK_NULL_HANDLE);
+      boundLayout = packet.pipelineLayout;
+    }
+    for (uint32_t set = 0; set < RenderPacket::MAX_DESCRIPTOR_SETS; set++) {
+      VkDescriptorSet descriptorSet = packet.descriptorSets[set];
+      if (descriptorSet == VK_NULL_HANDLE) continue;
+      if (descriptorSet == boundSets[set]) {
+        rangeStats.descriptorSetBindsSaved++;
+        continue;
+      }
+      vkCmdBindDescriptorSets(
+          commandBuffer,
+          VK_PIPELINE_BIND_POINT_GRAPHICS,
+          packet.pipelineLayout,
+          set,
+          1,
+          &descriptorSet,
+          0,
+          nullptr);
+      boundSets[set] = descriptorSet;
+      rangeStats.descriptorSetBinds++;
+    }
+
+    if (packet.pushConstantSize > 0) {
+      vkCmdPushConstants(
+          commandBuffer,
+          packet.pipelineLayout,
+          packet.pushConstantStages,
+          0,
+          packet.pushConstantSize,
+          packet.pushConstants.data());
+    }
+
+    if (packet.model != nullptr) {
+      if (packet.model != boundModel || packet.positionsOnly != boundPositionsOnly) {
+        if (packet.positionsOnly) {
+          packet.model->bindPositions(commandBuffer);
+        } else {
+          packet.model->bind(commandBuffer);
+        }
+        boundModel = packet.model;
+        boundPositionsOnly = packet.positionsOnly;
+        rangeStats.vertexBufferBinds++;
+      } else {
+        rangeStats.vertexBufferBindsSaved++;
+      }
+    }
+
+    if (packet.indirectBuffer != VK_NULL_HANDLE) {
+      drawIndirect(commandBuffer, packet);
+    } else if (packet.model != nullptr) {
+      packet.model->draw(commandBuffer, packet.instanceCount, packet.firstInstance);
+    } else {
+      vkCmdDraw(commandBuffer, packet.vertexCount, packet.instanceCount, 0, packet.firstInstance);
+    }
+  }
+
+  std::lock_guard<std::mutex> lock{statsMutex};
+  stats += rangeStats;
+}
+
+void BurnhopeRenderQueue::drawIndirect(
+    VkCommandBuffer commandBuffer, const RenderPacket &packet) const {
+  constexpr uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+  if (packet.countBuffer != VK_NULL_HANDLE) {
+    assert(
+        lveDevice.cmdDrawIndexedIndirectCount() != nullptr &&
+        "Draw count buffer used without VK_KHR_draw_indirect_count");
+    lveDevice.cmdDrawIndexedIndirectCount()(
+        commandBuffer,
+        packet.indirectBuffer,
+        packet.indirectOffset,
+        packet.countBuffer,
+        packet.countOffset,
+        packet.indirectDrawCount,
+        stride);
+  } else if (lveDevice.getEnabledFeatures().multiDrawIndirect) {
+    vkCmdDrawIndexedIndirect(
+        commandBuffer,
+        packet.indirectBuffer,
+        packet.indirectOffset,
+        packet.indirectDrawCount,
+        stride);
+  } else {
+    // without multiDrawIndirect the draw count must be 0 or 1
+    for (uint32_t i = 0; i < packet.indirectDrawCount; i++) {
+      vkCmdDrawIndexedIndirect(
+          commandBuffer,
+          packet.indirectBuffer,
+          packet.indirectOffset + i * stride,
+          1,
+          stride);
+    }
+  }
+}
+
+BurnhopeRenderQueue::Stats BurnhopeRenderQueue::takeStats() {
+  std::lock_guard<std::mutex> lock{statsMutex};
+  Stats result = stats;
+  stats = {};
+  return result;
+}
+
+}  // namespace burnhope
@@ -0,0 +1,141 @@
+#pragma once
+
+#include "lve_model.hpp"
+#include "lve_pipeline.hpp"
+
+// std
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace burnhope {
+
+// Everything needed to record one (possibly instanced) draw. Systems fill these in and submit
+// them to the render queue instead of recording into the command buffer themselves.
+struct RenderPacket {
+  static constexpr uint32_t MAX_DESCRIPTOR_SETS = 4;
+  static constexpr uint32_t MAX_PUSH_CONSTANT_SIZE = 64;
+
+  uint64_t sortKey = 0;
+  BurnhopePipeline *pipeline = nullptr;
+  VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+  // indexed by set number, VK_NULL_HANDLE leaves that set alone
+  std::array<VkDescriptorSet, MAX_DESCRIPTOR_SETS> descriptorSets{};
+  // nullptr draws vertexCount vertices without vertex buffers
+  BurnhopeModel *model = nullptr;
+  // binds the model's position-only stream instead of the full vertex buffer
+  bool positionsOnly = false;
+  uint32_t vertexCount = 0;
+  uint32_t instanceCount = 1;
+  uint32_t firstInstance = 0;
+  // when set, indirectDrawCount VkDrawIndexedIndirectCommands are read from indirectBuffer
+  // instead, and with a countBuffer the actual count comes from there
+  VkBuffer indirectBuffer = VK_NULL_HANDLE;
+  VkDeviceSize indirectOffset = 0;
+  uint32_t indirectDrawCount = 0;
+  VkBuffer countBuffer = VK_NULL_HANDLE;
+  VkDeviceSize countOffset = 0;
+  VkShaderStageFlags pushConstantStages = 0;
+  uint32_t pushConstantSize = 0;
+  std::array<uint8_t, MAX_PUSH_CONSTANT_SIZE> pushConstants{};
+
+  template <typename T>
+  void setPushConstants(VkShaderStageFlags stages, const T &data) {
+    static_assert(sizeof(T) <= MAX_PUSH_CONSTANT_SIZE, "push constants too large for a packet");
+    pushConstantStages = stages;
+    pushConstantSize = sizeof(T);
+    std::memcpy(pushConstants.data(), &data, sizeof(T));
+  }
+};
+
+// Collects render packets for a frame, radix sorts them by their 64 bit key and records them
+// with redundant pipeline, descriptor set and vertex buffer binds skipped, either inline or split
+// into ranges that are recorded in parallel.
+//
+// Key layout, most significant bits first:
+//   depth pre-pass: bucket(4) | pipeline(8) | 0(16) | mesh(16) | depth(20), front-to-back
+//   opaque:  bucket(4) | pipeline(8) | material(16) | mesh(16) | depth(20), front-to-back
+//   blended: bucket(4) | inverted depth(20) | pipeline(8) | material(16) | mesh(16), back-to-front
+class BurnhopeRenderQueue {
+ public:
+  enum class Bucket : uint8_t { DepthPrePass = 0, Opaque = 1, Blended = 2 };
+
+  static constexpr uint32_t DEPTH_BITS = 20;
+
+  struct Stats {
+    uint32_t packets = 0;
+    uint32_t pipelineBinds = 0;
+    uint32_t pipelineBindsSaved = 0;
+    uint32_t descriptorSetBinds = 0;
+    uint32_t descriptorSetBindsSaved = 0;
+    uint32_t vertexBufferBinds = 0;
+    uint32_t vertexBufferBindsSaved = 0;
+
+    uint32_t bindsSaved() const {
+      return pipelineBindsSaved + descriptorSetBindsSaved + vertexBufferBindsSaved;
+    }
+
+    Stats &operator+=(const Stats &other) {
+      packets += other.packets;
+      pipelineBinds += other.pipelineBinds;
+      pipelineBindsSaved += other.pipelineBindsSaved;
+      descriptorSetBinds += other.descriptorSetBinds;
+      descriptorSetBindsSaved += other.descriptorSetBindsSaved;
+      vertexBufferBinds += other.vertexBufferBinds;
+      vertexBufferBindsSaved += other.vertexBufferBindsSaved;
+      return *this;
+    }
+  };
+
+  explicit BurnhopeRenderQueue(BurnhopeDevice &device) : lveDevice{device} {}
+  BurnhopeRenderQueue(const BurnhopeRenderQueue &) = delete;
+  BurnhopeRenderQueue &operator=(const BurnhopeRenderQueue &) = delete;
+
+  // materials don't matter without a fragment stage, so pre-pass draws only sort by mesh
+  static uint64_t makeDepthPrePassKey(uint32_t pipelineId, uint32_t meshId, float viewDistance);
+  static uint64_t makeOpaqueKey(
+      uint32_t pipelineId, uint32_t materialId, uint32_t meshId, float viewDistance);
+  static uint64_t makeBlendedKey(
+      uint32_t pipelineId, uint32_t materialId, uint32_t meshId, float viewDistance);
+
+  // Sorts order (indices into keys) by ascending key. LSD radix sort over 8 bit digits, digits
+  // that are the same for every key are skipped.
+  static void radixSort(
+      const std::vector<uint64_t> &keys,
+      std::vector<uint32_t> &order,
+      std::vector<uint32_t> &scratch);
+
+  // Small dense id for a pipeline, material or mesh, valid until the next reset. Ids only affect
+  // sort order, binds are always elided by comparing the actual handles.
+  uint32_t stateId(const void *state);
+
+  // call at the start of every frame
+  void reset();
+  void submit(const RenderPacket &packet);
+  void sort();
+  // records every packet in key order, sort() must have been called
+  void execute(VkCommandBuffer commandBuffer);
+  // Records the rangeIndex-th of rangeCount equal slices of the sorted packets. Different
+  // ranges may be recorded into different command buffers from different threads at once.
+  void executeRange(VkCommandBuffer commandBuffer, uint32_t rangeIndex, uint32_t rangeCount);
+
+  // returns the counters accumulated since the last call and resets them
+  Stats takeStats();
+
+ private:
+  void drawIndirect(VkCommandBuffer commandBuffer, const RenderPacket &packet) const;
+
+  BurnhopeDevice &lveDevice;
+  std::vector<RenderPacket> packets;
+  std::vector<uint64_t> keys;
+  std::vector<uint32_t> order;
+  std::vector<uint32_t> scratch;
+  std::unordered_map<const void *, uint32_t> stateIds;
+  std::mutex statsMutex;
+  Stats stats{};
+};
+
+}  // namespace burnhope
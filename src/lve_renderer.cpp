@@ -8,17 +8,26 @@
 namespace burnhope {
 
 BurnhopeRenderer::BurnhopeRenderer(BurnhopeWindow& window, BurnhopeDevice& device)
-    : lveWindow{window}, lveDevice{device} {
+    : lveWindow{&window}, lveDevice{device} {
   recreateSwapChain();
   createCommandBuffers();
 }
 
-BurnhopeRenderer::~BurnhopeRenderer() { freeCommandBuffers(); }
+BurnhopeRenderer::BurnhopeRenderer(BurnhopeDevice& device, VkExtent2D extent)
+    : lveWindow{nullptr}, lveDevice{device} {
+  offscreenTarget = std::make_unique<BurnhopeOffscreenTarget>(lveDevice, extent);
+  createCommandBuffers();
+}
+
+BurnhopeRenderer::~BurnhopeRenderer() {
+  commandThreadPool.reset();
+  freeCommandBuffers();
+}
 
 void BurnhopeRenderer::recreateSwapChain() {
-  auto extent = lveWindow.getExtent();
+  auto extent = lveWindow->getExtent();
   while (extent.width == 0 || extent.height == 0) {
-    extent = lveWindow.getExtent();
+    extent = lveWindow->getExtent();
     glfwWaitEvents();
   }
   vkDeviceWaitIdle(lveDevice.device());
@@ -62,7 +71,8 @@ void BurnhopeRenderer::freeCommandBuffers() {
 VkCommandBuffer BurnhopeRenderer::beginFrame() {
   assert(!isFrameStarted && "Can't call beginFrame while already in progress");
 
-  auto result = lveSwapChain->acquireNextImage(&currentImageIndex);
+  auto result = isHeadless() ? offscreenTarget->acquireNextImage(&currentImageIndex)
+                             : lveSwapChain->acquireNextImage(&currentImageIndex);
   if (result == VK_ERROR_OUT_OF_DATE_KHR) {
     recreateSwapChain();
     return nullptr;
@@ -91,10 +101,19 @@ void BurnhopeRenderer::endFrame() {
     throw std::runtime_error("failed to record command buffer!");
   }
 
+  if (isHeadless()) {
+    if (offscreenTarget->submitCommandBuffers(&commandBuffer, &currentImageIndex) != VK_SUCCESS) {
+      throw std::runtime_error("failed to submit draw command buffer!");
+    }
+    isFrameStarted = false;
+    currentFrameIndex = (currentFrameIndex + 1) % BurnhopeSwapChain::MAX_FRAMES_IN_FLIGHT;
+    return;
+  }
+
   auto result = lveSwapChain->submitCommandBuffers(&commandBuffer, &currentImageIndex);
   if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR ||
-      lveWindow.wasWindowResized()) {
-    lveWindow.resetWindowResizedFlag();
+      lveWindow->wasWindowResized()) {
+    lveWindow->resetWindowResizedFlag();
     recreateSwapChain();
   } else if (result != VK_SUCCESS) {
     throw std::runtime_error("failed to present swap chain image!");
@@ -112,11 +131,12 @@ void BurnhopeRenderer::beginSwapChainRenderPass(VkCommandBuffer commandBuffer) {
 
   VkRenderPassBeginInfo renderPassInfo{};
   renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-  renderPassInfo.renderPass = lveSwapChain->getRenderPass();
-  renderPassInfo.framebuffer = lveSwapChain->getFrameBuffer(currentImageIndex);
+  renderPassInfo.renderPass = getSwapChainRenderPass();
+  renderPassInfo.framebuffer = isHeadless() ? offscreenTarget->getFrameBuffer(currentImageIndex)
+                                            : lveSwapChain->getFrameBuffer(currentImageIndex);
 
   renderPassInfo.renderArea.offset = {0, 0};
-  renderPassInfo.renderArea.extent = lveSwapChain->getSwapChainExtent();
+  renderPassInfo.renderArea.extent = getRenderExtent();
 
   std::array<VkClearValue, 2> clearValues{};
   clearValues[0].color = {0.01f, 0.01f, 0.01f, 1.0f};
@@ -124,16 +144,25 @@ void BurnhopeRenderer::beginSwapChainRenderPass(VkCommandBuffer commandBuffer) {
   renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
   renderPassInfo.pClearValues = clearValues.data();
 
+  if (recordsInSecondaryBuffers()) {
+    // dynamic state is not inherited, every secondary buffer sets its own viewport
+    vkCmdBeginRenderPass(
+        commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+    return;
+  }
   vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+  setViewportAndScissor(commandBuffer);
+}
 
+void BurnhopeRenderer::setViewportAndScissor(VkCommandBuffer commandBuffer) const {
   VkViewport viewport{};
   viewport.x = 0.0f;
   viewport.y = 0.0f;
-  viewport.width = static_cast<float>(lveSwapChain->getSwapChainExtent().width);
-  viewport.height = static_cast<float>(lveSwapChain->getSwapChainExtent().height);
+  viewport.width = static_cast<float>(getRenderExtent().width);
+  viewport.height = static_cast<float>(getRenderExtent().height);
   viewport.minDepth = 0.0f;
   viewport.maxDepth = 1.0f;
-  VkRect2D scissor{{0, 0}, lveSwapChain->getSwapChainExtent()};
+  VkRect2D scissor{{0, 0}, getRenderExtent()};
   vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
   vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
 }
@@ -146,4 +175,55 @@ void BurnhopeRenderer::endSwapChainRenderPass(VkCommandBuffer commandBuffer) {
   vkCmdEndRenderPass(commandBuffer);
 }
 
+void BurnhopeRenderer::setRecordingThreads(uint32_t threadCount) {
+  assert(!isFrameStarted && "Can't change recording threads while a frame is in progress");
+  // the pools may still be in use by frames in flight
+  vkDeviceWaitIdle(lveDevice.device());
+  commandThreadPool.reset();
+  if (threadCount > 0) {
+    commandThreadPool = std::make_unique<BurnhopeCommandThreadPool>(lveDevice, threadCount);
+  }
+}
+
+void BurnhopeRenderer::recordSecondaryCommandBuffers(
+    VkCommandBuffer commandBuffer, const RecordRangeFunction& recordRange) {
+  assert(isFrameStarted && "Can't record secondary buffers if frame is not in progress");
+  assert(recordsInSecondaryBuffers() && "setRecordingThreads was not called");
+
+  VkCommandBufferInheritanceInfo inheritanceInfo{};
+  inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+  inheritanceInfo.renderPass = getSwapChainRenderPass();
+  inheritanceInfo.subpass = 0;
+  inheritanceInfo.framebuffer = isHeadless() ? offscreenTarget->getFrameBuffer(currentImageIndex)
+                                             : lveSwapChain->getFrameBuffer(currentImageIndex);
+
+  const uint32_t rangeCount = commandThreadPool->getThreadCount();
+  const auto& secondaryBuffers = commandThreadPool->record(
+      currentFrameIndex,
+      inheritanceInfo,
+      [&](uint32_t threadIndex, VkCommandBuffer secondaryBuffer) {
+        setViewportAndScissor(secondaryBuffer);
+        recordRange(threadIndex, rangeCount, secondaryBuffer);
+      });
+  vkCmdExecuteCommands(
+      commandBuffer, static_cast<uint32_t>(secondaryBuffers.size()), secondaryBuffers.data());
+}
+
+std::vector<BurnhopeCommandThreadPool::ThreadStats> BurnhopeRenderer::takeRecordingStats() {
+  if (!commandThreadPool) {
+    return {};
+  }
+  return commandThreadPool->takeStats();
+}
+
+void BurnhopeRenderer::captureFrame(const std::string& filepath) {
+  assert(isHeadless() && "Frame capture is only supported by the headless renderer");
+  assert(!isFrameStarted && "Can't capture a frame while one is being recorded");
+  offscreenTarget->saveToPng(filepath);
+}
+
+VkExtent2D BurnhopeRenderer::getRenderExtent() const {
+  return isHeadless() ? offscreenTarget->getExtent() : lveSwapChain->getSwapChainExtent();
+}
+
 }  // namespace burnhope
@@ -1,26 +1,44 @@
 #pragma once
 
+#include "lve_command_thread_pool.hpp"
 #include "lve_device.hpp"
+#include "lve_offscreen_target.hpp"
 #include "lve_swap_chain.hpp"
 #include "lve_window.hpp"
 
 // std
 #include <cassert>
+#include <functional>
 #include <memory>
+#include <string>
 #include <vector>
 
 namespace burnhope {
 class BurnhopeRenderer {
  public:
+  // called on a recording thread for range rangeIndex of rangeCount, in a secondary command
+  // buffer that is already inside the swapchain render pass with viewport and scissor set
+  using RecordRangeFunction = std::function<void(
+      uint32_t rangeIndex, uint32_t rangeCount, VkCommandBuffer commandBuffer)>;
+
   BurnhopeRenderer(BurnhopeWindow &window, BurnhopeDevice &device);
+  // headless renderer, draws into a BurnhopeOffscreenTarget of the given extent
+  BurnhopeRenderer(BurnhopeDevice &device, VkExtent2D extent);
   ~BurnhopeRenderer();
 
   BurnhopeRenderer(const BurnhopeRenderer &) = delete;
   BurnhopeRenderer &operator=(const BurnhopeRenderer &) = delete;
 
-  VkRenderPass getSwapChainRenderPass() const { return lveSwapChain->getRenderPass(); }
-  float getAspectRatio() const { return lveSwapChain->extentAspectRatio(); }
+  VkRenderPass getSwapChainRenderPass() const {
+    return isHeadless() ? offscreenTarget->getRenderPass() : lveSwapChain->getRenderPass();
+  }
+  float getAspectRatio() const {
+    return isHeadless() ? offscreenTarget->extentAspectRatio() : lveSwapChain->extentAspectRatio();
+  }
+  // size of the swapchain images, or of the offscreen target when headless
+  VkExtent2D getRenderExtent() const;
   bool isFrameInProgress() const { return isFrameStarted; }
+  bool isHeadless() const { return offscreenTarget != nullptr; }
 
   VkCommandBuffer getCurrentCommandBuffer() const {
     assert(isFrameStarted && "Cannot get command buffer when frame not in progress");
@@ -37,15 +55,32 @@ class BurnhopeRenderer {
   void beginSwapChainRenderPass(VkCommandBuffer commandBuffer);
   void endSwapChainRenderPass(VkCommandBuffer commandBuffer);
 
+  // With threadCount > 0 the swapchain render pass only takes secondary command buffers, which
+  // are recorded with recordSecondaryCommandBuffers. 0 goes back to recording inline.
+  void setRecordingThreads(uint32_t threadCount);
+  bool recordsInSecondaryBuffers() const { return commandThreadPool != nullptr; }
+  // Records one range per recording thread in parallel and executes them in range order. Call
+  // between beginSwapChainRenderPass and endSwapChainRenderPass.
+  void recordSecondaryCommandBuffers(
+      VkCommandBuffer commandBuffer, const RecordRangeFunction &recordRange);
+  // recording time per thread since the last call, empty when recording inline
+  std::vector<BurnhopeCommandThreadPool::ThreadStats> takeRecordingStats();
+
+  // headless only: reads back the most recently rendered frame
+  void captureFrame(const std::string &filepath);
+
  private:
   void createCommandBuffers();
   void freeCommandBuffers();
   void recreateSwapChain();
+  void setViewportAndScissor(VkCommandBuffer commandBuffer) const;
 
-  BurnhopeWindow &lveWindow;
+  BurnhopeWindow *lveWindow;
   BurnhopeDevice &lveDevice;
   std::unique_ptr<BurnhopeSwapChain> lveSwapChain;
+  std::unique_ptr<BurnhopeOffscreenTarget> offscreenTarget;
   std::vector<VkCommandBuffer> commandBuffers;
+  std::unique_ptr<BurnhopeCommandThreadPool> commandThreadPool;
 
   uint32_t currentImageIndex;
   int currentFrameIndex{0};
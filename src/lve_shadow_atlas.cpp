@@ -0,0 +1,301 @@
+#include "lve_shadow_atlas.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+namespace burnhope {
+
+BurnhopeShadowAtlas::BurnhopeShadowAtlas(BurnhopeDevice &device) : lveDevice{device} {
+  createAtlas();
+  createSampler();
+  createRenderPass();
+  createFramebuffer();
+  freeTiles[0].push_back(Tile{0, 0, SIZE});
+}
+
+BurnhopeShadowAtlas::~BurnhopeShadowAtlas() {
+  vkDestroyFramebuffer(lveDevice.device(), framebuffer, nullptr);
+  vkDestroyRenderPass(lveDevice.device(), renderPass, nullptr);
+  vkDestroySampler(lveDevice.device(), compareSampler, nullptr);
+}
+
+void BurnhopeShadowAtlas::createAtlas() {
+  VkFormat format = lveDevice.findSupportedFormat(
+      {VK_FORMAT_D32_SFLOAT, VK_FORMAT_D16_UNORM},
+      VK_IMAGE_TILING_OPTIMAL,
+      VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT);
+  depthTexture = std::make_unique<BurnhopeTexture>(
+      lveDevice,
+      format,
+      VkExtent3D{SIZE, SIZE, 1},
+      VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT |
+          VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+      VK_SAMPLE_COUNT_1_BIT);
+
+  // tiles that were never drawn read as fully lit, and the render pass can always load
+  VkCommandBuffer commandBuffer = lveDevice.beginSingleTimeCommands();
+  VkImageSubresourceRange range{};
+  range.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+  range.levelCount = 1;
+  range.layerCount = 1;
+
+  VkImageMemoryBarrier barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.image = depthTexture->getImage();
+  barrier.subresourceRange = range;
+  barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+  barrier.srcAccessMask = 0;
+  barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  vkCmdPipelineBarrier(
+      commandBuffer,
+      VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+      VK_PIPELINE_STAGE_TRANSFER_BIT,
+      0,
+      0,
+      nullptr,
+      0,
+      nullptr,
+      1,
+      &barrier);
+
+  VkClearDepthStencilValue clearValue{1.f, 0};
+  vkCmdClearDepthStencilImage(
+      commandBuffer,
+      depthTexture->getImage(),
+      VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+      &clearValue,
+      1,
+      &range);
+
+  barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+  barrier.newLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+  barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+  vkCmdPipelineBarrier(
+      commandBuffer,
+      VK_PIPELINE_STAGE_TRANSFER_BIT,
+      VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+      0,
+      0,
+      nullptr,
+      0,
+      nullptr,
+      1,
+      &barrier);
+  lveDevice.endSingleTimeCommands(commandBuffer);
+}
+
+void BurnhopeShadowAtlas::createSampler() {
+  // hardware 2x2 PCF: texture() on a sampler2DShadow returns the filtered comparison result
+  VkSamplerCreateInfo samplerInfo{};
+  samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+  samplerInfo.magFilter = VK_FILTER_LINEAR;
+  samplerInfo.minFilter = VK_FILTER_LINEAR;
+  samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+  samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+  samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+  samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+  samplerInfo.anisotropyEnable = VK_FALSE;
+  samplerInfo.maxAnisotropy = 1.f;
+  samplerInfo.compareEnable = VK_TRUE;
+  samplerInfo.compareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+  samplerInfo.minLod = 0.f;
+  samplerInfo.maxLod = 0.f;
+  samplerInfo.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE;
+  samplerInfo.unnormalizedCoordinates = VK_FALSE;
+  if (vkCreateSampler(lveDevice.device(), &samplerInfo, nullptr, &compareSampler) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create shadow sampler!");
+  }
+}
+
+void BurnhopeShadowAtlas::createRenderPass() {
+  VkAttachmentDescription depthAttachment{};
+  depthAttachment.format = depthTexture->getFormat();
+  depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+  depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+  depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+  depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+  depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+  depthAttachment.initialLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+  depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+
+  VkAttachmentReference depthAttachmentRef{};
+  depthAttachmentRef.attachment = 0;
+  depthAttachmentRef.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+  VkSubpassDescription subpass{};
+  subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+  subpass.colorAttachmentCount = 0;
+  subpass.pDepthStencilAttachment = &depthAttachmentRef;
+
+  // tiles are redrawn only after earlier frames are done sampling the atlas, and sampled only
+  // after the redraw
+  std::array<VkSubpassDependency, 2> dependencies{};
+  dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+  dependencies[0].dstSubpass = 0;
+  dependencies[0].srcStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+  dependencies[0].srcAccessMask = 0;
+  dependencies[0].dstStageMask =
+      VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+  dependencies[0].dstAccessMask =
+      VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+  dependencies[1].srcSubpass = 0;
+  dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+  dependencies[1].srcStageMask = VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+  dependencies[1].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+  dependencies[1].dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+  dependencies[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+  VkRenderPassCreateInfo renderPassInfo{};
+  renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+  renderPassInfo.attachmentCount = 1;
+  renderPassInfo.pAttachments = &depthAttachment;
+  renderPassInfo.subpassCount = 1;
+  renderPassInfo.pSubpasses = &subpass;
+  renderPassInfo.dependencyCount = static_cast<uint32_t>(dependencies.size());
+  renderPassInfo.pDependencies = dependencies.data();
+  if (vkCreateRenderPass(lveDevice.device(), &renderPassInfo, nullptr, &renderPass) !=
+      VK_SUCCESS) {
+    throw std::runtime_error("failed to create shadow atlas render pass!");
+  }
+}
+
+void BurnhopeShadowAtlas::createFramebuffer() {
+  VkImageView attachment = depthTexture->getImageView();
+  VkFramebufferCreateInfo framebufferInfo{};
+  framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+  framebufferInfo.renderPass = renderPass;
+  framebufferInfo.attachmentCount = 1;
+  framebufferInfo.pAttachments = &attachment;
+  framebufferInfo.width = SIZE;
+  framebufferInfo.height = SIZE;
+  framebufferInfo.layers = 1;
+  if (vkCreateFramebuffer(lveDevice.device(), &framebufferInfo, nullptr, &framebuffer) !=
+      VK_SUCCESS) {
+    throw std::runtime_error("failed to create shadow atlas framebuffer!");
+  }
+}
+
+uint32_t BurnhopeShadowAtlas::levelOf(uint32_t size) {
+  uint32_t level = 0;
+  uint32_t levelSize = SIZE;
+  while (level + 1 < LEVEL_COUNT && levelSize / 2 >= size) {
+    levelSize /= 2;
+    level++;
+  }
+  return level;
+}
+
+bool BurnhopeShadowAtlas::allocate(uint32_t size, Tile &tile) {
+  const uint32_t level = levelOf(std::max(size, MIN_TILE_SIZE));
+
+  // smallest free tile at or above the wanted level, split down to it
+  int sourceLevel = static_cast<int>(level);
+  while (sourceLevel >= 0 && freeTiles[sourceLevel].empty()) {
+    sourceLevel--;
+  }
+  if (sourceLevel < 0) {
+    return false;
+  }
+  for (uint32_t splitLevel = sourceLevel; splitLevel < level; splitLevel++) {
+    Tile parent = freeTiles[splitLevel].back();
+    freeTiles[splitLevel].pop_back();
+    uint32_t half = parent.size / 2;
+    // the first child is handed on, the other three stay free
+    freeTiles[splitLevel + 1].push_back(Tile{parent.x + half, parent.y + half, half});
+    freeTiles[splitLevel + 1].push_back(Tile{parent.x, parent.y + half, half});
+    freeTiles[splitLevel + 1].push_back(Tile{parent.x + half, parent.y, half});
+    freeTiles[splitLevel + 1].push_back(Tile{parent.x, parent.y, half});
+  }
+  tile = freeTiles[level].back();
+  freeTiles[level].pop_back();
+  freeTexels -= tile.size * tile.size;
+  return true;
+}
+
+void BurnhopeShadowAtlas::release(const Tile &tile) {
+  assert(tile.size >= MIN_TILE_SIZE && "Releasing an empty shadow atlas tile");
+  freeTexels += tile.size * tile.size;
+
+  // merge with the three buddies while they are all free
+  Tile freed = tile;
+  uint32_t level = levelOf(freed.size);
+  while (level > 0) {
+    uint32_t parentSize = freed.size * 2;
+    uint32_t parentX = freed.x - freed.x % parentSize;
+    uint32_t parentY = freed.y - freed.y % parentSize;
+    auto &levelTiles = freeTiles[level];
+    auto isBuddy = [&](const Tile &other) {
+      return other != freed && other.x - other.x % parentSize == parentX &&
+             other.y - other.y % parentSize == parentY;
+    };
+    if (std::count_if(levelTiles.begin(), levelTiles.end(), isBuddy) != 3) break;
+    levelTiles.erase(
+        std::remove_if(levelTiles.begin(), levelTiles.end(), isBuddy),
+        levelTiles.end());
+    freed = Tile{parentX, parentY, parentSize};
+    level--;
+  }
+  freeTiles[level].push_back(freed);
+}
+
+VkDescriptorImageInfo BurnhopeShadowAtlas::getDescriptorInfo() const {
+  VkDescriptorImageInfo imageInfo{};
+  imageInfo.sampler = compareSampler;
+  imageInfo.imageView = depthTexture->getImageView();
+  imageInfo.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+  return imageInfo;
+}
+
+void BurnhopeShadowAtlas::beginRenderPass(VkCommandBuffer commandBuffer) {
+  VkRenderPassBeginInfo renderPassInfo{};
+  renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+  renderPassInfo.renderPass = renderPass;
+  renderPassInfo.framebuffer = framebuffer;
+  renderPassInfo.renderArea.offset = {0, 0};
+  renderPassInfo.renderArea.extent = {SIZE, SIZE};
+  renderPassInfo.clearValueCount = 0;
+  renderPassInfo.pClearValues = nullptr;
+  vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+}
+
+void BurnhopeShadowAtlas::endRenderPass(VkCommandBuffer commandBuffer) {
+  vkCmdEndRenderPass(commandBuffer);
+}
+
+void BurnhopeShadowAtlas::beginTile(VkCommandBuffer commandBuffer, const Tile &tile) {
+  VkViewport viewport{};
+  viewport.x = static_cast<float>(tile.x);
+  viewport.y = static_cast<float>(tile.y);
+  viewport.width = static_cast<float>(tile.size);
+  viewport.height = static_cast<float>(tile.size);
+  viewport.minDepth = 0.f;
+  viewport.maxDepth = 1.f;
+  VkRect2D scissor{
+      {static_cast<int32_t>(tile.x), static_cast<int32_t>(tile.y)},
+      {tile.size, tile.size}};
+  vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+  vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+  VkClearAttachment clearAttachment{};
+  clearAttachment.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+  clearAttachment.clearValue.depthStencil = {1.f, 0};
+  VkClearRect clearRect{};
+  clearRect.rect = scissor;
+  clearRect.baseArrayLayer = 0;
+  clearRect.layerCount = 1;
+  vkCmdClearAttachments(commandBuffer, 1, &clearAttachment, 1, &clearRect);
+}
+
+glm::vec4 BurnhopeShadowAtlas::tileRect(const Tile &tile) {
+  constexpr float texel = 1.f / SIZE;
+  return glm::vec4{tile.x * texel, tile.y * texel, tile.size * texel, tile.size * texel};
+}
+
+}  // namespace burnhope
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "lve_device.hpp"
+#include "lve_texture.hpp"
+
+// libs
+#include <glm/glm.hpp>
+
+// std
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace burnhope {
+
+// One large depth texture that every shadow map is a square tile of, so the main pass samples
+// all shadows through a single descriptor. Tiles are handed out by a buddy allocator over
+// power-of-two sizes. The atlas keeps its contents between frames: its render pass loads and
+// stores depth and only the tiles being redrawn are cleared, which is what lets unchanged shadow
+// maps be reused.
+class BurnhopeShadowAtlas {
+ public:
+  static constexpr uint32_t SIZE = 4096;
+  static constexpr uint32_t MIN_TILE_SIZE = 128;
+
+  struct Tile {
+    uint32_t x = 0;
+    uint32_t y = 0;
+    uint32_t size = 0;  // 0 for no tile
+
+    bool operator==(const Tile &other) const {
+      return x == other.x && y == other.y && size == other.size;
+    }
+    bool operator!=(const Tile &other) const { return !(*this == other); }
+  };
+
+  explicit BurnhopeShadowAtlas(BurnhopeDevice &device);
+  ~BurnhopeShadowAtlas();
+
+  BurnhopeShadowAtlas(const BurnhopeShadowAtlas &) = delete;
+  BurnhopeShadowAtlas &operator=(const BurnhopeShadowAtlas &) = delete;
+
+  // size is rounded up to a power of two >= MIN_TILE_SIZE. Returns false when no free tile of
+  // that size is left.
+  bool allocate(uint32_t size, Tile &tile);
+  void release(const Tile &tile);
+  uint32_t getFreeTexels() const { return freeTexels; }
+
+  // depth comparison sampler over the whole atlas, in DEPTH_STENCIL_READ_ONLY_OPTIMAL
+  VkDescriptorImageInfo getDescriptorInfo() const;
+
+  VkRenderPass getRenderPass() const { return renderPass; }
+  // The render pass keeps everything outside the redrawn tiles. Call outside any other render
+  // pass; the atlas is readable by fragment shaders again after endRenderPass.
+  void beginRenderPass(VkCommandBuffer commandBuffer);
+  void endRenderPass(VkCommandBuffer commandBuffer);
+  // points the viewport and scissor at tile and clears its depth
+  void beginTile(VkCommandBuffer commandBuffer, const Tile &tile);
+
+  // xy is the tile's uv offset in the atlas and zw its uv size
+  static glm::vec4 tileRect(const Tile &tile);
+
+ private:
+  // level 0 is the whole atlas, each level halves the tile size
+  static constexpr uint32_t LEVEL_COUNT = 6;
+  static_assert(SIZE >> (LEVEL_COUNT - 1) == MIN_TILE_SIZE, "levels must reach MIN_TILE_SIZE");
+
+  static uint32_t levelOf(uint32_t size);
+  void createAtlas();
+  void createSampler();
+  void createRenderPass();
+  void createFramebuffer();
+
+  BurnhopeDevice &lveDevice;
+  std::unique_ptr<BurnhopeTexture> depthTexture;
+  VkSampler compareSampler = VK_NULL_HANDLE;
+  VkRenderPass renderPass = VK_NULL_HANDLE;
+  VkFramebuffer framebuffer = VK_NULL_HANDLE;
+
+  std::array<std::vector<Tile>, LEVEL_COUNT> freeTiles;
+  uint32_t freeTexels = SIZE * SIZE;
+};
+
+}  // namespace burnhope
@@ -5,8 +5,11 @@
 #include <stb_image.h>
 
 // std
+#include <algorithm>
 #include <cmath>
+#include <cstring>
 #include <stdexcept>
+#include <vector>
 
 namespace burnhope {
 BurnhopeTexture::BurnhopeTexture(BurnhopeDevice &device, const std::string &textureFilepath) : mDevice{device} {
@@ -101,11 +104,109 @@ BurnhopeTexture::BurnhopeTexture(
   }
 }
 
+BurnhopeTexture::BurnhopeTexture(
+    BurnhopeDevice &device,
+    VkFormat format,
+    VkExtent3D extent,
+    uint32_t mipLevels,
+    uint32_t layerCount,
+    uint32_t texelSize,
+    const void *texels)
+    : mDevice{device} {
+  mFormat = format;
+  mExtent = extent;
+  mMipLevels = mipLevels;
+  mLayerCount = layerCount;
+
+  // one copy region per mip and layer, in the order the texels are packed
+  std::vector<VkBufferImageCopy> regions;
+  VkDeviceSize imageSize = 0;
+  for (uint32_t mip = 0; mip < mMipLevels; mip++) {
+    uint32_t width = std::max(extent.width >> mip, 1u);
+    uint32_t height = std::max(extent.height >> mip, 1u);
+    for (uint32_t layer = 0; layer < mLayerCount; layer++) {
+      VkBufferImageCopy region{};
+      region.bufferOffset = imageSize;
+      region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+      region.imageSubresource.mipLevel = mip;
+      region.imageSubresource.baseArrayLayer = layer;
+      region.imageSubresource.layerCount = 1;
+      region.imageExtent = {width, height, 1};
+      regions.push_back(region);
+      imageSize += static_cast<VkDeviceSize>(width) * height * texelSize;
+    }
+  }
+
+  VkBuffer stagingBuffer;
+  VkDeviceMemory stagingBufferMemory;
+  mDevice.createBuffer(
+      imageSize,
+      VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+      MemoryUsage::Staging,
+      stagingBuffer,
+      stagingBufferMemory);
+  void *data;
+  vkMapMemory(mDevice.device(), stagingBufferMemory, 0, imageSize, 0, &data);
+  memcpy(data, texels, static_cast<size_t>(imageSize));
+  vkUnmapMemory(mDevice.device(), stagingBufferMemory);
+
+  VkImageCreateInfo imageInfo{};
+  imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+  imageInfo.flags = mLayerCount == 6 ? VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT : 0;
+  imageInfo.imageType = VK_IMAGE_TYPE_2D;
+  imageInfo.extent = mExtent;
+  imageInfo.mipLevels = mMipLevels;
+  imageInfo.arrayLayers = mLayerCount;
+  imageInfo.format = mFormat;
+  imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+  imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  imageInfo.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+  imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+  imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+  mDevice.createImageWithInfo(
+      imageInfo,
+      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+      mTextureImage,
+      mTextureImageMemory);
+
+  mDevice.transitionImageLayout(
+      mTextureImage,
+      mFormat,
+      VK_IMAGE_LAYOUT_UNDEFINED,
+      VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+      mMipLevels,
+      mLayerCount);
+  VkCommandBuffer commandBuffer = mDevice.beginSingleTimeCommands();
+  vkCmdCopyBufferToImage(
+      commandBuffer,
+      stagingBuffer,
+      mTextureImage,
+      VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+      static_cast<uint32_t>(regions.size()),
+      regions.data());
+  mDevice.endSingleTimeCommands(commandBuffer);
+  mDevice.transitionImageLayout(
+      mTextureImage,
+      mFormat,
+      VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+      VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+      mMipLevels,
+      mLayerCount);
+  mTextureLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+  vkDestroyBuffer(mDevice.device(), stagingBuffer, nullptr);
+  mDevice.freeMemory(stagingBufferMemory);
+
+  createTextureImageView(mLayerCount == 6 ? VK_IMAGE_VIEW_TYPE_CUBE : VK_IMAGE_VIEW_TYPE_2D);
+  createTextureSampler(VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE);
+  updateDescriptor();
+}
+
 BurnhopeTexture::~BurnhopeTexture() {
   vkDestroySampler(mDevice.device(), mTextureSampler, nullptr);
   vkDestroyImageView(mDevice.device(), mTextureImageView, nullptr);
   vkDestroyImage(mDevice.device(), mTextureImage, nullptr);
-  vkFreeMemory(mDevice.device(), mTextureImageMemory, nullptr);
+  mDevice.freeMemory(mTextureImageMemory);
 }
 
 std::unique_ptr<BurnhopeTexture> BurnhopeTexture::createTextureFromFile(
@@ -139,7 +240,7 @@ void BurnhopeTexture::createTextureImage(const std::string &filepath) {
   mDevice.createBuffer(
       imageSize,
       VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+      MemoryUsage::Staging,
       stagingBuffer,
       stagingBufferMemory);
 
@@ -200,7 +301,7 @@ void BurnhopeTexture::createTextureImage(const std::string &filepath) {
   mTextureLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
 
   vkDestroyBuffer(mDevice.device(), stagingBuffer, nullptr);
-  vkFreeMemory(mDevice.device(), stagingBufferMemory, nullptr);
+  mDevice.freeMemory(stagingBufferMemory);
 }
 
 void BurnhopeTexture::createTextureImageView(VkImageViewType viewType) {
@@ -208,7 +309,7 @@ void BurnhopeTexture::createTextureImageView(VkImageViewType viewType) {
   viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
   viewInfo.image = mTextureImage;
   viewInfo.viewType = viewType;
-  viewInfo.format = VK_FORMAT_R8G8B8A8_SRGB;
+  viewInfo.format = mFormat;
   viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
   viewInfo.subresourceRange.baseMipLevel = 0;
   viewInfo.subresourceRange.levelCount = mMipLevels;
@@ -220,15 +321,15 @@ void BurnhopeTexture::createTextureImageView(VkImageViewType viewType) {
   }
 }
 
-void BurnhopeTexture::createTextureSampler() {
+void BurnhopeTexture::createTextureSampler(VkSamplerAddressMode addressMode) {
   VkSamplerCreateInfo samplerInfo{};
   samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
   samplerInfo.magFilter = VK_FILTER_LINEAR;
   samplerInfo.minFilter = VK_FILTER_LINEAR;
 
-  samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-  samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-  samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+  samplerInfo.addressModeU = addressMode;
+  samplerInfo.addressModeV = addressMode;
+  samplerInfo.addressModeW = addressMode;
 
   samplerInfo.anisotropyEnable = VK_TRUE;
   samplerInfo.maxAnisotropy = 16.0f;
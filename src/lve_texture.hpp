@@ -19,6 +19,16 @@ class BurnhopeTexture {
       VkExtent3D extent,
       VkImageUsageFlags usage,
       VkSampleCountFlagBits sampleCount);
+  // Sampled image from tightly packed texels of texelSize bytes in format, ordered by mip level
+  // and then by layer. Six layers make a cube map. Sampled with clamp to edge and trilinear.
+  BurnhopeTexture(
+      BurnhopeDevice &device,
+      VkFormat format,
+      VkExtent3D extent,
+      uint32_t mipLevels,
+      uint32_t layerCount,
+      uint32_t texelSize,
+      const void *texels);
   ~BurnhopeTexture();
 
   // delete copy constructors
@@ -44,7 +54,8 @@ class BurnhopeTexture {
  private:
   void createTextureImage(const std::string &filepath);
   void createTextureImageView(VkImageViewType viewType);
-  void createTextureSampler();
+  void createTextureSampler(
+      VkSamplerAddressMode addressMode = VK_SAMPLER_ADDRESS_MODE_REPEAT);
 
   VkDescriptorImageInfo mDescriptor{};
 
@@ -1,15 +1,79 @@
 
+#include "benchmarks/component_benchmark.hpp"
+#include "benchmarks/culling_benchmark.hpp"
+#include "benchmarks/descriptor_benchmark.hpp"
+#include "benchmarks/lighting_benchmark.hpp"
 #include "first_app.hpp"
 
 // std
+#include <algorithm>
 #include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <stdexcept>
+#include <string>
 
-int main() {
-  burnhope::FirstApp app{};
+int main(int argc, char **argv) {
+  // --headless [--frames N] [--capture out.png] [--vases N] [--gpu-driven] [--occlusion]
+  //   [--record-threads N] [--depth-prepass] [--lights N] [--cluster-debug] [--deferred]
+  //   [--environment sky.hdr] [--churn N] | --benchmark <name>
+  burnhope::AppConfig config{};
+  std::string benchmark;
+  for (int i = 1; i < argc; i++) {
+    if (std::strcmp(argv[i], "--headless") == 0) {
+      config.headless = true;
+    } else if (std::strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+      config.headlessFrames = std::max(1, std::atoi(argv[++i]));
+    } else if (std::strcmp(argv[i], "--capture") == 0 && i + 1 < argc) {
+      config.capturePath = argv[++i];
+    } else if (std::strcmp(argv[i], "--vases") == 0 && i + 1 < argc) {
+      config.vaseCount = std::max(0, std::atoi(argv[++i]));
+    } else if (std::strcmp(argv[i], "--gpu-driven") == 0) {
+      config.gpuDriven = true;
+    } else if (std::strcmp(argv[i], "--occlusion") == 0) {
+      config.occlusionCulling = true;
+    } else if (std::strcmp(argv[i], "--record-threads") == 0 && i + 1 < argc) {
+      config.recordingThreads = static_cast<uint32_t>(std::max(0, std::atoi(argv[++i])));
+    } else if (std::strcmp(argv[i], "--depth-prepass") == 0) {
+      config.depthPrePass = true;
+    } else if (std::strcmp(argv[i], "--lights") == 0 && i + 1 < argc) {
+      config.extraLights = std::max(0, std::atoi(argv[++i]));
+    } else if (std::strcmp(argv[i], "--cluster-debug") == 0) {
+      config.clusterDebug = true;
+    } else if (std::strcmp(argv[i], "--deferred") == 0) {
+      config.deferred = true;
+    } else if (std::strcmp(argv[i], "--environment") == 0 && i + 1 < argc) {
+      config.environmentPath = argv[++i];
+    } else if (std::strcmp(argv[i], "--churn") == 0 && i + 1 < argc) {
+      config.churnPerFrame = std::max(0, std::atoi(argv[++i]));
+    } else if (std::strcmp(argv[i], "--benchmark") == 0 && i + 1 < argc) {
+      benchmark = argv[++i];
+    } else {
+      std::cerr << "unknown argument: " << argv[i] << '\n';
+      return EXIT_FAILURE;
+    }
+  }
 
   try {
+    if (benchmark == "descriptors") {
+      burnhope::BurnhopeDevice device{nullptr};
+      burnhope::runDescriptorBenchmark(device);
+      return EXIT_SUCCESS;
+    } else if (benchmark == "culling") {
+      burnhope::runCullingBenchmark();
+      return EXIT_SUCCESS;
+    } else if (benchmark == "lighting") {
+      burnhope::runLightingBenchmark();
+      return EXIT_SUCCESS;
+    } else if (benchmark == "components") {
+      burnhope::runComponentBenchmark();
+      return EXIT_SUCCESS;
+    } else if (!benchmark.empty()) {
+      std::cerr << "unknown benchmark: " << benchmark << '\n';
+      return EXIT_FAILURE;
+    }
+
+    burnhope::FirstApp app{config};
     app.run();
   } catch (const std::exception &e) {
     std::cerr << e.what() << '\n';
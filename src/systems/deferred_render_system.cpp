@@ -0,0 +1,191 @@
+#include "deferred_render_system.hpp"
+
+// std
+#include <array>
+#include <cassert>
+#include <stdexcept>
+#include <vector>
+
+namespace burnhope {
+
+namespace {
+
+// matches the swapchain pass's clear color, shows where the G-buffer has no geometry
+constexpr VkClearColorValue CLEAR_COLOR{{0.01f, 0.01f, 0.01f, 1.0f}};
+
+VkPipelineLayout createLayout(
+    BurnhopeDevice &device,
+    VkDescriptorSetLayout globalSetLayout,
+    VkDescriptorSetLayout setLayout) {
+  std::vector<VkDescriptorSetLayout> descriptorSetLayouts{globalSetLayout, setLayout};
+
+  VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+  pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+  pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(descriptorSetLayouts.size());
+  pipelineLayoutInfo.pSetLayouts = descriptorSetLayouts.data();
+  pipelineLayoutInfo.pushConstantRangeCount = 0;
+  pipelineLayoutInfo.pPushConstantRanges = nullptr;
+  VkPipelineLayout pipelineLayout;
+  if (vkCreatePipelineLayout(device.device(), &pipelineLayoutInfo, nullptr, &pipelineLayout) !=
+      VK_SUCCESS) {
+    throw std::runtime_error("failed to create pipeline layout!");
+  }
+  return pipelineLayout;
+}
+
+}  // namespace
+
+DeferredRenderSystem::DeferredRenderSystem(
+    BurnhopeDevice &device,
+    VkRenderPass swapChainRenderPass,
+    VkDescriptorSetLayout globalSetLayout,
+    VkExtent2D extent)
+    : lveDevice{device} {
+  gBuffer = std::make_unique<BurnhopeGBuffer>(lveDevice, extent);
+  createDescriptorSets(globalSetLayout);
+  createPipelines(swapChainRenderPass);
+}
+
+DeferredRenderSystem::~DeferredRenderSystem() {
+  vkDestroyPipelineLayout(lveDevice.device(), lightingPipelineLayout, nullptr);
+  vkDestroyPipelineLayout(lveDevice.device(), compositePipelineLayout, nullptr);
+}
+
+void DeferredRenderSystem::createDescriptorSets(VkDescriptorSetLayout globalSetLayout) {
+  // set 1 of the lighting subpass: albedo, normal, orm and depth
+  inputSetLayout =
+      BurnhopeDescriptorSetLayout::Builder(lveDevice)
+          .addBinding(0, VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, VK_SHADER_STAGE_FRAGMENT_BIT)
+          .addBinding(1, VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, VK_SHADER_STAGE_FRAGMENT_BIT)
+          .addBinding(2, VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, VK_SHADER_STAGE_FRAGMENT_BIT)
+          .addBinding(3, VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, VK_SHADER_STAGE_FRAGMENT_BIT)
+          .build();
+  // set 1 of the composite: lit color and depth
+  compositeSetLayout =
+      BurnhopeDescriptorSetLayout::Builder(lveDevice)
+          .addBinding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT)
+          .addBinding(1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT)
+          .build();
+  descriptorPool = BurnhopeDescriptorPool::Builder(lveDevice)
+                       .setMaxSets(2)
+                       .addPoolSize(VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, 4)
+                       .addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 2)
+                       .build();
+  writeDescriptorSets();
+
+  // set 0 is the global set, so the composite leaves it bound for the forward draws after it
+  lightingPipelineLayout =
+      createLayout(lveDevice, globalSetLayout, inputSetLayout->getDescriptorSetLayout());
+  compositePipelineLayout =
+      createLayout(lveDevice, globalSetLayout, compositeSetLayout->getDescriptorSetLayout());
+}
+
+void DeferredRenderSystem::writeDescriptorSets() {
+  auto inputInfos = gBuffer->getInputAttachmentInfos();
+  BurnhopeDescriptorWriter inputWriter{*inputSetLayout, *descriptorPool};
+  for (uint32_t binding = 0; binding < inputInfos.size(); binding++) {
+    inputWriter.writeImage(binding, &inputInfos[binding]);
+  }
+
+  auto litColorInfo = gBuffer->getLitColorInfo();
+  auto depthInfo = gBuffer->getDepthInfo();
+  BurnhopeDescriptorWriter compositeWriter{*compositeSetLayout, *descriptorPool};
+  compositeWriter.writeImage(0, &litColorInfo).writeImage(1, &depthInfo);
+
+  if (inputSet == VK_NULL_HANDLE) {
+    if (!inputWriter.build(inputSet) || !compositeWriter.build(compositeSet)) {
+      throw std::runtime_error("failed to allocate deferred descriptor sets!");
+    }
+  } else {
+    inputWriter.overwrite(inputSet);
+    compositeWriter.overwrite(compositeSet);
+  }
+}
+
+void DeferredRenderSystem::createPipelines(VkRenderPass swapChainRenderPass) {
+  assert(lightingPipelineLayout != nullptr && "Cannot create pipeline before pipeline layout");
+
+  // full-screen triangles, no vertex buffers and no culling
+  PipelineConfigInfo lightingConfig{};
+  BurnhopePipeline::defaultPipelineConfigInfo(lightingConfig);
+  lightingConfig.bindingDescriptions.clear();
+  lightingConfig.attributeDescriptions.clear();
+  lightingConfig.rasterizationInfo.cullMode = VK_CULL_MODE_NONE;
+  // the G-buffer depth is only read here, as an input attachment
+  lightingConfig.depthStencilInfo.depthTestEnable = VK_FALSE;
+  lightingConfig.depthStencilInfo.depthWriteEnable = VK_FALSE;
+  lightingConfig.renderPass = gBuffer->getRenderPass();
+  lightingConfig.subpass = BurnhopeGBuffer::LIGHTING_SUBPASS;
+  lightingConfig.pipelineLayout = lightingPipelineLayout;
+  lightingPipeline = std::make_unique<BurnhopePipeline>(
+      lveDevice,
+      "shaders/fullscreen.vert.spv",
+      "shaders/deferred_lighting.frag.spv",
+      lightingConfig);
+
+  // writes the scene depth along with the color, so later forward draws test against it
+  PipelineConfigInfo compositeConfig{};
+  BurnhopePipeline::defaultPipelineConfigInfo(compositeConfig);
+  compositeConfig.bindingDescriptions.clear();
+  compositeConfig.attributeDescriptions.clear();
+  compositeConfig.rasterizationInfo.cullMode = VK_CULL_MODE_NONE;
+  compositeConfig.depthStencilInfo.depthCompareOp = VK_COMPARE_OP_ALWAYS;
+  compositeConfig.renderPass = swapChainRenderPass;
+  compositeConfig.pipelineLayout = compositePipelineLayout;
+  compositePipeline = std::make_unique<BurnhopePipeline>(
+      lveDevice,
+      "shaders/fullscreen.vert.spv",
+      "shaders/deferred_composite.frag.spv",
+      compositeConfig);
+}
+
+void DeferredRenderSystem::resize(VkExtent2D extent) {
+  VkExtent2D current = gBuffer->getExtent();
+  if (current.width == extent.width && current.height == extent.height) {
+    return;
+  }
+  vkDeviceWaitIdle(lveDevice.device());
+  gBuffer->resize(extent);
+  writeDescriptorSets();
+}
+
+void DeferredRenderSystem::beginGeometryPass(FrameInfo &frameInfo) {
+  gBuffer->beginRenderPass(frameInfo.commandBuffer, CLEAR_COLOR);
+}
+
+void DeferredRenderSystem::renderLighting(FrameInfo &frameInfo) {
+  VkCommandBuffer commandBuffer = frameInfo.commandBuffer;
+  gBuffer->nextSubpass(commandBuffer);
+  lightingPipeline->bind(commandBuffer);
+  std::array<VkDescriptorSet, 2> descriptorSets{frameInfo.globalDescriptorSet, inputSet};
+  vkCmdBindDescriptorSets(
+      commandBuffer,
+      VK_PIPELINE_BIND_POINT_GRAPHICS,
+      lightingPipelineLayout,
+      0,
+      static_cast<uint32_t>(descriptorSets.size()),
+      descriptorSets.data(),
+      0,
+      nullptr);
+  vkCmdDraw(commandBuffer, 3, 1, 0, 0);
+  gBuffer->endRenderPass(commandBuffer);
+}
+
+void DeferredRenderSystem::submitComposite(
+    FrameInfo &frameInfo, BurnhopeRenderQueue &renderQueue) {
+  RenderPacket packet{};
+  packet.pipeline = compositePipeline.get();
+  packet.pipelineLayout = compositePipelineLayout;
+  packet.descriptorSets[0] = frameInfo.globalDescriptorSet;
+  packet.descriptorSets[1] = compositeSet;
+  packet.vertexCount = 3;
+  // opaque and nearest, ahead of the blended billboards
+  packet.sortKey = BurnhopeRenderQueue::makeOpaqueKey(
+      renderQueue.stateId(compositePipeline.get()),
+      0,
+      0,
+      0.f);
+  renderQueue.submit(packet);
+}
+
+}  // namespace burnhope
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "lve_descriptors.hpp"
+#include "lve_device.hpp"
+#include "lve_frame_info.hpp"
+#include "lve_gbuffer.hpp"
+#include "lve_pipeline.hpp"
+#include "lve_render_queue.hpp"
+
+// std
+#include <memory>
+
+namespace burnhope {
+
+// Deferred shading. SimpleRenderSystem fills the G-buffer in its geometry subpass, a full-screen
+// pass then shades each pixel once against its light cluster, and a composite draw copies the
+// lit color and depth into the swapchain pass for the draws that stay forward, like the light
+// billboards. The cost of lighting no longer grows with overdraw.
+class DeferredRenderSystem {
+ public:
+  DeferredRenderSystem(
+      BurnhopeDevice &device,
+      VkRenderPass swapChainRenderPass,
+      VkDescriptorSetLayout globalSetLayout,
+      VkExtent2D extent);
+  ~DeferredRenderSystem();
+
+  DeferredRenderSystem(const DeferredRenderSystem &) = delete;
+  DeferredRenderSystem &operator=(const DeferredRenderSystem &) = delete;
+
+  // for the geometry pipelines, the same handle for the life of the system
+  VkRenderPass getGeometryRenderPass() const { return gBuffer->getRenderPass(); }
+
+  // resizes the G-buffer when the render extent changed, waiting for the device first
+  void resize(VkExtent2D extent);
+
+  // Begins the G-buffer render pass, outside the swapchain pass. Geometry draws are recorded
+  // inline into frameInfo.commandBuffer.
+  void beginGeometryPass(FrameInfo &frameInfo);
+  // shades the G-buffer in the lighting subpass and ends the render pass
+  void renderLighting(FrameInfo &frameInfo);
+  // submits the full-screen draw that brings the lit image and its depth into the swapchain pass
+  void submitComposite(FrameInfo &frameInfo, BurnhopeRenderQueue &renderQueue);
+
+ private:
+  void createDescriptorSets(VkDescriptorSetLayout globalSetLayout);
+  void createPipelines(VkRenderPass swapChainRenderPass);
+  // points both sets at the current G-buffer
+  void writeDescriptorSets();
+
+  BurnhopeDevice &lveDevice;
+  std::unique_ptr<BurnhopeGBuffer> gBuffer;
+
+  std::unique_ptr<BurnhopeDescriptorSetLayout> inputSetLayout;
+  std::unique_ptr<BurnhopeDescriptorSetLayout> compositeSetLayout;
+  std::unique_ptr<BurnhopeDescriptorPool> descriptorPool;
+  // only rewritten after a device wait, so one of each serves every frame in flight
+  VkDescriptorSet inputSet = VK_NULL_HANDLE;
+  VkDescriptorSet compositeSet = VK_NULL_HANDLE;
+
+  VkPipelineLayout lightingPipelineLayout = VK_NULL_HANDLE;
+  VkPipelineLayout compositePipelineLayout = VK_NULL_HANDLE;
+  std::unique_ptr<BurnhopePipeline> lightingPipeline;
+  std::unique_ptr<BurnhopePipeline> compositePipeline;
+};
+
+}  // namespace burnhope
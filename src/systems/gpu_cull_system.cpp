@@ -0,0 +1,289 @@
+#include "gpu_cull_system.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+#include <stdexcept>
+
+namespace burnhope {
+
+namespace {
+
+constexpr uint32_t WORKGROUP_SIZE = 64;
+
+struct GpuCullPushConstants {
+  glm::vec4 frustumPlanes[6];
+  uint32_t objectCount;
+  uint32_t compact;
+};
+
+// grows by doubling so a slowly growing scene does not reallocate every frame
+std::unique_ptr<BurnhopeBuffer> ensureCapacity(
+    BurnhopeDevice &device,
+    std::unique_ptr<BurnhopeBuffer> buffer,
+    VkDeviceSize elementSize,
+    uint32_t required,
+    VkBufferUsageFlags usage,
+    MemoryUsage memoryUsage) {
+  required = std::max(required, 1u);
+  if (buffer != nullptr && buffer->getInstanceCount() >= required) {
+    return buffer;
+  }
+  uint32_t capacity = buffer != nullptr ? buffer->getInstanceCount() : 1024u;
+  while (capacity < required) {
+    capacity *= 2;
+  }
+  auto grown =
+      std::make_unique<BurnhopeBuffer>(device, elementSize, capacity, usage, memoryUsage);
+  if (memoryUsage == MemoryUsage::CpuToGpu) {
+    grown->map();
+  }
+  return grown;
+}
+
+}  // namespace
+
+GpuCullSystem::GpuCullSystem(BurnhopeDevice &device) : lveDevice{device} {
+  compacting = lveDevice.cmdDrawIndexedIndirectCount() != nullptr;
+  createPipelineLayout();
+  cullPipeline = std::make_unique<BurnhopeComputePipeline>(
+      lveDevice,
+      "shaders/gpu_cull.comp.spv",
+      pipelineLayout);
+  std::cout << "gpu culling: " << (compacting ? "compacted draw count" : "fixed count")
+            << " indirect draws" << std::endl;
+}
+
+GpuCullSystem::~GpuCullSystem() {
+  vkDestroyPipelineLayout(lveDevice.device(), pipelineLayout, nullptr);
+}
+
+bool GpuCullSystem::isSupported(BurnhopeDevice &device) {
+  return device.getEnabledFeatures().drawIndirectFirstInstance;
+}
+
+void GpuCullSystem::createPipelineLayout() {
+  // scene, cull inputs, draw commands, draw counts, instances
+  BurnhopeDescriptorSetLayout::Builder builder{lveDevice};
+  for (uint32_t binding = 0; binding < 5; binding++) {
+    builder.addBinding(binding, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT);
+  }
+  setLayout = builder.build();
+  descriptorPool = BurnhopeDescriptorPool::Builder(lveDevice)
+                       .setMaxSets(BurnhopeSwapChain::MAX_FRAMES_IN_FLIGHT)
+                       .addPoolSize(
+                           VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                           5 * BurnhopeSwapChain::MAX_FRAMES_IN_FLIGHT)
+                       .build();
+
+  VkPushConstantRange pushConstantRange{};
+  pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+  pushConstantRange.offset = 0;
+  pushConstantRange.size = sizeof(GpuCullPushConstants);
+
+  VkDescriptorSetLayout descriptorSetLayout = setLayout->getDescriptorSetLayout();
+  VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+  pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+  pipelineLayoutInfo.setLayoutCount = 1;
+  pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
+  pipelineLayoutInfo.pushConstantRangeCount = 1;
+  pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+  if (vkCreatePipelineLayout(lveDevice.device(), &pipelineLayoutInfo, nullptr, &pipelineLayout) !=
+      VK_SUCCESS) {
+    throw std::runtime_error("failed to create pipeline layout!");
+  }
+}
+
+void GpuCullSystem::rebuildBuckets(const BurnhopeComponentStore &components) {
+  // every object with a model, straight from the packed model array
+  struct Drawable {
+    const std::shared_ptr<BurnhopeModel> *model;
+    const std::shared_ptr<Material> *material;
+    BurnhopeGameObject::id_t entity;
+  };
+  std::vector<Drawable> drawable;
+  auto models = components.models.components();
+  auto entities = components.models.entities();
+  for (size_t i = 0; i < models.size(); i++) {
+    // indirect commands are indexed, every model loaded from a file has an index buffer
+    if (!models[i]->hasIndices()) continue;
+    drawable.push_back({&models[i], &components.materials.get(entities[i]), entities[i]});
+  }
+  std::sort(drawable.begin(), drawable.end(), [](const Drawable &a, const Drawable &b) {
+    if (*a.model != *b.model) return *a.model < *b.model;
+    return *a.material < *b.material;
+  });
+
+  buckets.clear();
+  cullInputs.clear();
+  for (const auto &obj : drawable) {
+    const auto &model = *obj.model;
+    const auto &material = *obj.material;
+    if (buckets.empty() || buckets.back().model != model || buckets.back().material != material) {
+      buckets.push_back({model, material, static_cast<uint32_t>(cullInputs.size()), 0});
+    }
+    auto &bucket = buckets.back();
+    CullInput input{};
+    input.sceneIndex = components.transforms.slotOf(obj.entity);
+    input.bucketIndex = static_cast<uint32_t>(buckets.size() - 1);
+    input.firstCommand = bucket.firstCommand;
+    input.commandIndex = static_cast<uint32_t>(cullInputs.size());
+    input.indexCount = model->getIndexCount();
+    cullInputs.push_back(input);
+    bucket.objectCount++;
+  }
+}
+
+void GpuCullSystem::uploadCullInputs(FrameResources &frame) {
+  // the frame's fence has been waited on, so its buffers can be replaced right away
+  const uint32_t objectCount = static_cast<uint32_t>(cullInputs.size());
+  auto grow = [&](std::unique_ptr<BurnhopeBuffer> &buffer,
+                  VkDeviceSize elementSize,
+                  uint32_t required,
+                  VkBufferUsageFlags usage,
+                  MemoryUsage memoryUsage) {
+    VkBuffer previous = buffer != nullptr ? buffer->getBuffer() : VK_NULL_HANDLE;
+    buffer =
+        ensureCapacity(lveDevice, std::move(buffer), elementSize, required, usage, memoryUsage);
+    frame.descriptorsDirty |= buffer->getBuffer() != previous;
+  };
+  grow(
+      frame.cullInputBuffer,
+      sizeof(CullInput),
+      objectCount,
+      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+      MemoryUsage::CpuToGpu);
+  grow(
+      frame.drawCommandBuffer,
+      sizeof(VkDrawIndexedIndirectCommand),
+      objectCount,
+      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+      MemoryUsage::GpuOnly);
+  grow(
+      frame.drawCountBuffer,
+      sizeof(uint32_t),
+      static_cast<uint32_t>(buckets.size()),
+      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT |
+          VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+      MemoryUsage::GpuOnly);
+  grow(
+      frame.instanceBuffer,
+      sizeof(uint32_t),
+      objectCount,
+      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+      MemoryUsage::GpuOnly);
+
+  if (!cullInputs.empty()) {
+    frame.cullInputBuffer->writeToBuffer(cullInputs.data(), cullInputs.size() * sizeof(CullInput));
+    frame.cullInputBuffer->flushDirtyRanges();
+  }
+}
+
+void GpuCullSystem::updateDescriptorSet(FrameResources &frame, const FrameInfo &frameInfo) {
+  // by version, a replaced scene buffer's handle can come back for a later one
+  if (!frame.descriptorsDirty && frame.sceneBufferVersion == frameInfo.sceneBufferVersion) {
+    return;
+  }
+
+  VkDescriptorBufferInfo sceneInfo = frameInfo.sceneBufferInfo;
+  VkDescriptorBufferInfo cullInputInfo = frame.cullInputBuffer->descriptorInfo();
+  VkDescriptorBufferInfo drawCommandInfo = frame.drawCommandBuffer->descriptorInfo();
+  VkDescriptorBufferInfo drawCountInfo = frame.drawCountBuffer->descriptorInfo();
+  VkDescriptorBufferInfo instanceInfo = frame.instanceBuffer->descriptorInfo();
+  BurnhopeDescriptorWriter writer{*setLayout, *descriptorPool};
+  writer.writeBuffer(0, &sceneInfo)
+      .writeBuffer(1, &cullInputInfo)
+      .writeBuffer(2, &drawCommandInfo)
+      .writeBuffer(3, &drawCountInfo)
+      .writeBuffer(4, &instanceInfo);
+  if (frame.descriptorSet == VK_NULL_HANDLE) {
+    if (!writer.build(frame.descriptorSet)) {
+      throw std::runtime_error("failed to allocate gpu cull descriptor set!");
+    }
+  } else {
+    writer.overwrite(frame.descriptorSet);
+  }
+  frame.sceneBufferVersion = frameInfo.sceneBufferVersion;
+  frame.descriptorsDirty = false;
+}
+
+void GpuCullSystem::cull(FrameInfo &frameInfo, uint64_t structureVersion) {
+  if (bucketsVersion != structureVersion) {
+    rebuildBuckets(frameInfo.components);
+    bucketsVersion = structureVersion;
+  }
+  auto &frame = frames[frameInfo.frameIndex];
+  if (frame.structureVersion != structureVersion) {
+    uploadCullInputs(frame);
+    frame.structureVersion = structureVersion;
+  }
+  updateDescriptorSet(frame, frameInfo);
+  if (cullInputs.empty()) return;
+
+  VkCommandBuffer commandBuffer = frameInfo.commandBuffer;
+  if (compacting) {
+    vkCmdFillBuffer(commandBuffer, frame.drawCountBuffer->getBuffer(), 0, VK_WHOLE_SIZE, 0);
+
+    VkMemoryBarrier clearBarrier{};
+    clearBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    clearBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    clearBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    vkCmdPipelineBarrier(
+        commandBuffer,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        0,
+        1,
+        &clearBarrier,
+        0,
+        nullptr,
+        0,
+        nullptr);
+  }
+
+  cullPipeline->bind(commandBuffer);
+  vkCmdBindDescriptorSets(
+      commandBuffer,
+      VK_PIPELINE_BIND_POINT_COMPUTE,
+      pipelineLayout,
+      0,
+      1,
+      &frame.descriptorSet,
+      0,
+      nullptr);
+
+  GpuCullPushConstants push{};
+  auto planes = frameInfo.camera.getFrustumPlanes();
+  std::copy(planes.begin(), planes.end(), push.frustumPlanes);
+  push.objectCount = static_cast<uint32_t>(cullInputs.size());
+  push.compact = compacting ? 1 : 0;
+  vkCmdPushConstants(
+      commandBuffer,
+      pipelineLayout,
+      VK_SHADER_STAGE_COMPUTE_BIT,
+      0,
+      sizeof(GpuCullPushConstants),
+      &push);
+  vkCmdDispatch(commandBuffer, (push.objectCount + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, 1, 1);
+
+  // the draws read the commands and counts as indirect parameters and the instances in the
+  // vertex shader
+  VkMemoryBarrier cullBarrier{};
+  cullBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  cullBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+  cullBarrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+  vkCmdPipelineBarrier(
+      commandBuffer,
+      VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+      VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT,
+      0,
+      1,
+      &cullBarrier,
+      0,
+      nullptr,
+      0,
+      nullptr);
+}
+
+}  // namespace burnhope
@@ -0,0 +1,97 @@
+#pragma once
+
+#include "lve_buffer.hpp"
+#include "lve_descriptors.hpp"
+#include "lve_device.hpp"
+#include "lve_frame_info.hpp"
+#include "lve_game_object.hpp"
+#include "lve_pipeline.hpp"
+
+// std
+#include <array>
+#include <memory>
+#include <vector>
+
+namespace burnhope {
+
+// GPU driven draw list. A compute pass frustum culls every object against the camera and writes
+// the survivors' VkDrawIndexedIndirectCommands, grouped into one bucket per (model, material).
+// The CPU only touches the object list when its structure changes.
+class GpuCullSystem {
+ public:
+  struct DrawBucket {
+    std::shared_ptr<BurnhopeModel> model;
+    std::shared_ptr<Material> material;
+    uint32_t firstCommand;
+    uint32_t objectCount;
+  };
+
+  explicit GpuCullSystem(BurnhopeDevice &device);
+  ~GpuCullSystem();
+
+  GpuCullSystem(const GpuCullSystem &) = delete;
+  GpuCullSystem &operator=(const GpuCullSystem &) = delete;
+
+  // commands select their instance through firstInstance, which needs drawIndirectFirstInstance
+  static bool isSupported(BurnhopeDevice &device);
+
+  // Records the cull dispatch. Must be called outside a render pass, after the scene buffer of
+  // this frame has been updated.
+  void cull(FrameInfo &frameInfo, uint64_t structureVersion);
+
+  // With VK_KHR_draw_indirect_count the survivors are packed to the front of their bucket and
+  // drawn with vkCmdDrawIndexedIndirectCountKHR. Otherwise every object keeps its own command
+  // and culled ones get instanceCount = 0.
+  bool isCompacting() const { return compacting; }
+  const std::vector<DrawBucket> &getBuckets() const { return buckets; }
+  VkBuffer getDrawCommandBuffer(int frameIndex) const {
+    return frames[frameIndex].drawCommandBuffer->getBuffer();
+  }
+  VkBuffer getDrawCountBuffer(int frameIndex) const {
+    return frames[frameIndex].drawCountBuffer->getBuffer();
+  }
+  VkDescriptorBufferInfo getInstanceBufferInfo(int frameIndex) const {
+    return frames[frameIndex].instanceBuffer->descriptorInfo();
+  }
+
+ private:
+  // matches CullInput in gpu_cull.comp
+  struct CullInput {
+    uint32_t sceneIndex;
+    uint32_t bucketIndex;
+    uint32_t firstCommand;
+    uint32_t commandIndex;
+    uint32_t indexCount;
+  };
+
+  struct FrameResources {
+    std::unique_ptr<BurnhopeBuffer> cullInputBuffer;
+    std::unique_ptr<BurnhopeBuffer> drawCommandBuffer;
+    std::unique_ptr<BurnhopeBuffer> drawCountBuffer;
+    std::unique_ptr<BurnhopeBuffer> instanceBuffer;
+    VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+    uint64_t sceneBufferVersion = 0;
+    uint64_t structureVersion = ~0ull;
+    bool descriptorsDirty = true;
+  };
+
+  void createPipelineLayout();
+  void rebuildBuckets(const BurnhopeComponentStore &components);
+  void uploadCullInputs(FrameResources &frame);
+  void updateDescriptorSet(FrameResources &frame, const FrameInfo &frameInfo);
+
+  BurnhopeDevice &lveDevice;
+
+  std::unique_ptr<BurnhopeComputePipeline> cullPipeline;
+  VkPipelineLayout pipelineLayout;
+  std::unique_ptr<BurnhopeDescriptorSetLayout> setLayout;
+  std::unique_ptr<BurnhopeDescriptorPool> descriptorPool;
+  bool compacting = false;
+
+  std::vector<DrawBucket> buckets;
+  std::vector<CullInput> cullInputs;
+  uint64_t bucketsVersion = ~0ull;
+  std::array<FrameResources, BurnhopeSwapChain::MAX_FRAMES_IN_FLIGHT> frames;
+};
+
+}  // namespace burnhope
@@ -0,0 +1,212 @@
+#include "light_cluster_system.hpp"
+
+// std
+#include <cassert>
+#include <cmath>
+#include <stdexcept>
+
+namespace burnhope {
+
+namespace {
+
+constexpr uint32_t WORKGROUP_SIZE = 64;
+// the cluster buffer starts with a uvec4 of stats, see light_cluster.comp
+constexpr uint32_t STATS_WORDS = 4;
+
+}  // namespace
+
+LightClusterSystem::LightClusterSystem(
+    BurnhopeDevice &device, VkDescriptorSetLayout globalSetLayout)
+    : lveDevice{device} {
+  createPipelineLayout(globalSetLayout);
+  assignPipeline = std::make_unique<BurnhopeComputePipeline>(
+      lveDevice,
+      "shaders/light_cluster.comp.spv",
+      pipelineLayout);
+
+  // fixed capacity, so the global descriptor sets are written once
+  for (auto &frame : frames) {
+    frame.lightBuffer = std::make_unique<BurnhopeBuffer>(
+        lveDevice,
+        sizeof(PointLight),
+        MAX_LIGHTS,
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+        MemoryUsage::CpuToGpu);
+    frame.lightBuffer->map();
+    frame.clusterBuffer = std::make_unique<BurnhopeBuffer>(
+        lveDevice,
+        sizeof(uint32_t),
+        STATS_WORDS + CLUSTER_COUNT,
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT |
+            VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        MemoryUsage::GpuOnly);
+    frame.lightIndexBuffer = std::make_unique<BurnhopeBuffer>(
+        lveDevice,
+        sizeof(uint32_t),
+        CLUSTER_COUNT * MAX_LIGHTS_PER_CLUSTER,
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+        MemoryUsage::GpuOnly);
+    frame.statsReadback = std::make_unique<BurnhopeBuffer>(
+        lveDevice,
+        sizeof(uint32_t),
+        STATS_WORDS,
+        VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        MemoryUsage::GpuToCpu);
+    frame.statsReadback->map();
+  }
+}
+
+LightClusterSystem::~LightClusterSystem() {
+  vkDestroyPipelineLayout(lveDevice.device(), pipelineLayout, nullptr);
+}
+
+void LightClusterSystem::createPipelineLayout(VkDescriptorSetLayout globalSetLayout) {
+  VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+  pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+  pipelineLayoutInfo.setLayoutCount = 1;
+  pipelineLayoutInfo.pSetLayouts = &globalSetLayout;
+  pipelineLayoutInfo.pushConstantRangeCount = 0;
+  pipelineLayoutInfo.pPushConstantRanges = nullptr;
+  if (vkCreatePipelineLayout(lveDevice.device(), &pipelineLayoutInfo, nullptr, &pipelineLayout) !=
+      VK_SUCCESS) {
+    throw std::runtime_error("failed to create pipeline layout!");
+  }
+}
+
+VkDescriptorBufferInfo LightClusterSystem::getLightBufferInfo(int frameIndex) const {
+  return frames[frameIndex].lightBuffer->descriptorInfo();
+}
+
+VkDescriptorBufferInfo LightClusterSystem::getClusterBufferInfo(int frameIndex) const {
+  return frames[frameIndex].clusterBuffer->descriptorInfo();
+}
+
+VkDescriptorBufferInfo LightClusterSystem::getLightIndexBufferInfo(int frameIndex) const {
+  return frames[frameIndex].lightIndexBuffer->descriptorInfo();
+}
+
+void LightClusterSystem::updateUbo(
+    const BurnhopeCamera &camera, VkExtent2D extent, GlobalUbo &ubo) {
+  // slice = floor(log(viewDepth / near) / log(far / near) * CLUSTERS_Z), folded into a scale and
+  // bias on log(viewDepth) so the fragment shader does one log and one fma
+  float nearClip = camera.getNearClip();
+  float farClip = camera.getFarClip();
+  assert(nearClip > 0.f && farClip > nearClip && "clusters need a perspective projection");
+  float sliceScale = CLUSTERS_Z / std::log(farClip / nearClip);
+  ubo.clusterDepth = glm::vec4{nearClip, farClip, sliceScale, -std::log(nearClip) * sliceScale};
+  ubo.screenSize = glm::vec2{static_cast<float>(extent.width), static_cast<float>(extent.height)};
+}
+
+void LightClusterSystem::update(FrameInfo &frameInfo, std::vector<PointLight> &lights) {
+  auto &frame = frames[frameInfo.frameIndex];
+  if (frame.statsPending) {
+    // the frame's fence has signaled, so the copy has landed
+    frame.statsReadback->invalidate();
+    const auto *words = static_cast<const uint32_t *>(frame.statsReadback->getMappedMemory());
+    Stats frameStats{};
+    frameStats.frames = 1;
+    frameStats.assignedLights = words[0];
+    frameStats.maxLightsPerCluster = words[1];
+    frameStats.overflowedClusters = words[2];
+    frameStats.occupiedClusters = words[3];
+    stats += frameStats;
+    frame.statsPending = false;
+  }
+
+  assert(lights.size() <= MAX_LIGHTS && "Point lights exceed maximum specified");
+  if (!lights.empty()) {
+    frame.lightBuffer->writeToBuffer(lights.data(), lights.size() * sizeof(PointLight));
+    frame.lightBuffer->flushDirtyRanges();
+  }
+}
+
+void LightClusterSystem::assignLights(FrameInfo &frameInfo) {
+  auto &frame = frames[frameInfo.frameIndex];
+  VkCommandBuffer commandBuffer = frameInfo.commandBuffer;
+
+  // the stats header is accumulated with atomics
+  vkCmdFillBuffer(
+      commandBuffer,
+      frame.clusterBuffer->getBuffer(),
+      0,
+      STATS_WORDS * sizeof(uint32_t),
+      0);
+  VkMemoryBarrier clearBarrier{};
+  clearBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  clearBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  clearBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+  vkCmdPipelineBarrier(
+      commandBuffer,
+      VK_PIPELINE_STAGE_TRANSFER_BIT,
+      VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+      0,
+      1,
+      &clearBarrier,
+      0,
+      nullptr,
+      0,
+      nullptr);
+
+  assignPipeline->bind(commandBuffer);
+  vkCmdBindDescriptorSets(
+      commandBuffer,
+      VK_PIPELINE_BIND_POINT_COMPUTE,
+      pipelineLayout,
+      0,
+      1,
+      &frameInfo.globalDescriptorSet,
+      0,
+      nullptr);
+  vkCmdDispatch(commandBuffer, (CLUSTER_COUNT + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, 1, 1);
+
+  // fragments read the lists, and the stats header is copied out for the debug readout
+  VkMemoryBarrier assignBarrier{};
+  assignBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  assignBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+  assignBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT;
+  vkCmdPipelineBarrier(
+      commandBuffer,
+      VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+      VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+      0,
+      1,
+      &assignBarrier,
+      0,
+      nullptr,
+      0,
+      nullptr);
+
+  VkBufferCopy copyRegion{};
+  copyRegion.size = STATS_WORDS * sizeof(uint32_t);
+  vkCmdCopyBuffer(
+      commandBuffer,
+      frame.clusterBuffer->getBuffer(),
+      frame.statsReadback->getBuffer(),
+      1,
+      &copyRegion);
+
+  VkMemoryBarrier readbackBarrier{};
+  readbackBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  readbackBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  readbackBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+  vkCmdPipelineBarrier(
+      commandBuffer,
+      VK_PIPELINE_STAGE_TRANSFER_BIT,
+      VK_PIPELINE_STAGE_HOST_BIT,
+      0,
+      1,
+      &readbackBarrier,
+      0,
+      nullptr,
+      0,
+      nullptr);
+  frame.statsPending = true;
+}
+
+LightClusterSystem::Stats LightClusterSystem::takeStats() {
+  Stats taken = stats;
+  stats = {};
+  return taken;
+}
+
+}  // namespace burnhope
@@ -0,0 +1,98 @@
+#pragma once
+
+#include "lve_buffer.hpp"
+#include "lve_camera.hpp"
+#include "lve_device.hpp"
+#include "lve_frame_info.hpp"
+#include "lve_pipeline.hpp"
+#include "lve_swap_chain.hpp"
+
+// std
+#include <algorithm>
+#include <array>
+#include <memory>
+#include <vector>
+
+namespace burnhope {
+
+// Clustered forward lighting. The view frustum is split into a froxel grid, tiles in screen space
+// and exponential slices in view depth, and a compute pass collects the lights overlapping every
+// froxel. Fragments then shade only their froxel's list, so the per-fragment cost is bounded by
+// MAX_LIGHTS_PER_CLUSTER no matter how many lights the scene has.
+class LightClusterSystem {
+ public:
+  // must match the constants in light_cluster.comp, simple_shader.frag and deferred_lighting.frag
+  static constexpr uint32_t CLUSTERS_X = 16;
+  static constexpr uint32_t CLUSTERS_Y = 9;
+  static constexpr uint32_t CLUSTERS_Z = 24;
+  static constexpr uint32_t CLUSTER_COUNT = CLUSTERS_X * CLUSTERS_Y * CLUSTERS_Z;
+  static constexpr uint32_t MAX_LIGHTS_PER_CLUSTER = 128;
+
+  struct Stats {
+    uint32_t frames = 0;
+    uint64_t assignedLights = 0;     // list entries over all clusters
+    uint64_t occupiedClusters = 0;   // clusters with at least one light
+    uint32_t maxLightsPerCluster = 0;  // before truncating to MAX_LIGHTS_PER_CLUSTER
+    uint32_t overflowedClusters = 0;   // clusters that dropped lights
+
+    float averagePerOccupiedCluster() const {
+      return occupiedClusters > 0 ? static_cast<float>(assignedLights) / occupiedClusters : 0.f;
+    }
+
+    Stats &operator+=(const Stats &other) {
+      frames += other.frames;
+      assignedLights += other.assignedLights;
+      occupiedClusters += other.occupiedClusters;
+      maxLightsPerCluster = std::max(maxLightsPerCluster, other.maxLightsPerCluster);
+      overflowedClusters += other.overflowedClusters;
+      return *this;
+    }
+  };
+
+  // globalSetLayout must have the light, cluster and light index buffers at bindings 1 to 3,
+  // visible to the compute and fragment stages
+  LightClusterSystem(BurnhopeDevice &device, VkDescriptorSetLayout globalSetLayout);
+  ~LightClusterSystem();
+
+  LightClusterSystem(const LightClusterSystem &) = delete;
+  LightClusterSystem &operator=(const LightClusterSystem &) = delete;
+
+  // buffers to write into each frame's global descriptor set
+  VkDescriptorBufferInfo getLightBufferInfo(int frameIndex) const;
+  VkDescriptorBufferInfo getClusterBufferInfo(int frameIndex) const;
+  VkDescriptorBufferInfo getLightIndexBufferInfo(int frameIndex) const;
+
+  // fills the froxel grid mapping of the ubo for the camera's projection and the render size
+  static void updateUbo(const BurnhopeCamera &camera, VkExtent2D extent, GlobalUbo &ubo);
+
+  // Collects the stats the frame wrote last time and uploads its lights. Call after the frame's
+  // fence has been waited on.
+  void update(FrameInfo &frameInfo, std::vector<PointLight> &lights);
+  // Records the light assignment. Must be called outside a render pass, after this frame's ubo
+  // and lights have been written.
+  void assignLights(FrameInfo &frameInfo);
+
+  // returns the cluster stats read back since the last call and resets them
+  Stats takeStats();
+
+ private:
+  struct FrameResources {
+    std::unique_ptr<BurnhopeBuffer> lightBuffer;
+    std::unique_ptr<BurnhopeBuffer> clusterBuffer;
+    std::unique_ptr<BurnhopeBuffer> lightIndexBuffer;
+    // copy of the cluster buffer's stats header
+    std::unique_ptr<BurnhopeBuffer> statsReadback;
+    bool statsPending = false;
+  };
+
+  void createPipelineLayout(VkDescriptorSetLayout globalSetLayout);
+
+  BurnhopeDevice &lveDevice;
+
+  std::unique_ptr<BurnhopeComputePipeline> assignPipeline;
+  VkPipelineLayout pipelineLayout;
+  std::array<FrameResources, BurnhopeSwapChain::MAX_FRAMES_IN_FLIGHT> frames;
+  Stats stats{};
+};
+
+}  // namespace burnhope
@@ -7,18 +7,21 @@
 #include <glm/gtc/constants.hpp>
 
 // std
+#include <algorithm>
 #include <array>
 #include <cassert>
-#include <map>
+#include <cmath>
 #include <stdexcept>
 
 namespace burnhope {
 
-struct PointLightPushConstants {
-  glm::vec4 position{};
-  glm::vec4 color{};
-  float radius;
-};
+namespace {
+
+// radiance below which a light is cut off, sets the range lights are clustered with
+constexpr float MIN_LIGHT_RADIANCE = .01f;
+constexpr uint32_t INITIAL_BILLBOARD_CAPACITY = 1024;
+
+}  // namespace
 
 PointLightSystem::PointLightSystem(
     BurnhopeDevice& device, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout)
@@ -32,19 +35,28 @@ PointLightSystem::~PointLightSystem() {
 }
 
 void PointLightSystem::createPipelineLayout(VkDescriptorSetLayout globalSetLayout) {
-  VkPushConstantRange pushConstantRange{};
-  pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
-  pushConstantRange.offset = 0;
-  pushConstantRange.size = sizeof(PointLightPushConstants);
-
-  std::vector<VkDescriptorSetLayout> descriptorSetLayouts{globalSetLayout};
+  // set 1: the frame's sorted billboards, looked up with gl_InstanceIndex
+  billboardSetLayout =
+      BurnhopeDescriptorSetLayout::Builder(lveDevice)
+          .addBinding(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT)
+          .build();
+  descriptorPool = BurnhopeDescriptorPool::Builder(lveDevice)
+                       .setMaxSets(BurnhopeSwapChain::MAX_FRAMES_IN_FLIGHT)
+                       .addPoolSize(
+                           VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                           BurnhopeSwapChain::MAX_FRAMES_IN_FLIGHT)
+                       .build();
+
+  std::vector<VkDescriptorSetLayout> descriptorSetLayouts{
+      globalSetLayout,
+      billboardSetLayout->getDescriptorSetLayout()};
 
   VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
   pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
   pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(descriptorSetLayouts.size());
   pipelineLayoutInfo.pSetLayouts = descriptorSetLayouts.data();
-  pipelineLayoutInfo.pushConstantRangeCount = 1;
-  pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+  pipelineLayoutInfo.pushConstantRangeCount = 0;
+  pipelineLayoutInfo.pPushConstantRanges = nullptr;
   if (vkCreatePipelineLayout(lveDevice.device(), &pipelineLayoutInfo, nullptr, &pipelineLayout) !=
       VK_SUCCESS) {
     throw std::runtime_error("failed to create pipeline layout!");
@@ -73,71 +85,130 @@ void PointLightSystem::createPipeline(VkRenderPass renderPass) {
       pipelineConfig);
 }
 
-void PointLightSystem::update(FrameInfo& frameInfo, GlobalUbo& ubo) {
+void PointLightSystem::update(
+    FrameInfo& frameInfo, GlobalUbo& ubo, std::vector<PointLight>& lights) {
   auto rotateLight = glm::rotate(glm::mat4(1.f), 0.5f * frameInfo.frameTime, {0.f, -1.f, 0.f});
-  int lightIndex = 0;
-  for (auto& kv : frameInfo.gameObjects) {
-    auto& obj = kv.second;
-    if (obj.pointLight == nullptr) continue;
-
-    assert(lightIndex < MAX_LIGHTS && "Point lights exceed maximum specified");
+  lights.clear();
+  billboardBounds.clear();
+  billboardColors.clear();
+  // only the objects that are lights, from the packed light array
+  auto pointLights = frameInfo.components.pointLights.components();
+  auto entities = frameInfo.components.pointLights.entities();
+  for (size_t i = 0; i < pointLights.size(); i++) {
+    const PointLightComponent& pointLight = pointLights[i];
+    auto& transform = frameInfo.components.transforms.get(entities[i]);
 
     // update light position
-    obj.transform.translation = glm::vec3(rotateLight * glm::vec4(obj.transform.translation, 1.f));
-
-    // copy light to ubo
-    ubo.pointLights[lightIndex].position = glm::vec4(obj.transform.translation, 1.f);
-    ubo.pointLights[lightIndex].color = glm::vec4(obj.color, obj.pointLight->lightIntensity);
-
-    lightIndex += 1;
+    transform.translation = glm::vec3(rotateLight * glm::vec4(transform.translation, 1.f));
+    float intensity = pointLight.lightIntensity;
+    billboardBounds.push_back(glm::vec4(transform.translation, transform.scale.x));
+    billboardColors.push_back(glm::vec4(pointLight.color, intensity));
+
+    // every light gets a billboard, but only the first MAX_LIGHTS are shaded
+    if (lights.size() == MAX_LIGHTS) continue;
+
+    // intensity / distance^2 reaches MIN_LIGHT_RADIANCE at the range
+    float range = std::sqrt(intensity / MIN_LIGHT_RADIANCE);
+    PointLight light{};
+    light.position = glm::vec4(transform.translation, range);
+    light.color = glm::vec4(pointLight.color, intensity);
+    lights.push_back(light);
   }
-  ubo.numLights = lightIndex;
+  ubo.numLights = static_cast<int>(lights.size());
 }
 
-void PointLightSystem::render(FrameInfo& frameInfo) {
-  // sort lights
-  std::map<float, BurnhopeGameObject::id_t> sorted;
-  for (auto& kv : frameInfo.gameObjects) {
-    auto& obj = kv.second;
-    if (obj.pointLight == nullptr) continue;
-
-    // calculate distance
-    auto offset = frameInfo.camera.getPosition() - obj.transform.translation;
-    float disSquared = glm::dot(offset, offset);
-    sorted[disSquared] = obj.getId();
+void PointLightSystem::render(FrameInfo& frameInfo, BurnhopeRenderQueue& renderQueue) {
+  visibleIndices.clear();
+  BurnhopeFrustumCuller::cull(
+      billboardBounds,
+      frameInfo.camera.getFrustumPlanes(),
+      visibleIndices);
+  billboardStats.lights += static_cast<uint32_t>(billboardBounds.size());
+  billboardStats.culled += static_cast<uint32_t>(billboardBounds.size() - visibleIndices.size());
+  if (visibleIndices.empty()) return;
+
+  // back-to-front by view depth. Blended keys of the same pipeline, material and mesh differ
+  // only in their inverted depth bits, so the radix sort skips every other digit.
+  const glm::mat4& view = frameInfo.camera.getView();
+  const glm::vec4 depthRow{view[0][2], view[1][2], view[2][2], view[3][2]};
+  float farthest = 0.f;
+  depthKeys.resize(visibleIndices.size());
+  for (size_t i = 0; i < visibleIndices.size(); i++) {
+    uint32_t index = visibleIndices[i];
+    float depth = depthRow.x * billboardBounds.centerX[index] +
+                  depthRow.y * billboardBounds.centerY[index] +
+                  depthRow.z * billboardBounds.centerZ[index] + depthRow.w;
+    farthest = std::max(farthest, depth);
+    depthKeys[i] = BurnhopeRenderQueue::makeBlendedKey(0, 0, 0, depth);
   }
+  BurnhopeRenderQueue::radixSort(depthKeys, sortedOrder, sortScratch);
+
+  billboards.resize(visibleIndices.size());
+  for (size_t i = 0; i < sortedOrder.size(); i++) {
+    uint32_t index = visibleIndices[sortedOrder[i]];
+    billboards[i].position = glm::vec4{
+        billboardBounds.centerX[index],
+        billboardBounds.centerY[index],
+        billboardBounds.centerZ[index],
+        billboardBounds.radius[index]};
+    billboards[i].color = billboardColors[index];
+  }
+  uploadBillboards(frameInfo.frameIndex);
+
+  RenderPacket packet{};
+  packet.pipeline = lvePipeline.get();
+  packet.pipelineLayout = pipelineLayout;
+  packet.descriptorSets[0] = frameInfo.globalDescriptorSet;
+  packet.descriptorSets[1] = billboardSets[frameInfo.frameIndex].descriptorSet;
+  packet.vertexCount = 6;
+  packet.instanceCount = static_cast<uint32_t>(billboards.size());
+  // the whole batch sorts against other blended draws by its farthest light
+  packet.sortKey =
+      BurnhopeRenderQueue::makeBlendedKey(renderQueue.stateId(lvePipeline.get()), 0, 0, farthest);
+  renderQueue.submit(packet);
+  billboardStats.draws++;
+}
 
-  lvePipeline->bind(frameInfo.commandBuffer);
-
-  vkCmdBindDescriptorSets(
-      frameInfo.commandBuffer,
-      VK_PIPELINE_BIND_POINT_GRAPHICS,
-      pipelineLayout,
-      0,
-      1,
-      &frameInfo.globalDescriptorSet,
-      0,
-      nullptr);
-
-  // iterate through sorted lights in reverse order
-  for (auto it = sorted.rbegin(); it != sorted.rend(); ++it) {
-    // use game obj id to find light object
-    auto& obj = frameInfo.gameObjects.at(it->second);
-
-    PointLightPushConstants push{};
-    push.position = glm::vec4(obj.transform.translation, 1.f);
-    push.color = glm::vec4(obj.color, obj.pointLight->lightIntensity);
-    push.radius = obj.transform.scale.x;
-
-    vkCmdPushConstants(
-        frameInfo.commandBuffer,
-        pipelineLayout,
-        VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
-        0,
-        sizeof(PointLightPushConstants),
-        &push);
-    vkCmdDraw(frameInfo.commandBuffer, 6, 1, 0, 0);
+void PointLightSystem::uploadBillboards(int frameIndex) {
+  // the frame's fence has been waited on, so its previous buffer can be replaced
+  auto& buffer = billboardBuffers[frameIndex];
+  auto& billboardSet = billboardSets[frameIndex];
+  uint32_t required = static_cast<uint32_t>(billboards.size());
+  if (buffer == nullptr || buffer->getInstanceCount() < required) {
+    uint32_t capacity =
+        buffer == nullptr ? INITIAL_BILLBOARD_CAPACITY : buffer->getInstanceCount();
+    while (capacity < required) {
+      capacity *= 2;
+    }
+    buffer = std::make_unique<BurnhopeBuffer>(
+        lveDevice,
+        sizeof(LightBillboard),
+        capacity,
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+        MemoryUsage::CpuToGpu);
+    buffer->map();
+  }
+  buffer->writeToBuffer(billboards.data(), billboards.size() * sizeof(LightBillboard));
+  buffer->flushDirtyRanges();
+
+  if (billboardSet.buffer == buffer->getBuffer()) return;
+  auto bufferInfo = buffer->descriptorInfo();
+  BurnhopeDescriptorWriter writer{*billboardSetLayout, *descriptorPool};
+  writer.writeBuffer(0, &bufferInfo);
+  if (billboardSet.descriptorSet == VK_NULL_HANDLE) {
+    if (!writer.build(billboardSet.descriptorSet)) {
+      throw std::runtime_error("failed to allocate light billboard descriptor set!");
+    }
+  } else {
+    writer.overwrite(billboardSet.descriptorSet);
   }
+  billboardSet.buffer = buffer->getBuffer();
+}
+
+PointLightSystem::BillboardStats PointLightSystem::takeBillboardStats() {
+  BillboardStats taken = billboardStats;
+  billboardStats = {};
+  return taken;
 }
 
 }  // namespace burnhope
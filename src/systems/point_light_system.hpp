@@ -1,18 +1,36 @@
 #pragma once
 
+#include "lve_buffer.hpp"
 #include "lve_camera.hpp"
+#include "lve_descriptors.hpp"
 #include "lve_device.hpp"
 #include "lve_frame_info.hpp"
+#include "lve_frustum_culler.hpp"
 #include "lve_game_object.hpp"
 #include "lve_pipeline.hpp"
+#include "lve_render_queue.hpp"
 
 // std
+#include <array>
 #include <memory>
 #include <vector>
 
 namespace burnhope {
 class PointLightSystem {
  public:
+  struct BillboardStats {
+    uint32_t lights = 0;
+    uint32_t culled = 0;  // outside the view frustum
+    uint32_t draws = 0;
+
+    BillboardStats &operator+=(const BillboardStats &other) {
+      lights += other.lights;
+      culled += other.culled;
+      draws += other.draws;
+      return *this;
+    }
+  };
+
   PointLightSystem(
       BurnhopeDevice &device, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout);
   ~PointLightSystem();
@@ -20,16 +38,50 @@ class PointLightSystem {
   PointLightSystem(const PointLightSystem &) = delete;
   PointLightSystem &operator=(const PointLightSystem &) = delete;
 
-  void update(FrameInfo &frameInfo, GlobalUbo &ubo);
-  void render(FrameInfo &frameInfo);
+  // animates the lights and gathers them for the light cluster system
+  void update(FrameInfo &frameInfo, GlobalUbo &ubo, std::vector<PointLight> &lights);
+  // Frustum culls the billboards gathered by update, radix sorts the visible ones back-to-front
+  // into this frame's billboard buffer and submits them as one instanced draw.
+  void render(FrameInfo &frameInfo, BurnhopeRenderQueue &renderQueue);
+
+  // returns the billboard counters accumulated since the last call and resets them
+  BillboardStats takeBillboardStats();
 
  private:
+  // matches LightBillboard in point_light.vert
+  struct LightBillboard {
+    glm::vec4 position;  // w is the billboard radius
+    glm::vec4 color;     // w is intensity
+  };
+
+  struct BillboardSet {
+    VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+    VkBuffer buffer = VK_NULL_HANDLE;
+  };
+
   void createPipelineLayout(VkDescriptorSetLayout globalSetLayout);
   void createPipeline(VkRenderPass renderPass);
+  // grows the frame's billboard buffer if needed and rewrites its set when the buffer changed
+  void uploadBillboards(int frameIndex);
 
   BurnhopeDevice &lveDevice;
 
   std::unique_ptr<BurnhopePipeline> lvePipeline;
   VkPipelineLayout pipelineLayout;
+  std::unique_ptr<BurnhopeDescriptorSetLayout> billboardSetLayout;
+  std::unique_ptr<BurnhopeDescriptorPool> descriptorPool;
+  std::array<std::unique_ptr<BurnhopeBuffer>, BurnhopeSwapChain::MAX_FRAMES_IN_FLIGHT>
+      billboardBuffers;
+  std::array<BillboardSet, BurnhopeSwapChain::MAX_FRAMES_IN_FLIGHT> billboardSets{};
+
+  // every light of the frame, gathered by update
+  BoundingSphereArray billboardBounds;
+  std::vector<glm::vec4> billboardColors;
+  std::vector<uint32_t> visibleIndices;
+  std::vector<uint64_t> depthKeys;
+  std::vector<uint32_t> sortedOrder;
+  std::vector<uint32_t> sortScratch;
+  std::vector<LightBillboard> billboards;
+  BillboardStats billboardStats{};
 };
 }  // namespace burnhope
@@ -0,0 +1,456 @@
+#include "shadow_system.hpp"
+
+#include "lve_utils.hpp"
+
+// libs
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+namespace burnhope {
+
+namespace {
+
+constexpr uint32_t INITIAL_INSTANCE_CAPACITY = 1024;
+constexpr float POINT_SHADOW_NEAR = .05f;
+
+// cube faces in the order simple_shader.frag picks them by major axis: +x, -x, +y, -y, +z, -z
+const std::array<glm::vec3, ShadowSystem::CUBE_FACES> FACE_DIRECTIONS{
+    glm::vec3{1.f, 0.f, 0.f},
+    glm::vec3{-1.f, 0.f, 0.f},
+    glm::vec3{0.f, 1.f, 0.f},
+    glm::vec3{0.f, -1.f, 0.f},
+    glm::vec3{0.f, 0.f, 1.f},
+    glm::vec3{0.f, 0.f, -1.f}};
+
+struct ShadowPushConstants {
+  glm::mat4 lightViewProjection{1.f};
+};
+
+uint32_t nextPowerOfTwo(uint32_t value) {
+  uint32_t result = 1;
+  while (result < value) {
+    result *= 2;
+  }
+  return result;
+}
+
+void hashVec3(size_t &seed, const glm::vec3 &v) { hashCombine(seed, v.x, v.y, v.z); }
+
+}  // namespace
+
+ShadowSystem::ShadowSystem(BurnhopeDevice &device) : lveDevice{device}, atlas{device} {
+  createPipelineLayout();
+  createPipeline();
+  createViewBuffers();
+}
+
+ShadowSystem::~ShadowSystem() {
+  vkDestroyPipelineLayout(lveDevice.device(), pipelineLayout, nullptr);
+}
+
+void ShadowSystem::createPipelineLayout() {
+  // set 0: the GPU scene records and the scene index of every caster instance, as in the
+  // main pass
+  objectSetLayout =
+      BurnhopeDescriptorSetLayout::Builder(lveDevice)
+          .addBinding(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT)
+          .addBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT)
+          .build();
+  descriptorPool = BurnhopeDescriptorPool::Builder(lveDevice)
+                       .setMaxSets(BurnhopeSwapChain::MAX_FRAMES_IN_FLIGHT)
+                       .addPoolSize(
+                           VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                           2 * BurnhopeSwapChain::MAX_FRAMES_IN_FLIGHT)
+                       .build();
+
+  VkPushConstantRange pushConstantRange{};
+  pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+  pushConstantRange.offset = 0;
+  pushConstantRange.size = sizeof(ShadowPushConstants);
+
+  VkDescriptorSetLayout descriptorSetLayout = objectSetLayout->getDescriptorSetLayout();
+  VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+  pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+  pipelineLayoutInfo.setLayoutCount = 1;
+  pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
+  pipelineLayoutInfo.pushConstantRangeCount = 1;
+  pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+  if (vkCreatePipelineLayout(lveDevice.device(), &pipelineLayoutInfo, nullptr, &pipelineLayout) !=
+      VK_SUCCESS) {
+    throw std::runtime_error("failed to create shadow pipeline layout!");
+  }
+}
+
+void ShadowSystem::createPipeline() {
+  assert(pipelineLayout != nullptr && "Cannot create pipeline before pipeline layout");
+
+  PipelineConfigInfo pipelineConfig{};
+  BurnhopePipeline::defaultPipelineConfigInfo(pipelineConfig);
+  BurnhopePipeline::enableDepthOnly(pipelineConfig);
+  // the atlas pass has no color attachment
+  pipelineConfig.colorBlendInfo.attachmentCount = 0;
+  // both sides cast, the slope scaled bias keeps lit surfaces from shadowing themselves
+  pipelineConfig.rasterizationInfo.cullMode = VK_CULL_MODE_NONE;
+  pipelineConfig.rasterizationInfo.depthBiasEnable = VK_TRUE;
+  pipelineConfig.rasterizationInfo.depthBiasConstantFactor = 1.25f;
+  pipelineConfig.rasterizationInfo.depthBiasSlopeFactor = 1.75f;
+  pipelineConfig.renderPass = atlas.getRenderPass();
+  pipelineConfig.pipelineLayout = pipelineLayout;
+  lvePipeline = std::make_unique<BurnhopePipeline>(
+      lveDevice,
+      "shaders/shadow.vert.spv",
+      "",
+      pipelineConfig);
+}
+
+void ShadowSystem::createViewBuffers() {
+  for (auto &viewBuffer : viewBuffers) {
+    viewBuffer = std::make_unique<BurnhopeBuffer>(
+        lveDevice,
+        sizeof(GpuShadowView),
+        MAX_SHADOW_VIEWS,
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+        MemoryUsage::CpuToGpu);
+    viewBuffer->map();
+  }
+}
+
+void ShadowSystem::setSun(glm::vec3 direction, glm::vec3 color, float intensity) {
+  sunDirection = glm::normalize(direction);
+  sunColor = color;
+  sunIntensity = intensity;
+}
+
+VkDescriptorBufferInfo ShadowSystem::getViewBufferInfo(int frameIndex) const {
+  return viewBuffers[frameIndex]->descriptorInfo();
+}
+
+void ShadowSystem::update(FrameInfo &frameInfo, GlobalUbo &ubo, std::vector<PointLight> &lights) {
+  assert(frameInfo.objectBounds != nullptr && "Shadows need this frame's object bounds");
+  stats.frames++;
+
+  placeSunView(frameInfo);
+  ubo.sunDirection = glm::vec4(sunDirection, sunIntensity);
+  ubo.sunColor = glm::vec4(sunColor, 0.f);
+  ubo.sunShadowView = views[0].active ? 0 : -1;
+
+  // rank the lights in view by the fraction of the screen height their range covers
+  const auto &planes = frameInfo.camera.getFrustumPlanes();
+  const glm::mat4 &view = frameInfo.camera.getView();
+  const float focalLength = frameInfo.camera.getProjection()[1][1];
+  lightCoverage.clear();
+  for (uint32_t i = 0; i < lights.size(); i++) {
+    auto &light = lights[i];
+    light.shadow = glm::ivec4{-1, 0, 0, 0};
+    glm::vec3 center{light.position};
+    float range = light.position.w;
+    bool inside = true;
+    for (const auto &plane : planes) {
+      if (glm::dot(glm::vec3(plane), center) + plane.w < -range) {
+        inside = false;
+        break;
+      }
+    }
+    if (!inside) continue;
+
+    float depth = (view * glm::vec4(center, 1.f)).z;
+    float coverage = depth <= range ? 1.f : std::min(focalLength * range / depth, 1.f);
+    lightCoverage.push_back({coverage, i});
+  }
+  size_t shadowedCount = std::min<size_t>(lightCoverage.size(), MAX_SHADOWED_POINT_LIGHTS);
+  std::partial_sort(
+      lightCoverage.begin(),
+      lightCoverage.begin() + shadowedCount,
+      lightCoverage.end(),
+      [](const auto &a, const auto &b) { return a.first > b.first; });
+
+  for (uint32_t slot = 0; slot < MAX_SHADOWED_POINT_LIGHTS; slot++) {
+    if (slot >= shadowedCount) {
+      for (uint32_t face = 0; face < CUBE_FACES; face++) {
+        deactivate(views[1 + slot * CUBE_FACES + face]);
+      }
+      continue;
+    }
+    auto [coverage, lightIndex] = lightCoverage[slot];
+    uint32_t tileSize = std::clamp(
+        nextPowerOfTwo(static_cast<uint32_t>(coverage * MAX_POINT_TILE_SIZE)),
+        BurnhopeShadowAtlas::MIN_TILE_SIZE,
+        MAX_POINT_TILE_SIZE);
+    lights[lightIndex].shadow.x = placePointViews(slot, lights[lightIndex], tileSize);
+  }
+
+  for (uint32_t i = 0; i < MAX_SHADOW_VIEWS; i++) {
+    auto &shadowView = views[i];
+    if (!shadowView.active) continue;
+    gatherCasters(frameInfo, shadowView);
+    gpuViews[i].viewProjection = shadowView.viewProjection;
+    gpuViews[i].atlasRect = BurnhopeShadowAtlas::tileRect(shadowView.tile);
+  }
+  viewBuffers[frameInfo.frameIndex]->writeToBuffer(gpuViews.data(), sizeof(gpuViews));
+  viewBuffers[frameInfo.frameIndex]->flushDirtyRanges();
+}
+
+void ShadowSystem::placeSunView(const FrameInfo &frameInfo) {
+  auto &sunView = views[0];
+  const auto &bounds = *frameInfo.objectBounds;
+  if (sunIntensity <= 0.f || bounds.size() == 0) {
+    deactivate(sunView);
+    return;
+  }
+
+  // one orthographic view around the whole scene
+  glm::vec3 minCorner{std::numeric_limits<float>::max()};
+  glm::vec3 maxCorner{std::numeric_limits<float>::lowest()};
+  for (size_t i = 0; i < bounds.size(); i++) {
+    glm::vec3 center{bounds.centerX[i], bounds.centerY[i], bounds.centerZ[i]};
+    minCorner = glm::min(minCorner, center - bounds.radius[i]);
+    maxCorner = glm::max(maxCorner, center + bounds.radius[i]);
+  }
+  if (!ensureTile(sunView, SUN_TILE_SIZE)) {
+    deactivate(sunView);
+    return;
+  }
+  // whole units of radius and a center on the texel grid, so small changes of the scene bounds
+  // neither resize the view nor make its edges crawl
+  float radius = std::ceil(glm::length(maxCorner - minCorner) * .5f);
+  float texel = 2.f * radius / sunView.tile.size;
+  glm::vec3 center = glm::round((minCorner + maxCorner) * .5f / texel) * texel;
+
+  glm::vec3 up = std::abs(sunDirection.y) > .99f ? glm::vec3{0.f, 0.f, 1.f}
+                                                 : glm::vec3{0.f, -1.f, 0.f};
+  sunView.camera.setOrthographicProjection(-radius, radius, -radius, radius, 0.f, 2.f * radius);
+  sunView.camera.setViewDirection(center + sunDirection * radius, -sunDirection, up);
+  sunView.active = true;
+}
+
+int ShadowSystem::placePointViews(uint32_t slot, const PointLight &light, uint32_t tileSize) {
+  const int firstView = static_cast<int>(1 + slot * CUBE_FACES);
+  glm::vec3 position{light.position};
+  for (uint32_t face = 0; face < CUBE_FACES; face++) {
+    auto &faceView = views[firstView + face];
+    if (!ensureTile(faceView, tileSize)) {
+      for (uint32_t other = 0; other < CUBE_FACES; other++) {
+        deactivate(views[firstView + other]);
+      }
+      return -1;
+    }
+    // a couple of texels past 90 degrees, so filtering at a face edge stays inside the face
+    float fov = 2.f * std::atan(1.f + 2.f / faceView.tile.size);
+    glm::vec3 up = face == 2 || face == 3 ? glm::vec3{0.f, 0.f, 1.f} : glm::vec3{0.f, -1.f, 0.f};
+    faceView.camera.setPerspectiveProjection(
+        fov,
+        1.f,
+        POINT_SHADOW_NEAR,
+        std::max(light.position.w, POINT_SHADOW_NEAR * 2.f));
+    faceView.camera.setViewDirection(position, FACE_DIRECTIONS[face], up);
+    faceView.active = true;
+  }
+  return firstView;
+}
+
+bool ShadowSystem::ensureTile(ShadowView &view, uint32_t size) {
+  if (view.tile.size > 0 && view.requestedSize == size) return true;
+
+  if (view.tile.size > 0) {
+    atlas.release(view.tile);
+    view.tile = {};
+    view.renderedSignature = 0;
+  }
+  // the atlas is shared, so fall back to smaller tiles rather than dropping the shadow.
+  // requestedSize is what keeps a fallback tile from being reallocated every frame.
+  view.requestedSize = size;
+  for (uint32_t tileSize = size; tileSize >= BurnhopeShadowAtlas::MIN_TILE_SIZE; tileSize /= 2) {
+    if (atlas.allocate(tileSize, view.tile)) return true;
+  }
+  view.requestedSize = 0;
+  return false;
+}
+
+void ShadowSystem::deactivate(ShadowView &view) {
+  if (view.tile.size > 0) {
+    atlas.release(view.tile);
+  }
+  view.active = false;
+  view.tile = {};
+  view.requestedSize = 0;
+  view.renderedSignature = 0;
+  view.casters.clear();
+}
+
+void ShadowSystem::gatherCasters(const FrameInfo &frameInfo, ShadowView &view) {
+  view.viewProjection = view.camera.getProjection() * view.camera.getView();
+  visibleIndices.clear();
+  BurnhopeFrustumCuller::cull(
+      *frameInfo.objectBounds, view.camera.getFrustumPlanes(), visibleIndices);
+
+  // the tile's depth depends on the projection, where the tile is and every caster's mesh and
+  // transform, nothing else
+  size_t seed = 0;
+  for (int column = 0; column < 4; column++) {
+    for (int row = 0; row < 4; row++) {
+      hashCombine(seed, view.viewProjection[column][row]);
+    }
+  }
+  hashCombine(seed, view.tile.x, view.tile.y, view.tile.size);
+
+  view.casters.clear();
+  for (uint32_t boundsIndex : visibleIndices) {
+    BurnhopeGameObject::id_t entity = (*frameInfo.boundsOwners)[boundsIndex];
+    BurnhopeModel *model = frameInfo.components.models.get(entity).get();
+    uint32_t sceneIndex = frameInfo.components.transforms.slotOf(entity);
+    const auto &transform = frameInfo.components.transforms.components()[sceneIndex];
+    view.casters.push_back({model, sceneIndex});
+    hashCombine(seed, model, sceneIndex);
+    hashVec3(seed, transform.translation);
+    hashVec3(seed, transform.rotation);
+    hashVec3(seed, transform.scale);
+  }
+  std::sort(view.casters.begin(), view.casters.end());
+  // 0 is reserved for an empty tile
+  view.signature = seed == 0 ? 1 : seed;
+}
+
+void ShadowSystem::render(FrameInfo &frameInfo) {
+  // the casters of every redrawn view, as one run of scene indices each
+  instanceIndices.clear();
+  firstInstances.clear();
+  for (auto &shadowView : views) {
+    if (!shadowView.active) continue;
+    if (shadowView.signature == shadowView.renderedSignature) {
+      stats.viewsCached++;
+      continue;
+    }
+    firstInstances.push_back(static_cast<uint32_t>(instanceIndices.size()));
+    for (const auto &caster : shadowView.casters) {
+      instanceIndices.push_back(caster.second);
+    }
+  }
+  if (firstInstances.empty()) return;
+
+  uploadInstances(frameInfo.frameIndex);
+  VkDescriptorSet objectSet = getObjectDescriptorSet(frameInfo);
+
+  VkCommandBuffer commandBuffer = frameInfo.commandBuffer;
+  atlas.beginRenderPass(commandBuffer);
+  lvePipeline->bind(commandBuffer);
+  vkCmdBindDescriptorSets(
+      commandBuffer,
+      VK_PIPELINE_BIND_POINT_GRAPHICS,
+      pipelineLayout,
+      0,
+      1,
+      &objectSet,
+      0,
+      nullptr);
+
+  size_t run = 0;
+  for (auto &shadowView : views) {
+    if (!shadowView.active || shadowView.signature == shadowView.renderedSignature) continue;
+    atlas.beginTile(commandBuffer, shadowView.tile);
+    ShadowPushConstants push{};
+    push.lightViewProjection = shadowView.viewProjection;
+    vkCmdPushConstants(
+        commandBuffer,
+        pipelineLayout,
+        VK_SHADER_STAGE_VERTEX_BIT,
+        0,
+        sizeof(ShadowPushConstants),
+        &push);
+
+    // casters are sorted by model, each run of one model is an instanced draw
+    const uint32_t firstInstance = firstInstances[run++];
+    const auto &casters = shadowView.casters;
+    size_t batchStart = 0;
+    while (batchStart < casters.size()) {
+      size_t batchEnd = batchStart + 1;
+      while (batchEnd < casters.size() && casters[batchEnd].first == casters[batchStart].first) {
+        batchEnd++;
+      }
+      BurnhopeModel *model = casters[batchStart].first;
+      model->bindPositions(commandBuffer);
+      model->draw(
+          commandBuffer,
+          static_cast<uint32_t>(batchEnd - batchStart),
+          firstInstance + static_cast<uint32_t>(batchStart));
+      stats.draws++;
+      batchStart = batchEnd;
+    }
+
+    shadowView.renderedSignature = shadowView.signature;
+    stats.viewsRendered++;
+    stats.casters += static_cast<uint32_t>(casters.size());
+  }
+  atlas.endRenderPass(commandBuffer);
+}
+
+void ShadowSystem::uploadInstances(int frameIndex) {
+  // the frame's fence has been waited on, so its previous instance buffer can be replaced
+  auto &instanceBuffer = instanceBuffers[frameIndex];
+  uint32_t required = std::max(static_cast<uint32_t>(instanceIndices.size()), 1u);
+  if (instanceBuffer == nullptr || instanceBuffer->getInstanceCount() < required) {
+    uint32_t capacity =
+        instanceBuffer == nullptr ? INITIAL_INSTANCE_CAPACITY : instanceBuffer->getInstanceCount();
+    while (capacity < required) {
+      capacity *= 2;
+    }
+    instanceBuffer = std::make_unique<BurnhopeBuffer>(
+        lveDevice,
+        sizeof(uint32_t),
+        capacity,
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+        MemoryUsage::CpuToGpu);
+    instanceBuffer->map();
+  }
+  if (!instanceIndices.empty()) {
+    instanceBuffer->writeToBuffer(
+        instanceIndices.data(),
+        instanceIndices.size() * sizeof(uint32_t));
+    instanceBuffer->flushDirtyRanges();
+  }
+}
+
+VkDescriptorSet ShadowSystem::getObjectDescriptorSet(const FrameInfo &frameInfo) {
+  int frameIndex = frameInfo.frameIndex;
+  auto &objectSet = objectDescriptorSets[frameIndex];
+  VkBuffer instanceBuffer = instanceBuffers[frameIndex]->getBuffer();
+  // Cached views can skip this for many frames, long enough for the scene buffer to be
+  // replaced and freed and its handle reused, so it is compared by version. The instance
+  // buffer is only replaced right before this call, while the old one is still alive.
+  if (objectSet.descriptorSet != VK_NULL_HANDLE &&
+      objectSet.sceneBufferVersion == frameInfo.sceneBufferVersion &&
+      objectSet.instanceBuffer == instanceBuffer) {
+    return objectSet.descriptorSet;
+  }
+
+  // first use, or the scene or instance buffer grew and was recreated
+  VkDescriptorBufferInfo sceneInfo = frameInfo.sceneBufferInfo;
+  VkDescriptorBufferInfo instanceInfo = instanceBuffers[frameIndex]->descriptorInfo();
+  BurnhopeDescriptorWriter writer{*objectSetLayout, *descriptorPool};
+  writer.writeBuffer(0, &sceneInfo).writeBuffer(1, &instanceInfo);
+  if (objectSet.descriptorSet == VK_NULL_HANDLE) {
+    if (!writer.build(objectSet.descriptorSet)) {
+      throw std::runtime_error("failed to allocate shadow object descriptor set!");
+    }
+  } else {
+    writer.overwrite(objectSet.descriptorSet);
+  }
+  objectSet.sceneBufferVersion = frameInfo.sceneBufferVersion;
+  objectSet.instanceBuffer = instanceBuffer;
+  return objectSet.descriptorSet;
+}
+
+ShadowSystem::Stats ShadowSystem::takeStats() {
+  Stats taken = stats;
+  stats = {};
+  return taken;
+}
+
+}  // namespace burnhope
@@ -0,0 +1,146 @@
+#pragma once
+
+#include "lve_buffer.hpp"
+#include "lve_camera.hpp"
+#include "lve_descriptors.hpp"
+#include "lve_device.hpp"
+#include "lve_frame_info.hpp"
+#include "lve_frustum_culler.hpp"
+#include "lve_pipeline.hpp"
+#include "lve_shadow_atlas.hpp"
+#include "lve_swap_chain.hpp"
+
+// std
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace burnhope {
+
+// Shadow maps for the sun and the point lights covering the most screen, all rendered into one
+// BurnhopeShadowAtlas. A point light is six cube face views, each a perspective tile sized by how
+// much of the screen the light covers. Every view draws only the casters inside its frustum and
+// is redrawn only when its projection, tile or one of those casters changed, so static lights
+// over a static scene cost nothing after the first frame.
+class ShadowSystem {
+ public:
+  static constexpr uint32_t MAX_SHADOWED_POINT_LIGHTS = 4;
+  static constexpr uint32_t CUBE_FACES = 6;
+  // view 0 is the sun, then six consecutive faces per shadowed point light
+  static constexpr uint32_t MAX_SHADOW_VIEWS = 1 + CUBE_FACES * MAX_SHADOWED_POINT_LIGHTS;
+  static constexpr uint32_t SUN_TILE_SIZE = 2048;
+  // point faces of a light filling the screen, smaller lights get smaller tiles
+  static constexpr uint32_t MAX_POINT_TILE_SIZE = 512;
+
+  struct Stats {
+    uint32_t frames = 0;
+    uint32_t viewsRendered = 0;
+    uint32_t viewsCached = 0;  // active views whose tile was reused as is
+    uint32_t casters = 0;      // caster instances drawn into redrawn views
+    uint32_t draws = 0;
+
+    Stats &operator+=(const Stats &other) {
+      frames += other.frames;
+      viewsRendered += other.viewsRendered;
+      viewsCached += other.viewsCached;
+      casters += other.casters;
+      draws += other.draws;
+      return *this;
+    }
+  };
+
+  explicit ShadowSystem(BurnhopeDevice &device);
+  ~ShadowSystem();
+
+  ShadowSystem(const ShadowSystem &) = delete;
+  ShadowSystem &operator=(const ShadowSystem &) = delete;
+
+  // direction points towards the sun, an intensity of 0 turns it off
+  void setSun(glm::vec3 direction, glm::vec3 color, float intensity);
+
+  // for each frame's global descriptor set: the shadow views and the atlas
+  VkDescriptorBufferInfo getViewBufferInfo(int frameIndex) const;
+  VkDescriptorImageInfo getAtlasInfo() const { return atlas.getDescriptorInfo(); }
+
+  // Places this frame's shadow views, fills the sun fields of the ubo and points the shadowed
+  // lights at their views. Call after the lights are gathered and the game objects buffer is
+  // updated, before the lights are uploaded.
+  void update(FrameInfo &frameInfo, GlobalUbo &ubo, std::vector<PointLight> &lights);
+  // Redraws the views that changed. Must be called outside a render pass, after update.
+  void render(FrameInfo &frameInfo);
+
+  // returns the counters accumulated since the last call and resets them
+  Stats takeStats();
+
+ private:
+  struct ShadowView {
+    bool active = false;
+    BurnhopeCamera camera{};
+    glm::mat4 viewProjection{1.f};
+    BurnhopeShadowAtlas::Tile tile{};
+    uint32_t requestedSize = 0;  // tile may be smaller when the atlas was full
+    // of what the tile holds, 0 when it holds nothing
+    size_t renderedSignature = 0;
+    size_t signature = 0;
+    // this frame's casters as (model, scene index), sorted by model
+    std::vector<std::pair<BurnhopeModel *, uint32_t>> casters;
+  };
+
+  struct GpuShadowView {
+    glm::mat4 viewProjection{1.f};
+    glm::vec4 atlasRect{};  // see BurnhopeShadowAtlas::tileRect
+  };
+
+  // one set per frame over the scene and instance buffers, rebuilt when either grows
+  struct ObjectDescriptorSet {
+    VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+    uint64_t sceneBufferVersion = 0;
+    VkBuffer instanceBuffer = VK_NULL_HANDLE;
+  };
+
+  void createPipelineLayout();
+  void createPipeline();
+  void createViewBuffers();
+
+  void placeSunView(const FrameInfo &frameInfo);
+  // returns the index of the light's first face view, or -1 if no tile was left
+  int placePointViews(uint32_t slot, const PointLight &light, uint32_t tileSize);
+  // makes sure view holds a tile of size, or of the largest size still free below it
+  bool ensureTile(ShadowView &view, uint32_t size);
+  void deactivate(ShadowView &view);
+  // culls casters against the view's frustum and hashes everything its depth depends on
+  void gatherCasters(const FrameInfo &frameInfo, ShadowView &view);
+
+  void uploadInstances(int frameIndex);
+  VkDescriptorSet getObjectDescriptorSet(const FrameInfo &frameInfo);
+
+  BurnhopeDevice &lveDevice;
+  BurnhopeShadowAtlas atlas;
+
+  std::unique_ptr<BurnhopePipeline> lvePipeline;
+  VkPipelineLayout pipelineLayout;
+  std::unique_ptr<BurnhopeDescriptorSetLayout> objectSetLayout;
+  std::unique_ptr<BurnhopeDescriptorPool> descriptorPool;
+  std::array<ObjectDescriptorSet, BurnhopeSwapChain::MAX_FRAMES_IN_FLIGHT> objectDescriptorSets{};
+  std::array<std::unique_ptr<BurnhopeBuffer>, BurnhopeSwapChain::MAX_FRAMES_IN_FLIGHT>
+      instanceBuffers;
+  std::array<std::unique_ptr<BurnhopeBuffer>, BurnhopeSwapChain::MAX_FRAMES_IN_FLIGHT>
+      viewBuffers;
+
+  glm::vec3 sunDirection{0.f, -1.f, 0.f};
+  glm::vec3 sunColor{1.f};
+  float sunIntensity = 0.f;
+
+  std::array<ShadowView, MAX_SHADOW_VIEWS> views{};
+  std::array<GpuShadowView, MAX_SHADOW_VIEWS> gpuViews{};
+  std::vector<std::pair<float, uint32_t>> lightCoverage;
+  std::vector<uint32_t> visibleIndices;
+  // scene indices of every redrawn view's casters, one run per view
+  std::vector<uint32_t> instanceIndices;
+  std::vector<uint32_t> firstInstances;
+  Stats stats{};
+};
+
+}  // namespace burnhope
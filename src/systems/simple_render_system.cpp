@@ -1,5 +1,8 @@
 ﻿#include "simple_render_system.hpp"
 
+#include "lve_gbuffer.hpp"
+#include "systems/light_cluster_system.hpp"
+
 // libs
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
@@ -7,22 +10,41 @@
 #include <glm/gtc/constants.hpp>
 
 // std
+#include <algorithm>
 #include <array>
 #include <cassert>
+#include <iostream>
 #include <stdexcept>
+#include <utility>
 
 namespace burnhope {
 
-struct SimplePushConstantData {
-  glm::mat4 modelMatrix{1.f}; //матрица трансформации объекта.
-  glm::mat4 normalMatrix{1.f}; //используется для корректного преобразования нормалей при освещении.
+// instance buffers start with this many entries and double when outgrown
+constexpr uint32_t INITIAL_INSTANCE_CAPACITY = 1024;
+
+// shading variant mask: the material's features, then the light count class and the depth test
+constexpr uint32_t LIGHT_CLASS_SHIFT = Material::FEATURE_BITS;
+constexpr uint32_t VARIANT_DEPTH_EQUAL = 1u << (LIGHT_CLASS_SHIFT + 2);
+
+// Light count classes, bounding the cluster light loop in simple_shader.frag. A cluster never
+// holds more lights than the scene, so a small scene loses nothing to the lower bound.
+enum LightCountClass : uint32_t { LIGHTS_NONE = 0, LIGHTS_FEW = 1, LIGHTS_ALL = 2 };
+constexpr uint32_t FEW_LIGHTS_LIMIT = 16;
+
+// image infos for the material set, bindings 0..4
+struct MaterialDescriptorData {
+  static constexpr uint32_t MAP_COUNT = 5;
+  VkDescriptorImageInfo maps[MAP_COUNT];
 };
 
 SimpleRenderSystem::SimpleRenderSystem(
-    BurnhopeDevice& device, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout)
-    : lveDevice{device} {
+    BurnhopeDevice& device,
+    RenderPassFn renderPass,
+    VkDescriptorSetLayout globalSetLayout,
+    bool deferred)
+    : lveDevice{device}, renderPass{std::move(renderPass)}, deferred{deferred} {
   createPipelineLayout(globalSetLayout);//создает layout для пайплайна (включает descriptor set и push-константы).
-  createPipeline(renderPass);//создает сам графический пайплайн.
+  createPipeline();//создает сам графический пайплайн.
 }
 
 SimpleRenderSystem::~SimpleRenderSystem() {
@@ -30,119 +52,420 @@ SimpleRenderSystem::~SimpleRenderSystem() {
 }
 
 void SimpleRenderSystem::createPipelineLayout(VkDescriptorSetLayout globalSetLayout) {
-  VkPushConstantRange pushConstantRange{};
-  pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
-  pushConstantRange.offset = 0;
-  pushConstantRange.size = sizeof(SimplePushConstantData); //Описание push-констант: для каких шейдеров и сколько байт.
+  // set 1: the GPU scene records (binding 0) and the scene index of every instance (binding 1),
+  // looked up with gl_InstanceIndex
+  objectSetLayout =
+      BurnhopeDescriptorSetLayout::Builder(lveDevice)
+          .addBinding(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT)
+          .addBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT)
+          .build();
 
-  renderSystemLayout =
+  // set 2: material textures
+  materialSetLayout =
       BurnhopeDescriptorSetLayout::Builder(lveDevice)
-          // Uniform Buffer (например, матрицы или свойства материала).
-          .addBinding(0,VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT)
           //Image Sampler (например, текстура).
+          .addBinding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT)
           .addBinding(1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT)
           .addBinding(2, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT)
           .addBinding(3, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT)
           .addBinding(4, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT)
-          .addBinding(5, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT)
-          .addBinding(6, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT)
+          .build();
+
+  // cached sets live across frames, an object set for each draw path plus one set per material
+  // per frame in flight. The pool grows if a scene uses more materials.
+  constexpr uint32_t initialSets = 64 * BurnhopeSwapChain::MAX_FRAMES_IN_FLIGHT;
+  descriptorPool =
+      BurnhopeDescriptorPool::Builder(lveDevice)
+          .setMaxSets(initialSets)
+          .addPoolSize(
+              VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+              4 * BurnhopeSwapChain::MAX_FRAMES_IN_FLIGHT)
+          .addPoolSize(
+              VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+              initialSets * MaterialDescriptorData::MAP_COUNT)
+          .setPoolFlags(VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT)
           .build();
 
   std::vector<VkDescriptorSetLayout> descriptorSetLayouts{//Список дескрипторных layout'ов:
       globalSetLayout,//общий 
-      renderSystemLayout->getDescriptorSetLayout()};//конкретно для моделей (текстура и буфер)
+      objectSetLayout->getDescriptorSetLayout(),  // scene buffer
+      materialSetLayout->getDescriptorSetLayout()};  // material textures
 
   //создание пайплайна
   VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
   pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
   pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(descriptorSetLayouts.size());
   pipelineLayoutInfo.pSetLayouts = descriptorSetLayouts.data();
-  pipelineLayoutInfo.pushConstantRangeCount = 1;
-  pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+  pipelineLayoutInfo.pushConstantRangeCount = 0;
+  pipelineLayoutInfo.pPushConstantRanges = nullptr;
   if (vkCreatePipelineLayout(lveDevice.device(), &pipelineLayoutInfo, nullptr, &pipelineLayout) !=
       VK_SUCCESS) {
     throw std::runtime_error("failed to create pipeline layout!");
   }
 }
 
-void SimpleRenderSystem::createPipeline(VkRenderPass renderPass) {
+void SimpleRenderSystem::createPipeline() {
   assert(pipelineLayout != nullptr && "Cannot create pipeline before pipeline layout");
 
-  PipelineConfigInfo pipelineConfig{};
-  BurnhopePipeline::defaultPipelineConfigInfo(pipelineConfig);
-  pipelineConfig.renderPass = renderPass;
-  pipelineConfig.pipelineLayout = pipelineLayout;
-  lvePipeline = std::make_unique<BurnhopePipeline>(
+  // constant ids as declared in simple_shader.frag, gbuffer.frag uses the same ones
+  shadingPipelines = std::make_unique<BurnhopePipelineVariants>(
       lveDevice,
       "shaders/simple_shader.vert.spv",
-      "shaders/simple_shader.frag.spv",
-      pipelineConfig);
-}
-
-void SimpleRenderSystem::renderGameObjects(FrameInfo& frameInfo) {
-  lvePipeline->bind(frameInfo.commandBuffer);//Привязка пайплайна
-  // Привязка глобального дескриптора
-  vkCmdBindDescriptorSets(
-      frameInfo.commandBuffer,
-      VK_PIPELINE_BIND_POINT_GRAPHICS,
-      pipelineLayout,
-      0,
-      1,
-      &frameInfo.globalDescriptorSet,
-      0,
-      nullptr);
-  
-  for (auto& kv : frameInfo.gameObjects) {
-    auto& obj = kv.second;
-
-    if (obj.model == nullptr) continue;
-
-    auto bufferInfo = obj.getBufferInfo(frameInfo.frameIndex);
-    auto imageInfo = obj.material->diffuseMap->getImageInfo();
-    auto normalInfo = obj.material->normalMap->getImageInfo();
-    auto AOMap = obj.material->AOMap->getImageInfo();
-    auto RoughnessMap = obj.material->RoughnessMap->getImageInfo();
-    auto MetallicMap = obj.material->MetallicMap->getImageInfo();
-
-    auto shadowMapInfo = obj.material->MetallicMap->getImageInfo();//исправить на тени в будущем
-
-    VkDescriptorSet gameObjectDescriptorSet;
-
-
-    BurnhopeDescriptorWriter(*renderSystemLayout, frameInfo.frameDescriptorPool)
-        .writeBuffer(0, &bufferInfo)
-        .writeImage(1, &imageInfo)
-        .writeImage(2, &normalInfo)
-        .writeImage(3, &AOMap)
-        .writeImage(4, &RoughnessMap)
-        .writeImage(5, &MetallicMap)
-        .writeImage(6, &shadowMapInfo)
-        .build(gameObjectDescriptorSet);
-
-    vkCmdBindDescriptorSets(
-        frameInfo.commandBuffer,
-        VK_PIPELINE_BIND_POINT_GRAPHICS,
-        pipelineLayout,
-        1,  // starting set (0 is the globalDescriptorSet, 1 is the set specific to this system)
-        1,  // set count
-        &gameObjectDescriptorSet,
-        0,
-        nullptr);
-
-    SimplePushConstantData push{};
-    push.modelMatrix = obj.transform.mat4();
-    push.normalMatrix = obj.transform.normalMatrix();
-
-    vkCmdPushConstants(
-        frameInfo.commandBuffer,
-        pipelineLayout,
-        VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
-        0,
-        sizeof(SimplePushConstantData),
-        &push);
-    obj.model->bind(frameInfo.commandBuffer);
-    obj.model->draw(frameInfo.commandBuffer);
+      deferred ? "shaders/gbuffer.frag.spv" : "shaders/simple_shader.frag.spv",
+      [this](uint32_t variantMask, PipelineConfigInfo& configInfo) {
+        BurnhopePipeline::defaultPipelineConfigInfo(configInfo);
+        if (variantMask & VARIANT_DEPTH_EQUAL) {
+          BurnhopePipeline::enableDepthEqual(configInfo);
+        }
+        if (deferred) {
+          BurnhopePipeline::enableColorAttachments(
+              configInfo,
+              BurnhopeGBuffer::GEOMETRY_COLOR_ATTACHMENTS);
+        }
+        // read now, the pass seen at construction may have been destroyed by a resize since
+        configInfo.renderPass = renderPass();
+        configInfo.pipelineLayout = pipelineLayout;
+      },
+      [](uint32_t variantMask) {
+        const uint32_t lightLimits[] = {
+            0,
+            FEW_LIGHTS_LIMIT,
+            LightClusterSystem::MAX_LIGHTS_PER_CLUSTER};
+        return std::vector<uint32_t>{
+            (variantMask & Material::FEATURE_NORMAL_MAP) ? 1u : 0u,
+            (variantMask & Material::FEATURE_ORM_MAPS) ? 1u : 0u,
+            lightLimits[(variantMask >> LIGHT_CLASS_SHIFT) & 3],
+            (variantMask & Material::FEATURE_TONEMAP) ? 1u : 0u};
+      });
+
+  // the G-buffer pass has no use for a depth pre-pass
+  if (deferred) {
+    return;
+  }
+  PipelineConfigInfo depthOnlyConfig{};
+  BurnhopePipeline::defaultPipelineConfigInfo(depthOnlyConfig);
+  BurnhopePipeline::enableDepthOnly(depthOnlyConfig);
+  depthOnlyConfig.renderPass = renderPass();
+  depthOnlyConfig.pipelineLayout = pipelineLayout;
+  depthPrePassPipeline = std::make_unique<BurnhopePipeline>(
+      lveDevice,
+      "shaders/depth_prepass.vert.spv",
+      "",
+      depthOnlyConfig);
+}
+
+BurnhopePipeline* SimpleRenderSystem::getShadingPipeline(const Material& material) {
+  return shadingPipelines->get(getShadingVariantMask(material, lightCountClass));
+}
+
+uint32_t SimpleRenderSystem::getShadingVariantMask(
+    const Material& material, uint32_t lightClass) const {
+  // the G-buffer is lit in one pass for every material, its variants only differ in features
+  if (deferred) {
+    return material.getFeatures();
+  }
+  uint32_t variantMask = material.getFeatures() | lightClass << LIGHT_CLASS_SHIFT;
+  if (material.usesDepthPrePass()) {
+    variantMask |= VARIANT_DEPTH_EQUAL;
+  }
+  return variantMask;
+}
+
+void SimpleRenderSystem::prewarmPipelines(const BurnhopeComponentStore& components) {
+  for (const std::shared_ptr<Material>& material : components.materials.components()) {
+    if (material == nullptr) continue;
+    // lights come and go at runtime, so every class the frame may select is built
+    for (uint32_t lightClass : {LIGHTS_NONE, LIGHTS_FEW, LIGHTS_ALL}) {
+      shadingPipelines->get(getShadingVariantMask(*material, lightClass));
+    }
   }
 }
 
+void SimpleRenderSystem::selectLightCountClass(uint32_t lightCount) {
+  if (lightCount == 0) {
+    lightCountClass = LIGHTS_NONE;
+  } else if (lightCount <= FEW_LIGHTS_LIMIT) {
+    lightCountClass = LIGHTS_FEW;
+  } else {
+    lightCountClass = LIGHTS_ALL;
+  }
+}
+
+void SimpleRenderSystem::submitDepthPrePass(
+    RenderPacket packet, float viewDistance, BurnhopeRenderQueue& renderQueue) {
+  // same pipeline layout, so sets 0 and 1 stay bound into the shading pass
+  packet.pipeline = depthPrePassPipeline.get();
+  packet.descriptorSets[2] = VK_NULL_HANDLE;
+  packet.positionsOnly = true;
+  packet.sortKey = BurnhopeRenderQueue::makeDepthPrePassKey(
+      renderQueue.stateId(depthPrePassPipeline.get()),
+      renderQueue.stateId(packet.model),
+      viewDistance);
+  renderQueue.submit(packet);
+  drawStats.prePassDraws++;
+}
+
+void SimpleRenderSystem::buildInstanceBatches(
+    FrameInfo& frameInfo, BurnhopeRenderQueue& renderQueue) {
+  const glm::vec3 cameraPosition = frameInfo.camera.getPosition();
+  drawInstances.clear();
+  instanceKeys.clear();
+
+  const std::vector<uint32_t>* visible = &visibleIndices;
+  if (frameInfo.occlusionCuller != nullptr) {
+    visible = &frameInfo.occlusionCuller->waitForVisible();
+  } else {
+    visibleIndices.clear();
+    BurnhopeFrustumCuller::cull(
+        *frameInfo.objectBounds, frameInfo.camera.getFrustumPlanes(), visibleIndices);
+  }
+  drawStats.culled += static_cast<uint32_t>(frameInfo.objectBounds->size() - visible->size());
+
+  const BurnhopeComponentStore& components = frameInfo.components;
+  for (uint32_t boundsIndex : *visible) {
+    BurnhopeGameObject::id_t entity = (*frameInfo.boundsOwners)[boundsIndex];
+    const BurnhopeModel* model = components.models.get(entity).get();
+    const Material* material = components.materials.get(entity).get();
+    uint32_t sceneIndex = components.transforms.slotOf(entity);
+    const glm::vec3& translation = components.transforms.components()[sceneIndex].translation;
+    float viewDistance = glm::length(translation - cameraPosition);
+    drawInstances.push_back({model, material, sceneIndex, viewDistance, entity});
+    instanceKeys.push_back(BurnhopeRenderQueue::makeOpaqueKey(
+        renderQueue.stateId(getShadingPipeline(*material)),
+        renderQueue.stateId(material),
+        renderQueue.stateId(model),
+        viewDistance));
+  }
+  BurnhopeRenderQueue::radixSort(instanceKeys, instanceOrder, sortScratch);
+
+  instanceIndices.clear();
+  for (uint32_t index : instanceOrder) {
+    instanceIndices.push_back(drawInstances[index].sceneIndex);
+  }
+
+  // the frame's fence has been waited on, so its previous instance buffer can be replaced
+  auto& instanceBuffer = instanceBuffers[frameInfo.frameIndex];
+  uint32_t required = std::max(static_cast<uint32_t>(instanceIndices.size()), 1u);
+  if (instanceBuffer == nullptr || instanceBuffer->getInstanceCount() < required) {
+    uint32_t capacity =
+        instanceBuffer == nullptr ? INITIAL_INSTANCE_CAPACITY : instanceBuffer->getInstanceCount();
+    while (capacity < required) {
+      capacity *= 2;
+    }
+    if (instanceBuffer != nullptr) {
+      std::cout << "instance buffer " << frameInfo.frameIndex << " grown to " << capacity
+                << " entries\n";
+    }
+    instanceBuffer = std::make_unique<BurnhopeBuffer>(
+        lveDevice,
+        sizeof(uint32_t),
+        capacity,
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+        MemoryUsage::CpuToGpu);
+    instanceBuffer->map();
+  }
+  if (!instanceIndices.empty()) {
+    instanceBuffer->writeToBuffer(
+        instanceIndices.data(),
+        instanceIndices.size() * sizeof(uint32_t));
+    instanceBuffer->flushDirtyRanges();
+  }
+}
+
+void SimpleRenderSystem::renderGameObjects(
+    FrameInfo& frameInfo, BurnhopeRenderQueue& renderQueue) {
+  frameCounter++;
+  selectLightCountClass(frameInfo.lightCount);
+  buildInstanceBatches(frameInfo, renderQueue);
+
+  RenderPacket packet{};
+  packet.pipelineLayout = pipelineLayout;
+  packet.descriptorSets[0] = frameInfo.globalDescriptorSet;
+  // each instance looks up its record through the instance buffer
+  packet.descriptorSets[1] = getObjectDescriptorSet(
+      objectDescriptorSets[frameInfo.frameIndex],
+      frameInfo,
+      instanceBuffers[frameInfo.frameIndex]->descriptorInfo());
+
+  // sorted instances sharing a model and material form one batch, whose key is that of its
+  // nearest instance. Ids can collide, so batches compare the actual pointers.
+  size_t batchStart = 0;
+  while (batchStart < instanceOrder.size()) {
+    const DrawInstance& first = drawInstances[instanceOrder[batchStart]];
+    size_t batchEnd = batchStart + 1;
+    while (batchEnd < instanceOrder.size() &&
+           drawInstances[instanceOrder[batchEnd]].model == first.model &&
+           drawInstances[instanceOrder[batchEnd]].material == first.material) {
+      batchEnd++;
+    }
+
+    const auto& material = frameInfo.components.materials.get(first.entity);
+    packet.sortKey = instanceKeys[instanceOrder[batchStart]];
+    packet.pipeline = getShadingPipeline(*material);
+    packet.descriptorSets[2] = getMaterialDescriptorSet(frameInfo.frameIndex, material);
+    packet.model = frameInfo.components.models.get(first.entity).get();
+    packet.instanceCount = static_cast<uint32_t>(batchEnd - batchStart);
+    packet.firstInstance = static_cast<uint32_t>(batchStart);
+    renderQueue.submit(packet);
+    if (material->usesDepthPrePass() && !deferred) {
+      submitDepthPrePass(packet, first.viewDistance, renderQueue);
+    }
+
+    drawStats.draws++;
+    batchStart = batchEnd;
+  }
+  drawStats.objects += static_cast<uint32_t>(drawInstances.size());
+
+  pruneDescriptorCache(frameInfo.frameIndex);
+}
+
+void SimpleRenderSystem::renderGameObjectsIndirect(
+    FrameInfo& frameInfo, BurnhopeRenderQueue& renderQueue, const GpuCullSystem& cullSystem) {
+  frameCounter++;
+  selectLightCountClass(frameInfo.lightCount);
+
+  RenderPacket packet{};
+  packet.pipelineLayout = pipelineLayout;
+  packet.descriptorSets[0] = frameInfo.globalDescriptorSet;
+  packet.descriptorSets[1] = getObjectDescriptorSet(
+      indirectObjectDescriptorSets[frameInfo.frameIndex],
+      frameInfo,
+      cullSystem.getInstanceBufferInfo(frameInfo.frameIndex));
+  packet.indirectBuffer = cullSystem.getDrawCommandBuffer(frameInfo.frameIndex);
+  if (cullSystem.isCompacting()) {
+    packet.countBuffer = cullSystem.getDrawCountBuffer(frameInfo.frameIndex);
+  }
+
+  // per bucket work only, the object count never shows up on the CPU here
+  const auto& buckets = cullSystem.getBuckets();
+  for (uint32_t bucketIndex = 0; bucketIndex < buckets.size(); bucketIndex++) {
+    const auto& bucket = buckets[bucketIndex];
+    packet.pipeline = getShadingPipeline(*bucket.material);
+    packet.sortKey = BurnhopeRenderQueue::makeOpaqueKey(
+        renderQueue.stateId(packet.pipeline),
+        renderQueue.stateId(bucket.material.get()),
+        renderQueue.stateId(bucket.model.get()),
+        0.f);
+    packet.descriptorSets[2] = getMaterialDescriptorSet(frameInfo.frameIndex, bucket.material);
+    packet.model = bucket.model.get();
+    packet.indirectOffset = bucket.firstCommand * sizeof(VkDrawIndexedIndirectCommand);
+    packet.indirectDrawCount = bucket.objectCount;
+    packet.countOffset = bucketIndex * sizeof(uint32_t);
+    renderQueue.submit(packet);
+    if (bucket.material->usesDepthPrePass() && !deferred) {
+      submitDepthPrePass(packet, 0.f, renderQueue);
+    }
+
+    drawStats.draws++;
+    drawStats.objects += bucket.objectCount;
+  }
+
+  pruneDescriptorCache(frameInfo.frameIndex);
+}
+
+VkDescriptorSet SimpleRenderSystem::getObjectDescriptorSet(
+    ObjectDescriptorSet& objectSet,
+    const FrameInfo& frameInfo,
+    const VkDescriptorBufferInfo& instanceBufferInfo) {
+  // the instance buffer is only replaced while the old one is still alive, so its handle can't
+  // repeat here, the scene buffer's can
+  if (objectSet.descriptorSet != VK_NULL_HANDLE &&
+      objectSet.sceneBufferVersion == frameInfo.sceneBufferVersion &&
+      objectSet.instanceBuffer == instanceBufferInfo.buffer) {
+    return objectSet.descriptorSet;
+  }
+
+  // first use, or the scene or instance buffer grew and was recreated
+  VkDescriptorBufferInfo sceneInfo = frameInfo.sceneBufferInfo;
+  VkDescriptorBufferInfo instanceInfo = instanceBufferInfo;
+  BurnhopeDescriptorWriter writer{*objectSetLayout, *descriptorPool};
+  writer.writeBuffer(0, &sceneInfo).writeBuffer(1, &instanceInfo);
+  if (objectSet.descriptorSet == VK_NULL_HANDLE) {
+    if (!writer.build(objectSet.descriptorSet)) {
+      throw std::runtime_error("failed to allocate object descriptor set!");
+    }
+    descriptorStats.setsAllocated++;
+  } else {
+    writer.overwrite(objectSet.descriptorSet);
+  }
+  descriptorStats.descriptorWrites += 2;
+  objectSet.sceneBufferVersion = frameInfo.sceneBufferVersion;
+  objectSet.instanceBuffer = instanceBufferInfo.buffer;
+  return objectSet.descriptorSet;
+}
+
+VkDescriptorSet SimpleRenderSystem::getMaterialDescriptorSet(
+    int frameIndex, const std::shared_ptr<Material>& material) {
+  // the frame's fence has been waited on, so sets cached for this frame index are not in use
+  auto& cached = materialDescriptorCache[frameIndex][material.get()];
+  cached.lastUsedFrame = frameCounter;
+  if (cached.descriptorSet != VK_NULL_HANDLE && cached.materialVersion == material->getVersion()) {
+    return cached.descriptorSet;
+  }
+
+  // packed in binding order for the layout's update template. Maps the material's variant
+  // doesn't sample still need a valid image, the diffuse map stands in for them.
+  auto mapInfo = [&material](const std::shared_ptr<BurnhopeTexture>& map) {
+    return (map != nullptr ? map : material->getDiffuseMap())->getImageInfo();
+  };
+  MaterialDescriptorData data{};
+  data.maps[0] = material->getDiffuseMap()->getImageInfo();
+  data.maps[1] = mapInfo(material->getNormalMap());
+  data.maps[2] = mapInfo(material->getAOMap());
+  data.maps[3] = mapInfo(material->getRoughnessMap());
+  data.maps[4] = mapInfo(material->getMetallicMap());
+
+  if (cached.descriptorSet == VK_NULL_HANDLE) {
+    if (!descriptorPool->allocateDescriptor(*materialSetLayout, cached.descriptorSet)) {
+      throw std::runtime_error("failed to allocate material descriptor set!");
+    }
+    descriptorStats.setsAllocated++;
+  }
+
+  if (materialSetLayout->hasUpdateTemplate()) {
+    materialSetLayout->updateWithTemplate(cached.descriptorSet, &data);
+  } else {
+    BurnhopeDescriptorWriter writer{*materialSetLayout, *descriptorPool};
+    for (uint32_t binding = 0; binding < MaterialDescriptorData::MAP_COUNT; binding++) {
+      writer.writeImage(binding, &data.maps[binding]);
+    }
+    writer.overwrite(cached.descriptorSet);
+  }
+  descriptorStats.descriptorWrites += MaterialDescriptorData::MAP_COUNT;
+
+  // holding the material keeps the pointer key from being reused by a new material
+  cached.material = material;
+  cached.materialVersion = material->getVersion();
+  return cached.descriptorSet;
+}
+
+void SimpleRenderSystem::pruneDescriptorCache(int frameIndex) {
+  // materials no longer drawn give their sets back to the pool
+  auto& cache = materialDescriptorCache[frameIndex];
+  std::vector<VkDescriptorSet> staleSets;
+  for (auto it = cache.begin(); it != cache.end();) {
+    if (it->second.lastUsedFrame != frameCounter) {
+      staleSets.push_back(it->second.descriptorSet);
+      it = cache.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  if (!staleSets.empty()) {
+    descriptorPool->freeDescriptors(staleSets);
+  }
+}
+
+DescriptorStats SimpleRenderSystem::takeDescriptorStats() {
+  DescriptorStats stats = descriptorStats;
+  descriptorStats = {};
+  return stats;
+}
+
+DrawStats SimpleRenderSystem::takeDrawStats() {
+  DrawStats stats = drawStats;
+  drawStats = {};
+  return stats;
+}
+
 }  // namespace burnhope
@@ -5,32 +5,160 @@
 #include "lve_frame_info.hpp"
 #include "lve_game_object.hpp"
 #include "lve_pipeline.hpp"
+#include "lve_render_queue.hpp"
+#include "systems/gpu_cull_system.hpp"
 
 // std
+#include <array>
+#include <functional>
 #include <memory>
+#include <unordered_map>
 #include <vector>
 
 namespace burnhope {
+
+struct DescriptorStats {
+  uint32_t setsAllocated = 0;
+  uint32_t descriptorWrites = 0;
+
+  DescriptorStats &operator+=(const DescriptorStats &other) {
+    setsAllocated += other.setsAllocated;
+    descriptorWrites += other.descriptorWrites;
+    return *this;
+  }
+};
+
+struct DrawStats {
+  uint32_t objects = 0;  // draws it would take without batching
+  uint32_t draws = 0;
+  uint32_t prePassDraws = 0;  // depth-only draws, not counted in draws
+  uint32_t culled = 0;  // objects skipped by CPU frustum and occlusion culling
+
+  DrawStats &operator+=(const DrawStats &other) {
+    objects += other.objects;
+    draws += other.draws;
+    prePassDraws += other.prePassDraws;
+    culled += other.culled;
+    return *this;
+  }
+};
+
 class SimpleRenderSystem {
  public:
+  // Returns the render pass draws are recorded in. Shading variants are created lazily, so it
+  // is read again for each one, after a resize may have replaced the pass.
+  using RenderPassFn = std::function<VkRenderPass()>;
+
+  // With deferred set, renderPass is the G-buffer pass of a DeferredRenderSystem and draws only
+  // write the material inputs of lighting. Depth pre-passes are skipped then.
   SimpleRenderSystem(
-      BurnhopeDevice &device, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout);
+      BurnhopeDevice &device,
+      RenderPassFn renderPass,
+      VkDescriptorSetLayout globalSetLayout,
+      bool deferred = false);
   ~SimpleRenderSystem();
 
   SimpleRenderSystem(const SimpleRenderSystem &) = delete;
   SimpleRenderSystem &operator=(const SimpleRenderSystem &) = delete;
 
-  void renderGameObjects(FrameInfo &frameInfo);
+  // submits one packet per (model, material) batch, recorded later by the render queue
+  void renderGameObjects(FrameInfo &frameInfo, BurnhopeRenderQueue &renderQueue);
+  // GPU driven variant, submits one indirect packet per bucket of the cull system. Its cull
+  // dispatch for this frame must already be recorded.
+  void renderGameObjectsIndirect(
+      FrameInfo &frameInfo, BurnhopeRenderQueue &renderQueue, const GpuCullSystem &cullSystem);
+
+  // Creates the shading variants every material in components can be drawn with, for each light
+  // count class, so the first frames showing them don't stall on pipeline compiles. Materials
+  // added later still compile their variants on first use.
+  void prewarmPipelines(const BurnhopeComponentStore &components);
+
+  // shading pipelines created so far, one per material feature, light count and depth test mix
+  size_t getPipelineVariantCount() const { return shadingPipelines->size(); }
+
+  // returns the descriptor counters accumulated since the last call and resets them
+  DescriptorStats takeDescriptorStats();
+  // returns the draw counters accumulated since the last call and resets them
+  DrawStats takeDrawStats();
 
  private:
+  // per material set, rebuilt only when the material's version changes
+  struct CachedDescriptorSet {
+    VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+    std::shared_ptr<Material> material;
+    uint64_t materialVersion = 0;
+    uint64_t lastUsedFrame = 0;
+  };
+
+  // one set per frame over the scene and instance buffers, rebuilt when either grows
+  struct ObjectDescriptorSet {
+    VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+    uint64_t sceneBufferVersion = 0;
+    VkBuffer instanceBuffer = VK_NULL_HANDLE;
+  };
+
+  // objects sharing a model and material are drawn as one instanced draw
+  struct DrawInstance {
+    const BurnhopeModel *model;
+    const Material *material;
+    uint32_t sceneIndex;
+    float viewDistance;
+    BurnhopeGameObject::id_t entity;
+  };
+
   void createPipelineLayout(VkDescriptorSetLayout globalSetLayout);
-  void createPipeline(VkRenderPass renderPass);
+  void createPipeline();
+  // the variant for the material's features and this frame's light count. Materials with a
+  // depth pre-pass are shaded with depth test EQUAL and no depth writes.
+  BurnhopePipeline *getShadingPipeline(const Material &material);
+  uint32_t getShadingVariantMask(const Material &material, uint32_t lightClass) const;
+  // sets the light count class the frame's shading variants are picked with
+  void selectLightCountClass(uint32_t lightCount);
+  // submits a depth-only copy of packet, sorted ahead of all shading
+  void submitDepthPrePass(
+      RenderPacket packet, float viewDistance, BurnhopeRenderQueue &renderQueue);
+  // frustum culls this frame's objects, or takes the occlusion culler's results, then sorts the
+  // visible ones by their opaque sort key, which groups them into (model, material) runs ordered
+  // front-to-back, and uploads their scene indices
+  void buildInstanceBatches(FrameInfo &frameInfo, BurnhopeRenderQueue &renderQueue);
+  VkDescriptorSet getObjectDescriptorSet(
+      ObjectDescriptorSet &objectSet,
+      const FrameInfo &frameInfo,
+      const VkDescriptorBufferInfo &instanceBufferInfo);
+  VkDescriptorSet getMaterialDescriptorSet(
+      int frameIndex, const std::shared_ptr<Material> &material);
+  void pruneDescriptorCache(int frameIndex);
 
   BurnhopeDevice &lveDevice;
+  RenderPassFn renderPass;
+  bool deferred;
 
-  std::unique_ptr<BurnhopePipeline> lvePipeline;
+  std::unique_ptr<BurnhopePipelineVariants> shadingPipelines;
+  std::unique_ptr<BurnhopePipeline> depthPrePassPipeline;
+  uint32_t lightCountClass = 0;
   VkPipelineLayout pipelineLayout;
 
-  std::unique_ptr<BurnhopeDescriptorSetLayout> renderSystemLayout;
+  std::unique_ptr<BurnhopeDescriptorSetLayout> objectSetLayout;
+  std::unique_ptr<BurnhopeDescriptorSetLayout> materialSetLayout;
+  std::unique_ptr<BurnhopeDescriptorPool> descriptorPool;
+  std::array<ObjectDescriptorSet, BurnhopeSwapChain::MAX_FRAMES_IN_FLIGHT> objectDescriptorSets{};
+  // same layout, with the instance buffer written by the GPU cull pass
+  std::array<ObjectDescriptorSet, BurnhopeSwapChain::MAX_FRAMES_IN_FLIGHT>
+      indirectObjectDescriptorSets{};
+  std::array<std::unique_ptr<BurnhopeBuffer>, BurnhopeSwapChain::MAX_FRAMES_IN_FLIGHT>
+      instanceBuffers;
+  std::vector<uint32_t> visibleIndices;
+  std::vector<DrawInstance> drawInstances;
+  std::vector<uint64_t> instanceKeys;
+  std::vector<uint32_t> instanceOrder;
+  std::vector<uint32_t> sortScratch;
+  std::vector<uint32_t> instanceIndices;
+  std::array<
+      std::unordered_map<const Material *, CachedDescriptorSet>,
+      BurnhopeSwapChain::MAX_FRAMES_IN_FLIGHT>
+      materialDescriptorCache;
+  uint64_t frameCounter = 0;
+  DescriptorStats descriptorStats{};
+  DrawStats drawStats{};
 };
 }  // namespace burnhope
@@ -0,0 +1,71 @@
+#include "skybox_system.hpp"
+
+// std
+#include <cassert>
+#include <stdexcept>
+#include <vector>
+
+namespace burnhope {
+
+SkyboxSystem::SkyboxSystem(
+    BurnhopeDevice& device, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout)
+    : lveDevice{device} {
+  createPipelineLayout(globalSetLayout);
+  createPipeline(renderPass);
+}
+
+SkyboxSystem::~SkyboxSystem() {
+  vkDestroyPipelineLayout(lveDevice.device(), pipelineLayout, nullptr);
+}
+
+void SkyboxSystem::createPipelineLayout(VkDescriptorSetLayout globalSetLayout) {
+  std::vector<VkDescriptorSetLayout> descriptorSetLayouts{globalSetLayout};
+
+  VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+  pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+  pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(descriptorSetLayouts.size());
+  pipelineLayoutInfo.pSetLayouts = descriptorSetLayouts.data();
+  pipelineLayoutInfo.pushConstantRangeCount = 0;
+  pipelineLayoutInfo.pPushConstantRanges = nullptr;
+  if (vkCreatePipelineLayout(lveDevice.device(), &pipelineLayoutInfo, nullptr, &pipelineLayout) !=
+      VK_SUCCESS) {
+    throw std::runtime_error("failed to create pipeline layout!");
+  }
+}
+
+void SkyboxSystem::createPipeline(VkRenderPass renderPass) {
+  assert(pipelineLayout != nullptr && "Cannot create pipeline before pipeline layout");
+
+  // passes on the cleared far plane only, and leaves it there for later draws
+  PipelineConfigInfo pipelineConfig{};
+  BurnhopePipeline::defaultPipelineConfigInfo(pipelineConfig);
+  pipelineConfig.bindingDescriptions.clear();
+  pipelineConfig.attributeDescriptions.clear();
+  pipelineConfig.rasterizationInfo.cullMode = VK_CULL_MODE_NONE;
+  pipelineConfig.depthStencilInfo.depthCompareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+  pipelineConfig.depthStencilInfo.depthWriteEnable = VK_FALSE;
+  pipelineConfig.renderPass = renderPass;
+  pipelineConfig.pipelineLayout = pipelineLayout;
+  lvePipeline = std::make_unique<BurnhopePipeline>(
+      lveDevice,
+      "shaders/sky.vert.spv",
+      "shaders/sky.frag.spv",
+      pipelineConfig);
+}
+
+void SkyboxSystem::render(FrameInfo& frameInfo, BurnhopeRenderQueue& renderQueue) {
+  RenderPacket packet{};
+  packet.pipeline = lvePipeline.get();
+  packet.pipelineLayout = pipelineLayout;
+  packet.descriptorSets[0] = frameInfo.globalDescriptorSet;
+  packet.vertexCount = 3;
+  // farthest of the opaque draws, the depth test hides it behind them in any order
+  packet.sortKey = BurnhopeRenderQueue::makeOpaqueKey(
+      renderQueue.stateId(lvePipeline.get()),
+      0,
+      0,
+      frameInfo.camera.getFarClip());
+  renderQueue.submit(packet);
+}
+
+}  // namespace burnhope
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "lve_device.hpp"
+#include "lve_frame_info.hpp"
+#include "lve_pipeline.hpp"
+#include "lve_render_queue.hpp"
+
+// std
+#include <memory>
+
+namespace burnhope {
+
+// Draws the environment map of the global set behind the scene, as one full-screen triangle
+// on the far plane that only shows where nothing else wrote depth.
+class SkyboxSystem {
+ public:
+  SkyboxSystem(
+      BurnhopeDevice &device, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout);
+  ~SkyboxSystem();
+
+  SkyboxSystem(const SkyboxSystem &) = delete;
+  SkyboxSystem &operator=(const SkyboxSystem &) = delete;
+
+  void render(FrameInfo &frameInfo, BurnhopeRenderQueue &renderQueue);
+
+ private:
+  void createPipelineLayout(VkDescriptorSetLayout globalSetLayout);
+  void createPipeline(VkRenderPass renderPass);
+
+  BurnhopeDevice &lveDevice;
+
+  std::unique_ptr<BurnhopePipeline> lvePipeline;
+  VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+};
+
+}  // namespace burnhope